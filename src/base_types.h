@@ -41,6 +41,9 @@ namespace pdftoedn
         Symbol(const char* s) : str(s) {}
         explicit Symbol(const std::string& s) : str(s) {}
 
+        // without the leading ':'
+        const std::string& name() const { return str; }
+
         virtual std::ostream& to_edn(std::ostream& o) const {
             o << ":" << str;
             return o;
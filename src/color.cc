@@ -13,12 +13,20 @@ namespace pdftoedn
     // output color components into an HTML-style color string (e.g.: #00ff00)
     std::ostream& RGBColor::to_edn(std::ostream& o) const
     {
+        // restore the stream's format so numbers written after the
+        // color aren't in hex
+        std::ios::fmtflags f = o.flags();
+        char fill = o.fill();
+
         o << '"'
           << "#" << std::setfill('0')
           << std::setw(2) << std::hex << red()
           << std::setw(2) << std::hex << green()
           << std::setw(2) << std::hex << blue()
           << '"';
+
+        o.flags(f);
+        o.fill(fill);
         return o;
     }
 } // namespace
@@ -40,6 +40,7 @@ namespace pdftoedn
         color_comp_t red() const { return colToByte(r); }
         color_comp_t green() const { return colToByte(g); }
         color_comp_t blue() const { return colToByte(b); }
+        uint32_t rgb() const { return (red() << 16) | (green() << 8) | blue(); } // 0xRRGGBB
 
         bool equals(color_comp_t red, color_comp_t green, color_comp_t blue) const {
             return (r == red && g == green && b == blue);
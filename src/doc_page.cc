@@ -1,3 +1,7 @@
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
 #include <iostream>
 #include <ostream>
 #include <string>
@@ -5,6 +9,8 @@
 #include <list>
 #include <vector>
 #include <algorithm>
+#include <cmath>
+#include <functional>
 
 #include <poppler/GfxState.h>
 
@@ -12,6 +18,9 @@
 #include "text.h"
 #include "graphics.h"
 #include "pdf_error_tracker.h"
+#include "pdf_stats_tracker.h"
+#include "pdf_span_table.h"
+#include "pdf_sqlite_sink.h"
 #include "doc_page.h"
 #include "edsel_options.h"
 #include "util.h"
@@ -53,6 +62,28 @@ namespace pdftoedn
 
     static const pdftoedn::Symbol SYMBOL_EQUIVALENT_FONTS      = "equivalent_doc_fonts";
 
+    // number of spans and graphics above which the page is
+    // serialized on multiple threads
+    static const uintmax_t PARALLEL_EDN_MIN_ITEMS = 4096;
+
+    // spans with the same text and font whose bbox corners are
+    // within this distance (in points) of an earlier one's are
+    // treated as duplicates. The hash cells must be larger
+    static const double DUPLICATE_SPAN_TOLERANCE = 1.0;
+    static const double DUPLICATE_SPAN_CELL_SIZE = 4.0;
+
+    //
+    // bbox of the transformed corners of a box
+    static BoundingBox transform_bbox(const BoundingBox& bbox, const PdfTM& tm)
+    {
+        Bounds b;
+        b.expand( tm.transform(bbox.x1(), bbox.y1()) );
+        b.expand( tm.transform(bbox.x2(), bbox.y1()) );
+        b.expand( tm.transform(bbox.x1(), bbox.y2()) );
+        b.expand( tm.transform(bbox.x2(), bbox.y2()) );
+        return b.bounding_box();
+    }
+
     // ==================================================================
     //
     //
@@ -73,6 +104,7 @@ namespace pdftoedn
         util::delete_ptr_container_elems(fonts);
         util::delete_ptr_container_elems(colors);
         util::delete_ptr_container_elems(glyphs);
+        delete pending_glyph;
         util::delete_ptr_container_elems(clip_paths);
         util::delete_ptr_container_elems(graphics);
         util::delete_ptr_container_elems(links);
@@ -279,6 +311,18 @@ namespace pdftoedn
             span_bbox = span_bbox.clip( clip_paths[ span_clip_path_id ]->bounding_box() );
         }
 
+        // drop runs drawn over an identical one (or keep them marked
+        // if requested)
+        if (span_index.check_and_add(*span, span->text())) {
+            if (!pdftoedn::options.mark_duplicate_text()) {
+                stats.add("duplicate_text", "dropped");
+                delete span;
+                return false;
+            }
+            stats.add("duplicate_text", "marked");
+            span->mark_duplicate();
+        }
+
 #if 0
         // remove any spans this one "overwrites"
         //
@@ -296,6 +340,57 @@ namespace pdftoedn
         return true;
     }
 
+    //
+    // spans are bucketed into cells larger than the tolerance so
+    // duplicates are in the same cell as the original or one of its
+    // neighbours
+    bool PdfPage::DuplicateSpanIndex::check_and_add(const PdfText& span, const std::string& text)
+    {
+        const BoundingBox& bbox = span.bounding_box();
+
+        Key k;
+        k.text = text;
+        k.font_idx = span.font_index();
+        intmax_t cell_x = static_cast<intmax_t>(std::floor(bbox.x1() / DUPLICATE_SPAN_CELL_SIZE));
+        intmax_t cell_y = static_cast<intmax_t>(std::floor(bbox.y1() / DUPLICATE_SPAN_CELL_SIZE));
+
+        for (intmax_t dx = -1; dx <= 1; ++dx) {
+            for (intmax_t dy = -1; dy <= 1; ++dy) {
+                k.cell_x = cell_x + dx;
+                k.cell_y = cell_y + dy;
+
+                auto ci = cells.find(k);
+                if (ci == cells.end()) {
+                    continue;
+                }
+
+                for (const BoundingBox& b : ci->second) {
+                    if (std::abs(b.x1() - bbox.x1()) <= DUPLICATE_SPAN_TOLERANCE &&
+                        std::abs(b.y1() - bbox.y1()) <= DUPLICATE_SPAN_TOLERANCE &&
+                        std::abs(b.x2() - bbox.x2()) <= DUPLICATE_SPAN_TOLERANCE &&
+                        std::abs(b.y2() - bbox.y2()) <= DUPLICATE_SPAN_TOLERANCE) {
+                        return true;
+                    }
+                }
+            }
+        }
+
+        k.cell_x = cell_x;
+        k.cell_y = cell_y;
+        cells[k].push_back(bbox);
+        return false;
+    }
+
+    std::size_t PdfPage::DuplicateSpanIndex::KeyHash::operator()(const Key& k) const
+    {
+        std::size_t h = std::hash<std::string>()(k.text);
+        h = h * 31 + std::hash<intmax_t>()(k.font_idx);
+        h = h * 31 + std::hash<intmax_t>()(k.cell_x);
+        h = h * 31 + std::hash<intmax_t>()(k.cell_y);
+        return h;
+    }
+
+
     //
     // checks if the pending span overlaps any already stored spans
     // and, if so, removes them
@@ -360,21 +455,17 @@ namespace pdftoedn
                 text_spans.erase(tmp);
             }
             else {
-                // for ratios between 25% and 80%, check the bbox to
-                // see if a chucnk of the span is covered; if so,
-                // remove those characters from the span.. TODO: this
-                // assumes horizontal spans so FIX
-                if (sbbox.x_min() < path_bbox.x_min() ||
-                    sbbox.x_max() > path_bbox.x_max()) {
-                    PdfText* s = dynamic_cast<PdfText*>(span);
-                    if (s) {
-                        s->whiteout(path_bbox);
-
-                        // if no chars are left, delete it
-                        if (s->length() == 0) {
-                            delete *tmp;
-                            text_spans.erase(tmp);
-                        }
+                // for ratios between 25% and 80%, check if a chunk
+                // of the span is covered along its baseline; if so,
+                // remove those characters from the span
+                PdfText* s = dynamic_cast<PdfText*>(span);
+                if (s) {
+                    s->whiteout(path_bbox);
+
+                    // if no chars are left, delete it
+                    if (s->length() == 0) {
+                        delete *tmp;
+                        text_spans.erase(tmp);
                     }
                 }
             }
@@ -455,6 +546,70 @@ namespace pdftoedn
         delete c;
     }
 
+    //
+    // estimate the character bbox as new_character() does (padded by
+    // the font size in all directions on rotated text since the
+    // height is not reliable) and check it against the page and clip
+    // bounds
+    bool PdfPage::char_is_hidden(double x, double y, double w, double h, const PdfTM& ctm,
+                                 bool invisible)
+    {
+        if (invisible) {
+            // mark the page as carrying invisible text even if the
+            // character is dropped
+            has_invisible_text = true;
+        }
+
+        double font_size = cur_text.attribs.font_size;
+        BoundingBox bbox = (ctm.is_rotated() ?
+                            BoundingBox(Coord(std::min(x, x + w) - font_size, std::min(y, y + h) - font_size),
+                                        Coord(std::max(x, x + w) + font_size, std::max(y, y + h) + font_size)) :
+                            BoundingBox(x, y, w, -font_size));
+
+        if (!inside_page(bbox)) {
+            ++chars_off_page;
+            return true;
+        }
+
+        if (cur_gfx.clip_path_set() &&
+            !bbox.is_inside( clip_paths[ cur_gfx.clip_path() ]->bounding_box() )) {
+            ++chars_clipped;
+            return true;
+        }
+
+        if (!inside_regions(bbox)) {
+            ++chars_outside_regions;
+            return true;
+        }
+        return false;
+    }
+
+    //
+    // check if the bbox is outside all regions of interest
+    bool PdfPage::outside_regions(const BoundingBox& bbox, const char* kind) const
+    {
+        if (inside_regions(bbox)) {
+            return false;
+        }
+
+        stats.add("region_rejected", kind);
+        return true;
+    }
+
+    bool PdfPage::inside_regions(const BoundingBox& bbox) const
+    {
+        if (regions.empty()) {
+            return true;
+        }
+
+        for (const BoundingBox& r : regions) {
+            if (bbox.is_inside(r)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
     //
     // end-of-text span marker
     void PdfPage::mark_end_of_text()
@@ -492,12 +647,256 @@ namespace pdftoedn
         // make sure to push the final span
         mark_end_of_text();
 
+        // only keep resources the output refers to
+        prune_resources();
+
+        if (chars_off_page) {
+            stats.add("text_rejected", "off_page", chars_off_page);
+        }
+        if (chars_clipped) {
+            stats.add("text_rejected", "clipped", chars_clipped);
+        }
+        if (chars_outside_regions) {
+            stats.add("region_rejected", "chars", chars_outside_regions);
+        }
+
         if (pdftoedn::options.include_debug_info()) {
             // report any page font issues
             for (const PdfPage::PageFont* f : fonts) { f->log_font_issues(); }
         }
     }
 
+
+    //
+    // span table rows - resolves each span's fill color
+    void PdfPage::add_spans_to(SpanTable& table) const
+    {
+        for (const PdfBoxedItem* i : text_spans) {
+            const PdfText* t = dynamic_cast<const PdfText*>(i);
+            if (!t) {
+                continue;
+            }
+
+            table.add_span(number, *t, color_entry(t->color_index()));
+        }
+    }
+
+
+#ifdef HAVE_SQLITE3
+    //
+    // page row, fonts, and items in a single transaction
+    bool PdfPage::add_to(SqliteSink& db) const
+    {
+        if (!db.begin_page(number, width(), height(), rotation)) {
+            return false;
+        }
+
+        bool ok = true;
+        for (uintmax_t ii = 0; ok && ii < fonts.size(); ++ii) {
+            ok = db.add_font(ii, fonts[ii]->font());
+        }
+
+        for (const PdfBoxedItem* i : text_spans) {
+            const PdfText* t = dynamic_cast<const PdfText*>(i);
+            if (ok && t) {
+                ok = db.add_span(*t, color_entry(t->color_index()));
+            }
+        }
+
+        for (const PdfDocPath* p : clip_paths) {
+            if (ok) {
+                ok = db.add_path(*p, NULL);
+            }
+        }
+
+        for (const PdfGfxCmd* g : graphics) {
+            if (!ok) {
+                break;
+            }
+
+            const PdfDocPath* p = dynamic_cast<const PdfDocPath*>(g);
+            if (p) {
+                ok = db.add_path(*p, color_entry(p->color_index()));
+                continue;
+            }
+
+            const PdfImage* img = dynamic_cast<const PdfImage*>(g);
+            if (img) {
+                const ImageData* data = NULL;
+                for (const ImageData* d : images) {
+                    if (d->id() == img->resource_id()) {
+                        data = d;
+                        break;
+                    }
+                }
+                ok = db.add_image(*img, data);
+            }
+        }
+
+        for (uintmax_t ii = 0; ok && ii < links.size(); ++ii) {
+            ok = db.add_link(ii, *links[ii]);
+        }
+
+        return db.end_page(ok);
+    }
+#endif
+
+
+    //
+    // color table entry or NULL if the index is not set
+    const RGBColor* PdfPage::color_entry(intmax_t color_idx) const
+    {
+        if (color_idx < 0 || static_cast<uintmax_t>(color_idx) >= colors.size()) {
+            return NULL;
+        }
+        return colors[ color_idx ];
+    }
+
+    //
+    // colors are registered as they are set in the PDF and clip paths
+    // as they are defined, whether anything is painted with them or
+    // not. Fonts may be left behind by discarded spans. Remove the
+    // unreferenced entries and renumber what remains
+    void PdfPage::prune_resources()
+    {
+        ResourceIndexMap font_map(fonts.size()), color_map(colors.size()), clip_map(clip_paths.size());
+
+        // mark what the text spans and graphics refer to
+        for (const PdfBoxedItem* i : text_spans) {
+            const PdfText* t = dynamic_cast<const PdfText*>(i);
+            if (t) {
+                font_map.mark(t->font_index());
+                color_map.mark(t->color_index());
+                clip_map.mark(t->clip_id());
+            }
+        }
+
+        for (const PdfGfxCmd* g : graphics) {
+            const PdfDocPath* p = dynamic_cast<const PdfDocPath*>(g);
+            if (p) {
+                color_map.mark(p->color_index());
+                clip_map.mark(p->id());
+                continue;
+            }
+
+            const PdfImage* img = dynamic_cast<const PdfImage*>(g);
+            if (img) {
+                color_map.mark(img->color_index());
+                clip_map.mark(img->clip_id());
+                continue;
+            }
+
+            const PdfGlyphRef* ref = dynamic_cast<const PdfGlyphRef*>(g);
+            if (ref) {
+                color_map.mark(ref->color_index());
+                clip_map.mark(ref->clip_id());
+            }
+        }
+
+        // Type3 glyph definitions only carry colors
+        for (const PdfGlyph* glyph : glyphs) {
+            for (const PdfGfxCmd* g : glyph->commands()) {
+                const PdfDocPath* p = dynamic_cast<const PdfDocPath*>(g);
+                if (p) {
+                    color_map.mark(p->color_index());
+                    continue;
+                }
+
+                const PdfImage* img = dynamic_cast<const PdfImage*>(g);
+                if (img) {
+                    color_map.mark(img->color_index());
+                }
+            }
+        }
+
+        uintmax_t unused_fonts = font_map.renumber();
+        uintmax_t unused_colors = color_map.renumber();
+        uintmax_t unused_clips = clip_map.renumber();
+
+        if (unused_fonts == 0 && unused_colors == 0 && unused_clips == 0) {
+            return;
+        }
+
+        // update references
+        for (PdfBoxedItem* i : text_spans) {
+            PdfText* t = dynamic_cast<PdfText*>(i);
+            if (t) {
+                t->set_resource_indices(font_map[ t->font_index() ],
+                                        color_map[ t->color_index() ],
+                                        clip_map[ t->clip_id() ]);
+            }
+        }
+
+        for (PdfGfxCmd* g : graphics) {
+            PdfDocPath* p = dynamic_cast<PdfDocPath*>(g);
+            if (p) {
+                p->set_color_index( color_map[ p->color_index() ] );
+                p->set_clip_id( clip_map[ p->id() ] );
+                continue;
+            }
+
+            PdfImage* img = dynamic_cast<PdfImage*>(g);
+            if (img) {
+                img->set_color_index( color_map[ img->color_index() ] );
+                img->set_clip_id( clip_map[ img->clip_id() ] );
+                continue;
+            }
+
+            PdfGlyphRef* ref = dynamic_cast<PdfGlyphRef*>(g);
+            if (ref) {
+                ref->set_color_index( color_map[ ref->color_index() ] );
+                ref->set_clip_id( clip_map[ ref->clip_id() ] );
+            }
+        }
+
+        for (PdfGlyph* glyph : glyphs) {
+            for (PdfGfxCmd* g : glyph->commands()) {
+                PdfDocPath* p = dynamic_cast<PdfDocPath*>(g);
+                if (p) {
+                    p->set_color_index( color_map[ p->color_index() ] );
+                    continue;
+                }
+
+                PdfImage* img = dynamic_cast<PdfImage*>(g);
+                if (img) {
+                    img->set_color_index( color_map[ img->color_index() ] );
+                }
+            }
+        }
+
+        // drop the unused entries. Clip paths carry their own index
+        // as id for SVG output so reset them
+        font_map.compact(fonts);
+        color_map.compact(colors);
+        clip_map.compact(clip_paths);
+
+        for (uintmax_t ii = 0; ii < clip_paths.size(); ++ii) {
+            clip_paths[ii]->set_clip_id(ii);
+        }
+
+        stats.add("page_resources", "pruned_fonts", unused_fonts);
+        stats.add("page_resources", "pruned_colors", unused_colors);
+        stats.add("page_resources", "pruned_clip_paths", unused_clips);
+    }
+
+
+    //
+    // computes the new index of each referenced entry. Returns the
+    // number of unreferenced entries
+    uintmax_t PdfPage::ResourceIndexMap::renumber()
+    {
+        uintmax_t n = 0;
+        remap.resize(used.size(), -1);
+
+        for (uintmax_t ii = 0; ii < used.size(); ++ii) {
+            if (used[ii]) {
+                remap[ii] = n++;
+            }
+        }
+        return used.size() - n;
+    }
+
+
     //
     // searches if a clip path has already been defined to avoid
     // duplicates
@@ -517,6 +916,41 @@ namespace pdftoedn
     // create and add a new path type
     void PdfPage::add_path(GfxState* state, PdfDocPath::Type type, PdfDocPath::EvenOddRule eo_flag)
     {
+        // text-only mode keeps no graphics but clips still reject
+        // characters and opaque fills still white out text
+        bool text_only = pdftoedn::options.text_only();
+        if (text_only && type == PdfDocPath::FILL && cur_gfx.attribs.fill.opacity != 1.0) {
+            return;
+        }
+
+        // with regions of interest, check the bounds of the path
+        // points (curve control points included) before building it.
+        // Glyph definitions are checked when they are referenced
+        if (type != PdfDocPath::CLIP && !regions.empty() && !pending_glyph) {
+            Bounds path_bounds;
+            GfxPath* poppler_path = state->getPath();
+            Coord c;
+
+            for (intmax_t i = 0; i < poppler_path->getNumSubpaths(); ++i) {
+                GfxSubpath *subpath = poppler_path->getSubpath(i);
+
+                for (intmax_t j = 0; j < subpath->getNumPoints(); ++j) {
+                    state->transform(subpath->getX(j), subpath->getY(j), &c.x, &c.y);
+                    path_bounds.expand(c);
+                }
+            }
+
+            if (outside_regions(path_bounds.bounding_box(), "paths")) {
+                return;
+            }
+        }
+
+        // paths drawn by a Type3 CharProc are stored in glyph space
+        PdfTM path_tm(state->getCTM());
+        if (pending_glyph && type != PdfDocPath::CLIP) {
+            path_tm = path_tm * pending_glyph->glyph_space();
+        }
+
         // convert the poppler path to our own type
         PdfDocPath* edsel_path = new PdfDocPath(type, cur_gfx.attribs, eo_flag);
         Coord c1, c2, c3;
@@ -529,23 +963,23 @@ namespace pdftoedn
             if (subpath->getNumPoints() > 0)
             {
                 // register a new move_to command
-                state->transform(subpath->getX(0), subpath->getY(0), &c1.x, &c1.y);
+                c1 = path_tm.transform(subpath->getX(0), subpath->getY(0));
                 edsel_path->move_to(c1);
 
                 for (intmax_t j = 1; j < subpath->getNumPoints(); j++)
                 {
                     if (subpath->getCurve(j)) {
                         // and either a curve_to or
-                        state->transform(subpath->getX(j), subpath->getY(j), &c1.x, &c1.y);
+                        c1 = path_tm.transform(subpath->getX(j), subpath->getY(j));
                         j++;
-                        state->transform(subpath->getX(j), subpath->getY(j), &c2.x, &c2.y);
+                        c2 = path_tm.transform(subpath->getX(j), subpath->getY(j));
                         j++;
-                        state->transform(subpath->getX(j), subpath->getY(j), &c3.x, &c3.y);
+                        c3 = path_tm.transform(subpath->getX(j), subpath->getY(j));
                         edsel_path->curve_to(c1, c2, c3);
                     }
                     else {
                         // a line to
-                        state->transform(subpath->getX(j), subpath->getY(j), &c1.x, &c1.y);
+                        c1 = path_tm.transform(subpath->getX(j), subpath->getY(j));
                         edsel_path->line_to(c1);
                     }
                 }
@@ -578,6 +1012,15 @@ namespace pdftoedn
             // and set the active clip path
             cur_gfx.attribs.clip_idx = cur_path_idx;
         }
+        else if (pending_glyph) {
+            // clip and page bounds are applied to the glyph's
+            // references instead
+            if (edsel_path->length() == 0) {
+                delete edsel_path;
+                return;
+            }
+            pending_glyph->add(edsel_path, edsel_path->bounding_box());
+        }
         else {
             // stroke / fill paths might be clipped
             if (cur_gfx.clip_path_set()) {
@@ -618,6 +1061,11 @@ namespace pdftoedn
                 remove_spans_overlapped_by_region( *edsel_path );
             }
 
+            if (text_only) {
+                delete edsel_path;
+                return;
+            }
+
             // all other paths get stored in the graphics list
             graphics.push_back( edsel_path );
 
@@ -628,10 +1076,25 @@ namespace pdftoedn
 
 
     //
-    // adds an image entry to the list
-    void PdfPage::new_image(int resource_id, const BoundingBox& bbox)
+    // adds an image entry to the list. Stencil masks are painted
+    // with the current fill color
+    void PdfPage::new_image(int resource_id, const BoundingBox& bbox, bool is_mask)
     {
+        if (pending_glyph) {
+            // image masks drawn by a Type3 CharProc
+            BoundingBox glyph_bbox = transform_bbox(bbox, pending_glyph->glyph_space());
+            PdfImage* img = new pdftoedn::PdfImage(resource_id, glyph_bbox);
+            if (is_mask) {
+                img->set_color_index( cur_gfx.attribs.fill.color_idx );
+            }
+            pending_glyph->add(img, glyph_bbox);
+            return;
+        }
+
         PdfImage* img = new pdftoedn::PdfImage(resource_id, bbox);
+        if (is_mask) {
+            img->set_color_index( cur_gfx.attribs.fill.color_idx );
+        }
 
         BoundingBox img_bbox(bbox);
         if (cur_gfx.clip_path_set()) {
@@ -648,6 +1111,81 @@ namespace pdftoedn
     }
 
 
+    //
+    // Type3 glyph definitions are looked up by font and character
+    // code
+    intmax_t PdfPage::find_glyph(const PdfFont* font, uintmax_t code) const
+    {
+        auto ii = glyph_map.find( std::make_pair(font, code) );
+        if (ii != glyph_map.end()) {
+            return ii->second;
+        }
+        return -1;
+    }
+
+    bool PdfPage::begin_glyph(const PdfFont* font, uintmax_t code, const PdfTM& glyph_ctm)
+    {
+        if (pending_glyph) {
+            return false;
+        }
+
+        pending_glyph = new PdfGlyph(font, code, glyph_ctm);
+        pending_glyph_ctm = glyph_ctm;
+        return true;
+    }
+
+    //
+    // stores the collected definition and draws it at the occurrence
+    // it was collected from
+    void PdfPage::end_glyph()
+    {
+        if (!pending_glyph) {
+            return;
+        }
+
+        intmax_t glyph_idx = glyphs.size();
+        glyph_map[ std::make_pair(pending_glyph->font_key(), pending_glyph->char_code()) ] = glyph_idx;
+        glyphs.push_back(pending_glyph);
+        pending_glyph = NULL;
+
+        new_glyph_ref(glyph_idx, pending_glyph_ctm);
+    }
+
+    void PdfPage::new_glyph_ref(intmax_t glyph_idx, const PdfTM& glyph_ctm)
+    {
+        const PdfGlyph* glyph = glyphs[ glyph_idx ];
+
+        // nothing to draw (e.g., spaces)
+        if (glyph->is_empty()) {
+            return;
+        }
+
+        BoundingBox bbox = transform_bbox(glyph->bounding_box(), glyph_ctm);
+
+        if (outside_regions(bbox, "glyphs") || !inside_page(bbox)) {
+            return;
+        }
+
+        PdfGlyphRef* ref = new PdfGlyphRef(glyph_idx, glyph_ctm, bbox, cur_gfx.attribs.fill.color_idx);
+
+        if (cur_gfx.clip_path_set()) {
+            const BoundingBox& cb = clip_paths[ cur_gfx.clip_path() ]->bounding_box();
+
+            if (bbox.is_clipped_by(cb) == BoundingBox::FULLY_CLIPPED) {
+                delete ref;
+                return;
+            }
+            ref->set_clip_id( cur_gfx.clip_path() );
+            bbox = bbox.clip(cb);
+        }
+
+        graphics.push_back( ref );
+
+        // update bounds tracking for graphics elements
+        cur_gfx.bounds.expand( bbox );
+    }
+
+
     //
     // check if a character is within any of the link bboxes
     intmax_t PdfPage::inside_link(const BoundingBox& bbox) const
@@ -703,15 +1241,14 @@ namespace pdftoedn
         page_h.push( SYMBOL_PAGE_OK,                            !et.errors_reported() );
 
         // text spans, graphics, links
+        bool parallel = (!pdftoedn::options.serial_edn() &&
+                         text_spans.size() + clip_paths.size() + graphics.size() >= PARALLEL_EDN_MIN_ITEMS);
 
         // an array for the text spans
-        util::edn::Vector text_a(text_spans.size());
-        for (const PdfBoxedItem* t : text_spans) { text_a.push(t); }
+        util::edn::Vector text_a(parallel ? 0 : text_spans.size());
 
         // an array for the graphics with clip paths first
-        util::edn::Vector gfx_a(clip_paths.size() + graphics.size());
-        for (const PdfDocPath* cp : clip_paths) { gfx_a.push( cp ); }
-        for (const PdfGfxCmd* g : graphics) { gfx_a.push( g ); }
+        util::edn::Vector gfx_a(parallel ? 0 : clip_paths.size() + graphics.size());
 
         // an array for links
         util::edn::Vector links_a(links.size());
@@ -720,6 +1257,32 @@ namespace pdftoedn
         util::edn::Hash resources;
         resource_to_edn_hash(resources);
 
+        // dense pages have their spans, graphics, and resources
+        // written in chunks on a pool of threads. The output is the
+        // same as the serial one
+        util::edn::Raw text_edn, gfx_edn, resources_edn;
+
+        if (parallel) {
+            std::vector<const gemable*> text_items(text_spans.begin(), text_spans.end());
+
+            std::vector<const gemable*> gfx_items(clip_paths.begin(), clip_paths.end());
+            gfx_items.insert(gfx_items.end(), graphics.begin(), graphics.end());
+
+            util::edn::ParallelWriter writer(o);
+            writer.add_vector(text_items, text_edn);
+            writer.add_vector(gfx_items, gfx_edn);
+            writer.add(&resources, resources_edn);
+            writer.run();
+
+            stats.add("edn_output", "parallel_pages");
+        }
+        else {
+            for (const PdfBoxedItem* t : text_spans) { text_a.push(t); }
+
+            for (const PdfDocPath* cp : clip_paths) { gfx_a.push( cp ); }
+            for (const PdfGfxCmd* g : graphics) { gfx_a.push( g ); }
+        }
+
         // populate hash with the data to be returned
         page_h.push( SYMBOL_PAGE_WIDTH,                   width() );
         page_h.push( SYMBOL_PAGE_HEIGHT,                  height() );
@@ -740,10 +1303,17 @@ namespace pdftoedn
         }
         page_h.push( SYMBOL_PAGE_BOUNDS,                  page_bounds );
 
-        page_h.push( SYMBOL_RESOURCES,                    resources );
+        if (parallel) {
+            page_h.push( SYMBOL_RESOURCES,                &resources_edn );
+
+            page_h.push( SYMBOL_PAGE_TEXT_SPANS,          &text_edn );
+            page_h.push( SYMBOL_PAGE_GFX_CMDS,            &gfx_edn );
+        } else {
+            page_h.push( SYMBOL_RESOURCES,                resources );
 
-        page_h.push( SYMBOL_PAGE_TEXT_SPANS,              text_a );
-        page_h.push( SYMBOL_PAGE_GFX_CMDS,                gfx_a );
+            page_h.push( SYMBOL_PAGE_TEXT_SPANS,          text_a );
+            page_h.push( SYMBOL_PAGE_GFX_CMDS,            gfx_a );
+        }
         page_h.push( SYMBOL_PAGE_LINKS,                   links_a );
 
         // warnings / errors encountered
@@ -4,7 +4,10 @@
 #include <set>
 #include <stack>
 #include <list>
+#include <map>
 #include <vector>
+#include <string>
+#include <unordered_map>
 
 #include <poppler/GfxState.h>
 
@@ -17,6 +20,9 @@
 
 namespace pdftoedn
 {
+    class SpanTable;
+    class SqliteSink;
+
     // ---------------------------------------------------------
     // tracks the data read from a page in the PDF doc.
     //
@@ -26,7 +32,8 @@ namespace pdftoedn
         // constructor / destructor
         PdfPage(uintmax_t page_number, double page_width, double page_height, intmax_t page_rotation) :
             number(page_number), bbox(0, 0, page_width, page_height), rotation(page_rotation),
-            has_invisible_text(false)
+            has_invisible_text(false), pending_glyph(NULL),
+            chars_off_page(0), chars_clipped(0), chars_outside_regions(0)
         {}
         virtual ~PdfPage();
 
@@ -34,6 +41,7 @@ namespace pdftoedn
         double width() const { return bbox.width(); }
         double height() const { return bbox.height(); }
         bool is_rotated() const { return (rotation != 0); }
+        uintmax_t num_images() const { return images.size(); }
 
         // resource-related methods --
         // adds an entry to the color table if it doesn't exist;
@@ -65,6 +73,19 @@ namespace pdftoedn
                            const TextMetrics& metrics, uintmax_t unicode_c, intmax_t glyph_idx,
                            bool invisible);
 
+        // true if a character at the given position would fall
+        // outside the page or the current clip region so it can be
+        // dropped before it is built. Counted per page and added to
+        // the stats by finalize(). Invisible characters still mark
+        // the page as carrying invisible text
+        bool char_is_hidden(double x, double y, double width, double height, const PdfTM& ctm,
+                            bool invisible);
+
+        // regions of interest - when set, items that fall outside of
+        // all of them are discarded. The kind is used to count them
+        void add_region(const BoundingBox& region) { regions.push_back(region); }
+        bool outside_regions(const BoundingBox& bbox, const char* kind) const;
+
         // graphics-related methods --
         //
         void push_gfx_state();
@@ -93,8 +114,23 @@ namespace pdftoedn
 
         // images --
         //
-        // creates and inserts a new image metadata container into the list
-        void new_image(int resource_id, const BoundingBox& bbox);
+        // creates and inserts a new image metadata container into the
+        // list. Masks carry the fill color they're drawn with
+        void new_image(int resource_id, const BoundingBox& bbox, bool is_mask = false);
+
+        // Type3 glyphs --
+        //
+        // index of the definition of the font's character or -1 if
+        // its CharProc has not been interpreted on this page
+        intmax_t find_glyph(const PdfFont* font, uintmax_t code) const;
+        // graphics added between begin_glyph() and end_glyph() are
+        // collected into a new definition instead of the page's
+        // list. Returns false if one is already being collected
+        bool begin_glyph(const PdfFont* font, uintmax_t code, const PdfTM& glyph_ctm);
+        void end_glyph();
+        // draws the glyph definition with the given glyph space to
+        // device transform
+        void new_glyph_ref(intmax_t glyph_idx, const PdfTM& glyph_ctm);
 
         // links --
         void new_annot_link(pdftoedn::PdfAnnotLink* const annot_link) {
@@ -103,6 +139,12 @@ namespace pdftoedn
 
         void finalize();
 
+        // adds a row per text span to the span table
+        void add_spans_to(SpanTable& table) const;
+
+        // inserts the page's resources and items into the database
+        bool add_to(SqliteSink& db) const;
+
         virtual std::ostream& to_edn(std::ostream& o) const;
 
         static const pdftoedn::Symbol SYMBOL_PAGE_TEXT_SPANS;
@@ -121,6 +163,8 @@ namespace pdftoedn
                 matching_doc_fonts.insert(&font);
             }
 
+            // the first of the equivalent fonts - used for output
+            const PdfFont& font() const { return **matching_doc_fonts.begin(); }
             bool is_equivalent_to(const PdfFont& font) const;
             void log_font_issues() const;
 
@@ -142,13 +186,49 @@ namespace pdftoedn
         std::vector<pdftoedn::RGBColor *> colors;
         std::set<pdftoedn::ImageData*, pdftoedn::ImageData::lt> images;
         std::vector<pdftoedn::PdfGlyph *> glyphs;
+        std::map<std::pair<const PdfFont*, uintmax_t>, intmax_t> glyph_map;
+        pdftoedn::PdfGlyph* pending_glyph;
+        PdfTM pending_glyph_ctm;
 
         // data
         std::multiset<pdftoedn::PdfBoxedItem *, pdftoedn::PdfBoxedItem::lt> text_spans;
         std::list<pdftoedn::PdfGfxCmd *> graphics;
         std::vector<pdftoedn::PdfDocPath *> clip_paths;
+        std::vector<BoundingBox> regions;
         std::vector<pdftoedn::PdfAnnotLink *> links;
 
+        // characters dropped by char_is_hidden()
+        uintmax_t chars_off_page;
+        uintmax_t chars_clipped;
+        uintmax_t chars_outside_regions;
+
+        // spatial hash of the stored spans keyed on text, font, and
+        // position cell. Used to find runs that are drawn more than
+        // once with small offsets (faux-bold, shadows)
+        class DuplicateSpanIndex {
+        public:
+            // true if an equivalent span is already in the index;
+            // adds it otherwise
+            bool check_and_add(const PdfText& span, const std::string& text);
+
+        private:
+            struct Key {
+                std::string text;
+                intmax_t font_idx;
+                intmax_t cell_x, cell_y;
+
+                bool operator==(const Key& k) const {
+                    return (cell_x == k.cell_x && cell_y == k.cell_y &&
+                            font_idx == k.font_idx && text == k.text);
+                }
+            };
+            struct KeyHash {
+                std::size_t operator()(const Key& k) const;
+            };
+
+            std::unordered_map<Key, std::vector<BoundingBox>, KeyHash> cells;
+        } span_index;
+
         // transient state as text is collected
         struct TextState {
             TextState() : span(NULL) { }
@@ -194,6 +274,47 @@ namespace pdftoedn
         // mark end of text object - triggers pushing of any pending spans
         void mark_end_of_text();
 
+        // maps indices of a resource table to those of the same
+        // table once unreferenced entries are removed
+        class ResourceIndexMap {
+        public:
+            ResourceIndexMap(uintmax_t table_size) : used(table_size, false) {}
+
+            void mark(intmax_t idx) {
+                if (idx >= 0 && static_cast<uintmax_t>(idx) < used.size()) {
+                    used[idx] = true;
+                }
+            }
+            uintmax_t renumber();
+            intmax_t operator[](intmax_t idx) const { return ((idx < 0) ? idx : remap[idx]); }
+
+            // deletes unreferenced entries from the table
+            template <class T>
+            void compact(std::vector<T *>& table) const {
+                uintmax_t n = 0;
+                for (uintmax_t ii = 0; ii < table.size(); ++ii) {
+                    if (used[ii]) {
+                        table[n++] = table[ii];
+                    } else {
+                        delete table[ii];
+                    }
+                }
+                table.resize(n);
+            }
+
+        private:
+            std::vector<bool> used;
+            std::vector<intmax_t> remap;
+        };
+
+        // drops colors, fonts, and clip paths not referenced by any
+        // output item
+        void prune_resources();
+
+        bool inside_regions(const BoundingBox& bbox) const;
+
+        const pdftoedn::RGBColor* color_entry(intmax_t color_idx) const;
+
         util::edn::Hash& resource_to_edn_hash(util::edn::Hash& resource_h) const;
 
         // prohibit these cause we shouldn't be using them anyway
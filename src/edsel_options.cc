@@ -3,6 +3,9 @@
 #include <ostream>
 #include <boost/filesystem.hpp>
 
+#include <cstdio>
+#include <fcntl.h>
+
 #ifdef CHECK_PDF_COOKIE
 #include <boost/regex.hpp>
 #endif
@@ -16,9 +19,10 @@
 
 namespace pdftoedn {
 
-    static const std::string EDN_FILE_EXT      = ".edn";
-    static const std::string IMAGE_FILE_EXT    = ".png";
-    static const std::string FONT_MAP_FILE_EXT = ".json";
+    static const std::string EDN_FILE_EXT        = ".edn";
+    static const std::string IMAGE_FILE_EXT      = ".png";
+    static const std::string SPAN_TABLE_FILE_EXT = ".spans.arrow";
+    static const std::string FONT_MAP_FILE_EXT   = ".json";
 
     static const std::string DEFAULT_CONFIG_DIR = util::expand_environment_variables("${HOME}") + "/.pdftoedn/";
 
@@ -43,6 +47,38 @@ namespace pdftoedn {
     }
 #endif
 
+    //
+    // parses a region of interest given as "[page:]x,y,width,height"
+    bool Options::parse_region(const std::string& region)
+    {
+        const char* s = region.c_str();
+        long page = -1;
+        double x, y, w, h;
+        int len = 0;
+
+        if (sscanf(s, "%ld:%lf,%lf,%lf,%lf%n", &page, &x, &y, &w, &h, &len) == 5 && s[len] == '\0') {
+            // page-specific
+            if (page < 0) {
+                return false;
+            }
+        } else {
+            // all pages
+            page = -1;
+            len = 0;
+            if (!(sscanf(s, "%lf,%lf,%lf,%lf%n", &x, &y, &w, &h, &len) == 4 && s[len] == '\0')) {
+                return false;
+            }
+        }
+
+        if (w <= 0 || h <= 0) {
+            return false;
+        }
+
+        roi.push_back(Region(page, x, y, w, h));
+        return true;
+    }
+
+
     // ======================================================================
     // constructor
     //
@@ -52,59 +88,54 @@ namespace pdftoedn {
                      const std::string& edn_filename,
                      const std::string& fontmap,
                      const Flags& f,
-                     intmax_t pg_num) :
+                     intmax_t pg_num,
+                     intmax_t pg_count,
+                     int progress_fd,
+                     const std::vector<std::string>& region_list,
+                     const std::vector<std::string>& search_list,
+                     const std::string& sqlite_db_filename,
+                     intmax_t max_jpeg_dpi) :
         src_pdf_filename(pdf_filename),
         src_pdf_owner_password(pdf_owner_password), src_pdf_user_password(pdf_user_password),
-        out_edn_filename(edn_filename), flags(f), page_num(pg_num)
+        out_edn_filename(edn_filename), flags(f), page_num(pg_num),
+        page_cnt(pg_count), progress_file_desc(progress_fd), jpeg_dpi(max_jpeg_dpi), search(search_list),
+        sqlite_db_file(sqlite_db_filename)
     {
         namespace fs = boost::filesystem;
-        fs::path file_path = src_pdf_filename;
 
-        // check input file
-        if (util::fs::check_valid_input_file(file_path)) {
-#ifdef CHECK_PDF_COOKIE
-            if (!check_pdf_cookie(src_pdf_filename)) {
-                std::stringstream ss;
-                ss << src_pdf_filename << " does not look like a valid PDF";
-                throw invalid_file(ss.str());
-            }
-#endif
+        // in server mode, the document and output file are set with
+        // each request
+        if (!src_pdf_filename.empty()) {
+            check_input_file();
         }
 
-        // check the destination
-        fs::path output_filepath = out_edn_filename;
-        fs::path parent_path(output_filepath.parent_path());
-
-        // output file path is required and will have to be created so
-        // check that its parent path exists
-        if (!parent_path.empty()) {
-            if (!fs::exists(parent_path) || !fs::is_directory(parent_path)) {
+        // parse the regions of interest
+        for (const std::string& r : region_list) {
+            if (!parse_region(r)) {
                 std::stringstream err;
-                err << "destination folder '" << parent_path << "' does not exist";
-                throw invalid_file(err.str());
+                err << "invalid region '" << r << "' - expected [page:]x,y,width,height";
+                throw init_error(err.str());
             }
-            output_path = parent_path.string();
         }
 
-        // check if the destination file exists
-        if (fs::exists(output_filepath))
-        {
-            // remove the file if asked to do so
-            if (flags.force_output_write) {
-                // but check if it's a file that can be deleted
-                if (!fs::is_regular_file(output_filepath)) {
-                    std::stringstream err;
-                    err << output_filepath << " destination exists but it is not a regular file and can't be overwritten";
-                    throw invalid_file(err.str());
+        // check the progress descriptor is open
+        if (progress_file_desc >= 0 && fcntl(progress_file_desc, F_GETFD) == -1) {
+            std::stringstream err;
+            err << "progress file descriptor " << progress_file_desc << " is not open";
+            throw init_error(err.str());
+        }
 
-                }
-                fs::remove(output_filepath);
-            } else {
-                // something exists with the name
-                std::stringstream err;
-                err << output_filepath << " destination file exists";
-                throw invalid_file(err.str());
-            }
+        if (!out_edn_filename.empty()) {
+            check_output_file();
+        }
+
+        // the database is created if it doesn't exist; existing ones
+        // are appended to
+        if (!sqlite_db_file.empty() &&
+            fs::exists(sqlite_db_file) && !fs::is_regular_file(sqlite_db_file)) {
+            std::stringstream err;
+            err << sqlite_db_file << " database path exists but it is not a regular file";
+            throw invalid_file(err.str());
         }
 
         // -- font maps --
@@ -145,6 +176,89 @@ namespace pdftoedn {
             }
         }
 
+        //        std::cerr << *this << std::endl;
+    }
+
+
+    //
+    // set the document, destination and pages for a server-mode
+    // request. Font maps and flags are kept so documents opened by
+    // earlier requests remain valid
+    void Options::set_document(const std::string& pdf_filename,
+                               const std::string& edn_filename,
+                               intmax_t pg_num,
+                               intmax_t pg_count)
+    {
+        src_pdf_filename = pdf_filename;
+        out_edn_filename = edn_filename;
+        page_num = pg_num;
+        page_cnt = pg_count;
+
+        check_input_file();
+        check_output_file();
+    }
+
+
+    //
+    // check the input file exists and can be read
+    void Options::check_input_file() const
+    {
+        boost::filesystem::path file_path = src_pdf_filename;
+
+        if (util::fs::check_valid_input_file(file_path)) {
+#ifdef CHECK_PDF_COOKIE
+            if (!check_pdf_cookie(src_pdf_filename)) {
+                std::stringstream ss;
+                ss << src_pdf_filename << " does not look like a valid PDF";
+                throw invalid_file(ss.str());
+            }
+#endif
+        }
+    }
+
+
+    //
+    // check the destination and set up the resource paths
+    void Options::check_output_file()
+    {
+        namespace fs = boost::filesystem;
+
+        fs::path output_filepath = out_edn_filename;
+        fs::path parent_path(output_filepath.parent_path());
+
+        // output file path is required and will have to be created so
+        // check that its parent path exists
+        output_path.clear();
+        if (!parent_path.empty()) {
+            if (!fs::exists(parent_path) || !fs::is_directory(parent_path)) {
+                std::stringstream err;
+                err << "destination folder '" << parent_path << "' does not exist";
+                throw invalid_file(err.str());
+            }
+            output_path = parent_path.string();
+        }
+
+        // check if the destination file exists
+        if (fs::exists(output_filepath))
+        {
+            // remove the file if asked to do so
+            if (flags.force_output_write) {
+                // but check if it's a file that can be deleted
+                if (!fs::is_regular_file(output_filepath)) {
+                    std::stringstream err;
+                    err << output_filepath << " destination exists but it is not a regular file and can't be overwritten";
+                    throw invalid_file(err.str());
+
+                }
+                fs::remove(output_filepath);
+            } else {
+                // something exists with the name
+                std::stringstream err;
+                err << output_filepath << " destination file exists";
+                throw invalid_file(err.str());
+            }
+        }
+
         // configure some useful paths, etc.
         doc_base_name = output_filepath.stem().string();
 
@@ -161,7 +275,19 @@ namespace pdftoedn {
         }
         resource_dir = res_dir.string();
 
-        //        std::cerr << *this << std::endl;
+        // the span table is written next to the output file
+        span_table_file.clear();
+        if (flags.span_table) {
+            fs::path span_table_path = (parent_path / (doc_base_name + SPAN_TABLE_FILE_EXT));
+
+            if (fs::exists(span_table_path) &&
+                (!flags.force_output_write || !fs::is_regular_file(span_table_path))) {
+                std::stringstream err;
+                err << span_table_path << " span table file exists";
+                throw invalid_file(err.str());
+            }
+            span_table_file = span_table_path.string();
+        }
     }
 
 
@@ -227,6 +353,12 @@ namespace pdftoedn {
             o << "   Output root path:  \"" << opt.output_path << boost::filesystem::path::preferred_separator << '"' << std::endl;
         }
         o << "   Resource path:     \"" << opt.resource_dir << boost::filesystem::path::preferred_separator << '"' << std::endl;
+        if (!opt.span_table_file.empty()) {
+            o << "   Span table file:   \"" << opt.span_table_file << '"' << std::endl;
+        }
+        if (!opt.sqlite_db_file.empty()) {
+            o << "   SQLite database:   \"" << opt.sqlite_db_file << '"' << std::endl;
+        }
 
         {
             // image path test
@@ -241,7 +373,31 @@ namespace pdftoedn {
         }
 
         if (opt.page_num != -1) {
-            o << "   req'd page number: " <<opt.page_num;
+            o << "   req'd page number: " <<opt.page_num << std::endl;
+        }
+
+        if (opt.page_cnt != -1) {
+            o << "   req'd page count:  " << opt.page_cnt << std::endl;
+        }
+
+        for (const Options::Region& r : opt.roi) {
+            o << "   region:            ";
+            if (r.page != -1) {
+                o << "page " << r.page << " ";
+            }
+            o << r.x << ", " << r.y << " " << r.width << "x" << r.height << std::endl;
+        }
+
+        if (opt.progress_file_desc != -1) {
+            o << "   progress fd:       " << opt.progress_file_desc << std::endl;
+        }
+
+        if (opt.jpeg_dpi != -1) {
+            o << "   max JPEG dpi:      " << opt.jpeg_dpi << std::endl;
+        }
+
+        for (const std::string& term : opt.search) {
+            o << "   search term:       \"" << term << '"' << std::endl;
         }
 
         std::list<std::string> opts;
@@ -263,6 +419,24 @@ namespace pdftoedn {
             opts.push_back("font_preprocess");
         if (opt.flags.force_output_write)
             opts.push_back("force_output_write");
+        if (opt.flags.preload_fonts)
+            opts.push_back("preload_fonts");
+        if (opt.flags.search_any_match)
+            opts.push_back("search_any");
+        if (opt.flags.profile_ops)
+            opts.push_back("profile_ops");
+        if (opt.flags.text_only)
+            opts.push_back("text_only");
+        if (opt.flags.ocr_text_only)
+            opts.push_back("ocr_text_only");
+        if (opt.flags.span_table)
+            opts.push_back("span_table");
+        if (opt.flags.mark_duplicate_text)
+            opts.push_back("mark_duplicates");
+        if (opt.flags.fast_text)
+            opts.push_back("fast_text");
+        if (opt.flags.serial_edn)
+            opts.push_back("serial_edn");
 
         if (!opts.empty()) {
             o << "   Flags:             ";
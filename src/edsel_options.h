@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 namespace pdftoedn {
 
@@ -18,21 +19,60 @@ namespace pdftoedn {
             bool libpng_use_best_compression;
             bool force_font_preprocess;
             bool force_output_write;
+            bool preload_fonts;
+            bool search_any_match;
+            bool profile_ops;
+            bool text_only;
+            bool ocr_text_only;
+            bool span_table;
+            bool mark_duplicate_text;
+            bool fast_text;
+            bool serial_edn;
         };
 
-        Options() : page_num(-1) {}
+        // region of interest in page coordinates. Page is -1 if
+        // it applies to all pages
+        struct Region {
+            Region(intmax_t pg, double rx, double ry, double w, double h) :
+                page(pg), x(rx), y(ry), width(w), height(h) {}
+
+            intmax_t page;
+            double x, y, width, height;
+        };
+
+        Options() : page_num(-1), page_cnt(-1), progress_file_desc(-1), jpeg_dpi(-1) {}
         Options(const std::string& pdf_filename,
                 const std::string& pdf_owner_password,
                 const std::string& pdf_user_password,
                 const std::string& edn_filename,
                 const std::string& font_map,
                 const Flags& f,
-                intmax_t pg_num);
+                intmax_t pg_num,
+                intmax_t pg_count = -1,
+                int progress_fd = -1,
+                const std::vector<std::string>& region_list = std::vector<std::string>(),
+                const std::vector<std::string>& search_list = std::vector<std::string>(),
+                const std::string& sqlite_db_filename = std::string(),
+                intmax_t max_jpeg_dpi = -1);
+
+        // server mode: point the options at the next request's
+        // document. Throws if the files are not valid
+        void set_document(const std::string& pdf_filename,
+                          const std::string& edn_filename,
+                          intmax_t pg_num,
+                          intmax_t pg_count);
 
         const std::string& pdf_filename() const  { return src_pdf_filename; }
         const std::string& edn_filename() const  { return out_edn_filename; }
         const std::string& outputdir() const     { return output_path; }
+        const std::string& span_table_filename() const { return span_table_file; }
+        const std::string& sqlite_db_filename() const { return sqlite_db_file; }
         intmax_t page_number() const             { return page_num; }
+        intmax_t page_count() const              { return page_cnt; }
+        int progress_fd() const                  { return progress_file_desc; }
+        intmax_t max_jpeg_dpi() const            { return jpeg_dpi; }
+        const std::vector<Region>& regions() const { return roi; }
+        const std::vector<std::string>& search_terms() const { return search; }
 
         const std::string& pdf_owner_password() const { return src_pdf_owner_password; }
         const std::string& pdf_user_password() const  { return src_pdf_user_password; }
@@ -43,12 +83,21 @@ namespace pdftoedn {
         bool omit_outline() const                { return flags.omit_outline; }
         bool use_page_crop_box() const           { return flags.use_page_crop_box; }
         bool crop_page() const                   { return flags.crop_page; }
-        bool include_invisible_text() const      { return flags.include_invisible_text; }
+        bool include_invisible_text() const      { return flags.include_invisible_text || flags.ocr_text_only; }
         bool link_output_only() const            { return flags.link_output_only; }
         bool libpng_use_best_compression() const { return flags.libpng_use_best_compression; }
         bool include_debug_info() const          { return flags.include_debug_info; }
         bool force_pre_process_fonts() const     { return flags.force_font_preprocess; }
         bool force_output_write() const          { return flags.force_output_write; }
+        bool preload_fonts() const               { return flags.preload_fonts; }
+        bool search_any_match() const            { return flags.search_any_match; }
+        bool profile_ops() const                 { return flags.profile_ops; }
+        bool text_only() const                   { return flags.text_only || flags.ocr_text_only || flags.fast_text; }
+        bool ocr_text_only() const               { return flags.ocr_text_only; }
+        bool span_table() const                  { return flags.span_table; }
+        bool mark_duplicate_text() const         { return flags.mark_duplicate_text; }
+        bool fast_text() const                   { return flags.fast_text; }
+        bool serial_edn() const                  { return flags.serial_edn; }
 
         friend std::ostream& operator<<(std::ostream& o, const Options& opt);
 
@@ -60,11 +109,21 @@ namespace pdftoedn {
         std::string font_map;
         Flags flags;
         intmax_t page_num;
+        intmax_t page_cnt;
+        int progress_file_desc;
+        intmax_t jpeg_dpi;
+        std::vector<Region> roi;
+        std::vector<std::string> search;
         std::string output_path;
         std::string resource_dir;
         std::string doc_base_name;
+        std::string span_table_file;
+        std::string sqlite_db_file;
 
         bool load_config(const std::string& new_font_map_file);
+        void check_input_file() const;
+        void check_output_file();
+        bool parse_region(const std::string& region);
     };
 
     extern pdftoedn::Options options;
@@ -48,7 +48,8 @@ namespace pdftoedn
 
     PdfFont::PdfFont(FontSource* const font_source, const FontData* const fnt_data) :
         font_src(font_source), font_data(fnt_data),
-        bold(font_data->is_bold()), italic(font_data->is_italic())
+        bold(font_data->is_bold()), italic(font_data->is_italic()),
+        remap_fail_count(0)
     {
         if (!font_data->ignore_fd()) {
             // set style based on data from font descriptors in case
@@ -127,7 +128,7 @@ namespace pdftoedn
                     msg << ", toUnicode: " << std::dec << *unicode
                         << " (" << (char) *unicode << ")";
                 std::cerr << msg.str() << std::endl;
-                unmapped_codes.insert(code);
+                unmapped_codes[code]++;
             }
 #endif
         }
@@ -184,7 +185,7 @@ namespace pdftoedn
             // this is an embedded font with no known encoding. The
             // toUnicode value could be wrong so track it to report
             // errors
-            unmapped_codes.insert(code);
+            unmapped_codes[code]++;
 
             // last resort: if there's a unicode map, hope the
             // mapping provided is right
@@ -194,23 +195,16 @@ namespace pdftoedn
                 return REMAP_UNICODE;
             }
 
-            // error
+            // error - reported per font by the FontEngine
             remapped = UNICODE_REPLACEMENT_CHAR;
-
-            std::stringstream err;
-            err << "Unhandled non-unicode character code (" << std::hex << code;
-
-            if (code > 0x21) {
-                err << ", '" << (char) code << "'";
-            }
-            err << ") in font " << font_src->font_name();
-            et.log_error( ErrorTracker::ERROR_FE_FONT_MAPPING, MODULE, err.str() );
         }
         else {
             // no toUnicode!
-            unmapped_codes.insert(code);
+            unmapped_codes[code]++;
         }
 
+        remap_fail_codes[code]++;
+        remap_fail_count++;
         return REMAP_FAIL;
     }
 
@@ -351,9 +345,16 @@ namespace pdftoedn
     //
     // debug
     std::string PdfFont::get_unmapped_codes_str() const
+    {
+        return codes_str(unmapped_codes);
+    }
+
+    //
+    // list of codes and their counts
+    std::string PdfFont::codes_str(const std::map<uint32_t, uintmax_t>& codes) const
     {
         std::stringstream codes_stream;
-        if (!unmapped_codes.empty()) {
+        if (!codes.empty()) {
             codes_stream << "[ ";
             const Encoding *e = NULL;
 
@@ -363,12 +364,12 @@ namespace pdftoedn
 
             codes_stream << std::hex;
 
-            for (uint32_t c : unmapped_codes) {
-                codes_stream << "0x" << c;
+            for (const std::pair<const uint32_t, uintmax_t>& c : codes) {
+                codes_stream << "0x" << c.first;
                 if (e) {
-                    codes_stream << " (" << e->entity(c) << ")";
+                    codes_stream << " (" << e->entity(c.first) << ")";
                 }
-                codes_stream << ' ';
+                codes_stream << std::dec << " x" << c.second << std::hex << ' ';
             }
             codes_stream << "]";
         }
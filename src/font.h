@@ -2,6 +2,7 @@
 
 #include <ostream>
 #include <set>
+#include <map>
 
 #include "base_types.h"
 #include "pdf_font_source.h"
@@ -47,6 +48,11 @@ namespace pdftoedn
         eRemapStatus remap_glyph(uint32_t code, Unicode* const unicode, uintmax_t& remapped) const;
         bool has_unmapped_codes() const { return (!unmapped_codes.empty()); }
         std::string get_unmapped_codes_str() const;
+        // number of codes that failed to remap since the last report
+        // and the list of those codes
+        uintmax_t remap_failures() const { return remap_fail_count; }
+        std::string get_remap_failures_str() const { return codes_str(remap_fail_codes); }
+        void clear_remap_failures() const { remap_fail_count = 0; remap_fail_codes.clear(); }
 
         const PdfPath* get_glyph_path(uint32_t code) const;
 
@@ -78,8 +84,12 @@ namespace pdftoedn
         const FontData* font_data;
         bool bold;
         bool italic;
-        mutable std::set<uint32_t> unmapped_codes;
+        mutable std::map<uint32_t, uintmax_t> unmapped_codes; // code -> occurrences
+        mutable uintmax_t remap_fail_count;
+        mutable std::map<uint32_t, uintmax_t> remap_fail_codes; // code -> failures since the last report
         mutable std::map<int16_t, PdfPath*> glyph_path_cache;
+
+        std::string codes_str(const std::map<uint32_t, uintmax_t>& codes) const;
     };
 
 } // namespace
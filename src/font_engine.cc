@@ -6,6 +6,7 @@
 #include <poppler/GfxFont.h>
 
 #include "font_engine.h"
+#include "font_preloader.h"
 #include "pdf_font_source.h"
 #include "pdf_output_dev.h"
 #include "font.h"
@@ -23,6 +24,10 @@ namespace pdftoedn
     FontEngine::~FontEngine()
     {
         util::delete_ptr_map_elems(fonts);
+
+        // preloaded font faces belong to the preloader's FT libraries
+        delete preloader;
+
         if (ft_lib) {
             FT_Done_FreeType(ft_lib);
         }
@@ -32,7 +37,7 @@ namespace pdftoedn
     // init freetype
     FontEngine::FontEngine(XRef *doc_xref) :
         xref(doc_xref), has_font_warnings(false),
-        ft_lib(NULL), cur_doc_font(NULL)
+        ft_lib(NULL), cur_doc_font(NULL), preloader(NULL)
     {
         FT_Library ftl;
 
@@ -81,169 +86,216 @@ namespace pdftoedn
     // looks up a font in the Font Cache.. if not found, allocates an entry
     PdfFont* FontEngine::load_font(GfxFont* gfx_font)
     {
-        GfxFontLoc *gfx_font_loc = NULL;
-        FontSource* font_src = NULL;
+        if (cur_doc_font) {
+            // if we are already looking at a font, check if we
+            // encountered any potential issues with it before
+            // updating it so we can flag the document
+            if (cur_doc_font->has_warnings()) {
+                has_font_warnings = true;
+            }
 
-        do
+            // unset the current font - it'll get re-set below
+            cur_doc_font = NULL;
+        }
+
+        // can't handle fonts of unknown type
+        GfxFontType font_type = gfx_font->getType();
+        if (font_type == fontUnknownType) {
+            std::stringstream err;
+            err << "Unsupported font type (" << util::debug::get_font_type_str(font_type) << ") for ref " << PdfRef(gfx_font->getID());
+            et.log_error(ErrorTracker::ERROR_FE_FONT_READ_UNSUPPORTED, MODULE, err.str() );
+            return NULL;
+        }
+
+        // look up the font
+        PdfFont* font = find_font(gfx_font);
+        if (!font)
         {
-            if (cur_doc_font) {
-                // if we are already looking at a font, check if we
-                // encountered any potential issues with it before
-                // updating it so we can flag the document
-                if (cur_doc_font->has_warnings()) {
-                    has_font_warnings = true;
-                }
+            // not cached.. use the preloaded source if the font was
+            // analysed up front; otherwise, read it from the document
+            FontSource* font_src = (preloader ? preloader->take(PdfRef(gfx_font->getID())) : NULL);
 
-                // unset the current font - it'll get re-set below
-                cur_doc_font = NULL;
+            if (!font_src && !(font_src = create_font_source(gfx_font))) {
+                return NULL;
             }
 
-            // can't handle Type 3 fonts
-            GfxFontType font_type = gfx_font->getType();
-            if (font_type == fontType3 || font_type == fontUnknownType) {
-                std::stringstream err;
-                err << "Unsupported font type (" << util::debug::get_font_type_str(font_type) << ") for ref " << PdfRef(gfx_font->getID());
+            // create a new font instance; try to lookup the font
+            // in our known list to see if we can do any glyph
+            // remapping
+            font = new PdfFont(font_src, doc_font_maps.check_font_map(font_src));
 
-                if (font_type == fontType3)
-                    et.log_warn(ErrorTracker::ERROR_FE_FONT_READ_UNSUPPORTED, MODULE, err.str() );
-                else
-                    et.log_error(ErrorTracker::ERROR_FE_FONT_READ_UNSUPPORTED, MODULE, err.str() );
-                return NULL;
+            fonts.insert( FontListEntry(font_src->font_ref(), font) );
+        }
+
+        // update the current font pointer and return it
+        cur_doc_font = font;
+        return font;
+    }
+
+
+    //
+    // analyse the embedded fonts before pages are processed so
+    // load_font() only needs to assemble the results
+    void FontEngine::preload_fonts(Catalog* catalog, int first, int last)
+    {
+        if (!preloader) {
+            preloader = new FontPreloader(xref);
+        }
+        preloader->preload(catalog, first, last);
+    }
+
+
+    //
+    // determine the name to use for the font
+    std::string FontEngine::get_font_name(GfxFont* gfx_font, bool is_embedded)
+    {
+        std::string font_name = sanitize_font_name( (gfx_font->getName() ? gfx_font->getName()->getCString() : "") );
+
+        if (is_embedded) {
+
+            // check the embedded font name
+            std::string embedded_name = sanitize_font_name( (gfx_font->getEmbeddedFontName() ?
+                                                             gfx_font->getEmbeddedFontName()->getCString() :
+                                                             "" ) );
+
+            // poppler modifies embedded font names to clean
+            // them up by removing the garbled prefix
+            // (e.g. AFXEAD+Helvetica) and other unwanted
+            // characters so we generally want the embedded
+            // name to properly identify an embedded
+            // font. However, docs have carried fonts where
+            // the returned embedded name does not include a
+            // suffix we also use to make it unique.
+            //
+            // So, we only substitute the font_name with the
+            // embedded_name if:
+            //
+            // 1. font_name is ""
+            //
+            // 2. There is a '+' in the embedded name at index
+            // 6 but there's not one in font_name (sometimes
+            // font_name and embedded_name return different
+            // garbled characters - we keep font_name in that
+            // case)
+            //
+            // 3. The font_name starts with the embedded name
+            // but the embedded name is a longer string (e.g.:
+            // font_name is 'TTA203EA48t00_2' but
+            // embedded_name is 'TTA203EA48t00')
+            if ( font_name.empty() ||
+                 (!embedded_name.empty() &&
+                  font_name != embedded_name &&
+                  (
+                   ((font_name.find('+') != 6) && (embedded_name.find('+') == 6)) ||
+                   ((font_name.find(embedded_name) == 0) && font_name.length() < embedded_name.length()) )
+                  )
+                 ) {
+                font_name = embedded_name;
             }
+        }
+        return font_name;
+    }
 
-            // look up the font
-            PdfFont* font = find_font(gfx_font);
-            if (!font)
-            {
-                // not cached.. locate the font in the document
-                if (!(gfx_font_loc = gfx_font->locateFont(xref, NULL))) {
-                    std::stringstream err;
-                    err << "locateFont failed for ref " << PdfRef(gfx_font->getID());
-                    et.log_error(ErrorTracker::ERROR_FE_FONT_READ, MODULE, err.str() );
-                    break;
-                }
 
-                std::string font_name = sanitize_font_name( (gfx_font->getName() ? gfx_font->getName()->getCString() : "") );
-
-                // is the font embedded?
-                if (gfx_font_loc->locType == gfxFontLocEmbedded) {
-
-                    // check the embedded font name
-                    std::string embedded_name = sanitize_font_name( (gfx_font->getEmbeddedFontName() ?
-                                                                     gfx_font->getEmbeddedFontName()->getCString() :
-                                                                     "" ) );
-
-                    // poppler modifies embedded font names to clean
-                    // them up by removing the garbled prefix
-                    // (e.g. AFXEAD+Helvetica) and other unwanted
-                    // characters so we generally want the embedded
-                    // name to properly identify an embedded
-                    // font. However, docs have carried fonts where
-                    // the returned embedded name does not include a
-                    // suffix we also use to make it unique.
-                    //
-                    // So, we only substitute the font_name with the
-                    // embedded_name if:
-                    //
-                    // 1. font_name is ""
-                    //
-                    // 2. There is a '+' in the embedded name at index
-                    // 6 but there's not one in font_name (sometimes
-                    // font_name and embedded_name return different
-                    // garbled characters - we keep font_name in that
-                    // case)
-                    //
-                    // 3. The font_name starts with the embedded name
-                    // but the embedded name is a longer string (e.g.:
-                    // font_name is 'TTA203EA48t00_2' but
-                    // embedded_name is 'TTA203EA48t00')
-                    if ( font_name.empty() ||
-                         (!embedded_name.empty() &&
-                          font_name != embedded_name &&
-                          (
-                           ((font_name.find('+') != 6) && (embedded_name.find('+') == 6)) ||
-                           ((font_name.find(embedded_name) == 0) && font_name.length() < embedded_name.length()) )
-                          )
-                         ) {
-                        font_name = embedded_name;
-                    }
+    //
+    // locate the font in the document and read its data
+    FontSource* FontEngine::create_font_source(GfxFont* gfx_font)
+    {
+        GfxFontLoc *gfx_font_loc = NULL;
+        FontSource* font_src = NULL;
+        GfxFontType font_type = gfx_font->getType();
+
+        // Type 3 glyphs are drawn by content streams so there's no
+        // font program to locate. Their name is optional
+        if (font_type == fontType3) {
+            std::string font_name = get_font_name(gfx_font, false);
+            if (font_name.empty()) {
+                std::stringstream name_stream;
+                name_stream << "[" << PdfRef(gfx_font->getID()) << "]";
+                font_name = name_stream.str();
+            }
+            return new FontSource(gfx_font, util::poppler_gfx_font_type_to_edsel(font_type),
+                                  font_name, std::string());
+        }
 
-                    // yes, read it into a buffer
-                    int buf_len;
-                    uint8_t *buf = (uint8_t*) gfx_font->readEmbFontFile(xref, &buf_len);
+        do
+        {
+            if (!(gfx_font_loc = gfx_font->locateFont(xref, NULL))) {
+                std::stringstream err;
+                err << "locateFont failed for ref " << PdfRef(gfx_font->getID());
+                et.log_error(ErrorTracker::ERROR_FE_FONT_READ, MODULE, err.str() );
+                break;
+            }
 
-                    if (!buf) {
-                        std::stringstream err;
-                        err << "readEmbFontFile failed for " << PdfRef(gfx_font->getID());
-                        et.log_error(ErrorTracker::ERROR_FE_FONT_READ, MODULE, err.str());
-                        break;
-                    }
-#if 0
-                    if (gfx_font->isCIDFont()) {
-                        std::cerr << "export font " << font_name << ", type: " << util::debug::get_font_type_str(font_type) << std::endl;
-
-                        std::ofstream file;
-                        std::string path = util::debug::expand_environment_variables("${HOME}") + "Desktop/" + font_name + util::debug::get_font_file_extension(font_type);
-                        file.open(path.c_str());
-                        file.write((const char*) buf, buf_len);
-                        file.close();
-                    }
-#endif
+            // is the font embedded?
+            bool is_embedded = (gfx_font_loc->locType == gfxFontLocEmbedded);
+            std::string font_name = get_font_name(gfx_font, is_embedded);
 
-                    // create a buffer instance to manage this data
-                    font_src = new FontSource(gfx_font,
-                                              util::poppler_gfx_font_type_to_edsel(font_type),
-                                              font_name, ft_lib, buf, buf_len);
-
-                    // galloc'd by GfxFont::readEmbFontFile() call to Stream::toUnsignedChars()
-                    gfree((void*)buf);
-
-                } else {
-                    // no.. it's a system font (gfxFontLocExternal)
-
-                    // create a file instance of the system font.
-                    // notice that font type is overridden from the
-                    // gfx_font_loc data!!
-                    font_src = new FontSource(gfx_font,
-                                              util::poppler_gfx_font_type_to_edsel(font_type), // TODO: use system type? gfx_font_loc->fontType
-                                              font_name, gfx_font_loc->path->getCString());
-
-                    #if 0
-                    if (font_src->is_cid() && !font_src->has_code_to_gid()) {
-                        std::stringstream err;
-                        err << "Document font \"" << font_name
-                            << "\" indicates it is not embedded but has type: " << util::debug::get_font_type_str(font_src->font_type())
-                            << " and lacks map table";
-                        et.log_warn(ErrorTracker::ERROR_FE_FONT_READ, MODULE, err.str());
-                    }
-                    #endif
-                }
+            if (is_embedded) {
+
+                // yes, read it into a buffer
+                int buf_len;
+                uint8_t *buf = (uint8_t*) gfx_font->readEmbFontFile(xref, &buf_len);
 
-                // check that the font was read correctly
-                if (!font_src->is_ok()) {
+                if (!buf) {
                     std::stringstream err;
-                    err << "couldn't create PdfFont entry for '" << font_name
-                        << "' - type: " << util::debug::get_font_type_str(font_type);
+                    err << "readEmbFontFile failed for " << PdfRef(gfx_font->getID());
                     et.log_error(ErrorTracker::ERROR_FE_FONT_READ, MODULE, err.str());
                     break;
                 }
+#if 0
+                if (gfx_font->isCIDFont()) {
+                    std::cerr << "export font " << font_name << ", type: " << util::debug::get_font_type_str(font_type) << std::endl;
+
+                    std::ofstream file;
+                    std::string path = util::debug::expand_environment_variables("${HOME}") + "Desktop/" + font_name + util::debug::get_font_file_extension(font_type);
+                    file.open(path.c_str());
+                    file.write((const char*) buf, buf_len);
+                    file.close();
+                }
+#endif
 
-                // create a new font instance; try to lookup the font
-                // in our known list to see if we can do any glyph
-                // remapping
-                font = new PdfFont(font_src, doc_font_maps.check_font_map(font_src));
+                // create a buffer instance to manage this data
+                font_src = new FontSource(gfx_font,
+                                          util::poppler_gfx_font_type_to_edsel(font_type),
+                                          font_name, ft_lib, buf, buf_len);
 
-                fonts.insert( FontListEntry(font_src->font_ref(), font) );
+                // galloc'd by GfxFont::readEmbFontFile() call to Stream::toUnsignedChars()
+                gfree((void*)buf);
+
+            } else {
+                // no.. it's a system font (gfxFontLocExternal)
+
+                // create a file instance of the system font.
+                // notice that font type is overridden from the
+                // gfx_font_loc data!!
+                font_src = new FontSource(gfx_font,
+                                          util::poppler_gfx_font_type_to_edsel(font_type), // TODO: use system type? gfx_font_loc->fontType
+                                          font_name, gfx_font_loc->path->getCString());
+
+                #if 0
+                if (font_src->is_cid() && !font_src->has_code_to_gid()) {
+                    std::stringstream err;
+                    err << "Document font \"" << font_name
+                        << "\" indicates it is not embedded but has type: " << util::debug::get_font_type_str(font_src->font_type())
+                        << " and lacks map table";
+                    et.log_warn(ErrorTracker::ERROR_FE_FONT_READ, MODULE, err.str());
+                }
+                #endif
             }
 
-            // update the current font pointer
-            cur_doc_font = font;
+            // check that the font was read correctly
+            if (!font_src->is_ok()) {
+                std::stringstream err;
+                err << "couldn't create PdfFont entry for '" << font_name
+                    << "' - type: " << util::debug::get_font_type_str(font_type);
+                et.log_error(ErrorTracker::ERROR_FE_FONT_READ, MODULE, err.str());
+                break;
+            }
 
-            // clean up
+            // clean up and return the source
             delete gfx_font_loc;
-
-            // and exit, returning the scaled font
-            return font;
+            return font_src;
 
         } while (0);
 
@@ -278,14 +330,42 @@ namespace pdftoedn
             return CODE_REMAPPED_BY_EDSEL;
         }
 
-        std::stringstream warn;
-        warn << __FUNCTION__ << " encountered font '" << cur_doc_font->name() << "' that may need mappings or be exported";
-        et.log_error(ErrorTracker::ERROR_FE_FONT_MAPPING, MODULE, warn.str());
+        // the failure is tracked by the font and reported once per
+        // page by report_remap_failures()
         unicode_r = code;
         return CODE_REMAP_ERROR;
     }
 
 
+    //
+    // log one error per font that had codes fail to remap since the
+    // last call, listing the codes and their counts
+    void FontEngine::report_remap_failures()
+    {
+        for (const FontListEntry& f : fonts) {
+            const PdfFont* font = f.second;
+
+            if (font->remap_failures() == 0) {
+                continue;
+            }
+
+            std::stringstream err;
+            err << "Font '" << font->name() << "' may need mappings or be exported - "
+                << font->remap_failures() << " unmapped character(s), codes: " << font->get_remap_failures_str();
+            et.log_error(ErrorTracker::ERROR_FE_FONT_MAPPING, MODULE, err.str());
+
+            font->clear_remap_failures();
+        }
+    }
+
+    void FontEngine::discard_remap_failures()
+    {
+        for (const FontListEntry& f : fonts) {
+            f.second->clear_remap_failures();
+        }
+    }
+
+
     //------------------------------------------------------------------------
     // FontEngine Device - for preprocessing doc and extrating font data
     //
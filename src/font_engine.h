@@ -26,11 +26,13 @@
 //#define FE_PREPROCESS_TEXT // collect text usage while pre-processing doc
 
 class GfxState;
+class Catalog;
 
 namespace pdftoedn
 {
     class PdfFont;
     class PdfPath;
+    class FontPreloader;
 
     typedef std::map<PdfRef, pdftoedn::PdfFont *> FontList;
     typedef std::pair<const pdftoedn::PdfRef, pdftoedn::PdfFont *> FontListEntry;
@@ -53,6 +55,13 @@ namespace pdftoedn
         // load system / embedded document font using FT
         pdftoedn::PdfFont* load_font(GfxFont* gfx_font);
 
+        // analyse the embedded fonts used by pages [first, last]
+        // (1-based) ahead of page processing
+        void preload_fonts(Catalog* catalog, int first, int last);
+
+        // cleaned up font name to use for the given font
+        static std::string get_font_name(GfxFont* gfx_font, bool is_embedded);
+
         //
         // some ops can be helped if we provide a sorted list of font
         // sizes used in a document. Since we now pre-process all text, we
@@ -72,6 +81,11 @@ namespace pdftoedn
         };
         eCodeRemapStatus get_code_unicode(CharCode code, Unicode* const u, uintmax_t& unicode);
 
+        // log the code remap failures collected since the last call
+        void report_remap_failures();
+        // or drop them, e.g., if the page is going to be read again
+        void discard_remap_failures();
+
     private:
         XRef *xref; // PDF document ref for object lookup
         bool has_font_warnings;
@@ -79,8 +93,10 @@ namespace pdftoedn
         std::set<double> font_sizes;
         FT_Library ft_lib;
         pdftoedn::PdfFont* cur_doc_font;
+        pdftoedn::FontPreloader* preloader;
 
         pdftoedn::PdfFont* find_font(GfxFont* gfx_font) const;
+        FontSource* create_font_source(GfxFont* gfx_font);
         static std::string sanitize_font_name(const std::string& name);
 
         friend std::string util::version::freetype(const FontEngine&);
@@ -105,6 +121,11 @@ namespace pdftoedn
         virtual GBool interpretType3Chars() { return gTrue; }
         virtual GBool needNonText() { return gFalse; }
 
+        // only the fonts matter - don't run Type3 CharProcs
+        virtual GBool beginType3Char(GfxState * /*state*/, double /*x*/, double /*y*/,
+                                     double /*dx*/, double /*dy*/,
+                                     CharCode /*code*/, Unicode * /*u*/, int /*uLen*/) { return gTrue; }
+
         virtual void startPage(int pageNum, GfxState *state, XRef *xref) { }
 
         // but we only care about these here
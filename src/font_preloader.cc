@@ -0,0 +1,296 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include <poppler/XRef.h>
+#include <poppler/Catalog.h>
+#include <poppler/Page.h>
+#include <poppler/Dict.h>
+#include <poppler/Object.h>
+#include <poppler/GfxFont.h>
+#include <poppler/goo/gmem.h>
+
+#include "font_preloader.h"
+#include "font_engine.h"
+#include "pdf_stats_tracker.h"
+#include "util.h"
+
+namespace pdftoedn
+{
+    // upper limit on the number of analysis threads
+    static const uintmax_t MAX_PRELOAD_THREADS = 8;
+
+    FontPreloader::FontPreloader(XRef* doc_xref) :
+        xref(doc_xref)
+    {
+    }
+
+    FontPreloader::~FontPreloader()
+    {
+        // font faces must be released before their library
+        util::delete_ptr_map_elems(sources);
+
+        for (FT_Library lib : ft_libs) {
+            FT_Done_FreeType(lib);
+        }
+    }
+
+
+    //
+    // collect the embedded fonts referenced by the pages and analyse
+    // them
+    void FontPreloader::preload(Catalog* catalog, int first, int last)
+    {
+        std::vector<Job> jobs;
+
+        for (int page_num = first; page_num <= last; ++page_num) {
+            Page* page = catalog->getPage(page_num);
+
+            if (page && page->getResourceDict()) {
+                collect_fonts(page->getResourceDict(), jobs);
+            }
+        }
+
+        if (jobs.empty()) {
+            return;
+        }
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        analyse(jobs);
+
+        // keep the sources that loaded; the FontEngine reads the
+        // others itself so any errors are reported with the page
+        // where the font is used
+        for (Job& job : jobs) {
+            if (job.font_src) {
+                if (job.font_src->is_ok()) {
+                    sources.insert( std::make_pair(job.font_src->font_ref(), job.font_src) );
+                    if (!job.diagnostics.empty()) {
+                        diagnostics[job.font_src->font_ref()].swap(job.diagnostics);
+                    }
+                } else {
+                    delete job.font_src;
+                }
+            }
+
+            // galloc'd by GfxFont::readEmbFontFile()
+            gfree(job.buf);
+            job.gfx_font->decRefCnt();
+        }
+
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        stats.add("font_preload", "fonts", sources.size());
+        stats.add("font_preload", "threads", ft_libs.size());
+        stats.add_time("font_preload", "analyse_ms", elapsed.count());
+    }
+
+
+    //
+    // take ownership of the preloaded source for the font, if any
+    FontSource* FontPreloader::take(const PdfRef& ref)
+    {
+        std::map<PdfRef, FontSource*>::iterator si = sources.find(ref);
+
+        if (si == sources.end()) {
+            return NULL;
+        }
+
+        FontSource* font_src = si->second;
+        sources.erase(si);
+
+        std::map<PdfRef, ErrorTracker::Diagnostics>::iterator di = diagnostics.find(ref);
+        if (di != diagnostics.end()) {
+            et.replay(di->second);
+            diagnostics.erase(di);
+        }
+        return font_src;
+    }
+
+
+    //
+    // read the font entries in a resource dictionary. Form XObjects
+    // carry their own resources so check those as well
+    void FontPreloader::collect_fonts(Dict* resources, std::vector<Job>& jobs)
+    {
+        Object fonts;
+        resources->lookup("Font", &fonts);
+
+        if (fonts.isDict()) {
+            for (int ii = 0; ii < fonts.dictGetLength(); ++ii) {
+                Object font_ref;
+                fonts.dictGetValNF(ii, &font_ref);
+                collect_font(fonts.dictGetKey(ii), font_ref, jobs);
+                font_ref.free();
+            }
+        }
+        fonts.free();
+
+        Object xobjs;
+        resources->lookup("XObject", &xobjs);
+
+        if (xobjs.isDict()) {
+            for (int ii = 0; ii < xobjs.dictGetLength(); ++ii) {
+                Object xobj_ref;
+                xobjs.dictGetValNF(ii, &xobj_ref);
+                collect_form_fonts(xobj_ref, jobs);
+                xobj_ref.free();
+            }
+        }
+        xobjs.free();
+    }
+
+
+    //
+    // build the GfxFont for a font reference and, if it is embedded,
+    // read its blob. Only indirect fonts are handled as those are the
+    // ones the FontEngine can match by ref
+    void FontPreloader::collect_font(const char* tag, Object& font_ref, std::vector<Job>& jobs)
+    {
+        if (!font_ref.isRef()) {
+            return;
+        }
+
+        PdfRef ref(font_ref.getRefNum(), font_ref.getRefGen());
+        if (!seen_fonts.insert(ref).second) {
+            return;
+        }
+
+        Object font_obj;
+        font_ref.fetch(xref, &font_obj);
+
+        GfxFont* gfx_font = NULL;
+        if (font_obj.isDict()) {
+            gfx_font = GfxFont::makeFont(xref, tag, font_ref.getRef(), font_obj.getDict());
+        }
+        font_obj.free();
+
+        if (!gfx_font) {
+            return;
+        }
+
+        do
+        {
+            // Type 3 fonts have no font program and system fonts
+            // are cheap to load so only embedded fonts are queued
+            GfxFontType font_type = gfx_font->getType();
+            Ref emb_id;
+
+            if (!gfx_font->isOk() ||
+                font_type == fontType3 || font_type == fontUnknownType ||
+                !gfx_font->getEmbeddedFontID(&emb_id)) {
+                break;
+            }
+
+            // FontSource logs an error if the type does not match the
+            // GfxFont class and the source is dropped - leave those to
+            // the FontEngine so it's reported once, with the page
+            bool is_cid_type = (util::poppler_gfx_font_type_to_edsel(font_type) & FontSource::FONT_TYPE_CID_MASK);
+            if (gfx_font->isCIDFont() != is_cid_type) {
+                break;
+            }
+
+            GfxFontLoc* gfx_font_loc = gfx_font->locateFont(xref, NULL);
+            bool is_embedded = (gfx_font_loc && gfx_font_loc->locType == gfxFontLocEmbedded);
+            delete gfx_font_loc;
+
+            if (!is_embedded) {
+                break;
+            }
+
+            int buf_len;
+            uint8_t* buf = (uint8_t*) gfx_font->readEmbFontFile(xref, &buf_len);
+
+            if (!buf) {
+                break;
+            }
+
+            jobs.push_back( Job(gfx_font, FontEngine::get_font_name(gfx_font, true), buf, buf_len) );
+            return;
+
+        } while (0);
+
+        gfx_font->decRefCnt();
+    }
+
+
+    //
+    // check a Form XObject's resources for fonts
+    void FontPreloader::collect_form_fonts(Object& xobj_ref, std::vector<Job>& jobs)
+    {
+        if (!xobj_ref.isRef() || !seen_xobjs.insert(xobj_ref.getRefNum()).second) {
+            return;
+        }
+
+        Object xobj;
+        xobj_ref.fetch(xref, &xobj);
+
+        if (xobj.isStream()) {
+            Dict* xobj_dict = xobj.streamGetDict();
+            Object subtype;
+            xobj_dict->lookup("Subtype", &subtype);
+
+            if (subtype.isName("Form")) {
+                Object resources;
+                xobj_dict->lookup("Resources", &resources);
+
+                if (resources.isDict()) {
+                    collect_fonts(resources.getDict(), jobs);
+                }
+                resources.free();
+            }
+            subtype.free();
+        }
+        xobj.free();
+    }
+
+
+    //
+    // create the font sources on a pool of threads. FT_Library
+    // instances can't be shared across threads so each worker gets
+    // its own
+    void FontPreloader::analyse(std::vector<Job>& jobs)
+    {
+        uintmax_t num_threads = std::max<uintmax_t>(1, std::thread::hardware_concurrency());
+        num_threads = std::min(num_threads, std::min<uintmax_t>(MAX_PRELOAD_THREADS, jobs.size()));
+
+        while (ft_libs.size() < num_threads) {
+            FT_Library lib;
+            if (FT_Init_FreeType(&lib) != 0) {
+                break;
+            }
+            ft_libs.push_back(lib);
+        }
+
+        // if FreeType can't be set up, the FontEngine will load the
+        // fonts as usual
+        if (ft_libs.empty()) {
+            return;
+        }
+
+        std::atomic<uintmax_t> next_job(0);
+        std::vector<std::thread> workers;
+
+        for (FT_Library lib : ft_libs) {
+            workers.push_back( std::thread([&jobs, &next_job, lib]() {
+                        for (uintmax_t ii = next_job++; ii < jobs.size(); ii = next_job++) {
+                            Job& job = jobs[ii];
+
+                            // FontSource and poppler's font parsers log
+                            // through the global tracker, which isn't
+                            // thread-safe
+                            ErrorTracker::Capture capture(job.diagnostics);
+                            job.font_src = new FontSource(job.gfx_font,
+                                                          util::poppler_gfx_font_type_to_edsel(job.gfx_font->getType()),
+                                                          job.name, lib, job.buf, job.buf_len);
+                        }
+                    }) );
+        }
+
+        for (std::thread& t : workers) {
+            t.join();
+        }
+    }
+
+} // namespace
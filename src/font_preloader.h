@@ -0,0 +1,80 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <set>
+#include <map>
+
+#include <freetype2/ft2build.h>
+#include FT_FREETYPE_H
+
+#include "pdf_font_source.h"
+#include "pdf_error_tracker.h"
+
+class XRef;
+class Catalog;
+class Dict;
+class Object;
+class GfxFont;
+
+namespace pdftoedn
+{
+    // -------------------------------------------------------
+    // analyses the document's embedded fonts before pages are
+    // processed. Font objects are read from the page resource
+    // dictionaries and their blobs extracted on the calling thread
+    // (poppler is not thread-safe); the FreeType load and code to GID
+    // map generation for each font is then done by a pool of worker
+    // threads, each with its own FT_Library.
+    //
+    // The FontEngine takes the resulting FontSource instances as the
+    // fonts are encountered during page processing
+    //
+    class FontPreloader
+    {
+    public:
+        FontPreloader(XRef* doc_xref);
+        ~FontPreloader();
+
+        // analyse the fonts used by pages [first, last] (1-based)
+        void preload(Catalog* catalog, int first, int last);
+
+        // hands over ownership of a preloaded font source or NULL if
+        // the font was not preloaded. Warnings raised while analysing
+        // it are logged now so they're reported with the page using
+        // the font
+        FontSource* take(const PdfRef& ref);
+
+    private:
+        struct Job {
+            Job(GfxFont* font, const std::string& font_name, uint8_t* buffer, int len) :
+                gfx_font(font), name(font_name), buf(buffer), buf_len(len), font_src(NULL)
+            { }
+
+            GfxFont* gfx_font;
+            std::string name;
+            uint8_t* buf;
+            int buf_len;
+            FontSource* font_src;
+            ErrorTracker::Diagnostics diagnostics;
+        };
+
+        XRef* xref;
+        std::vector<FT_Library> ft_libs; // one per worker - must outlive the font faces
+        std::map<PdfRef, FontSource*> sources;
+        std::map<PdfRef, ErrorTracker::Diagnostics> diagnostics;
+        std::set<PdfRef> seen_fonts;
+        std::set<int> seen_xobjs;
+
+        void collect_fonts(Dict* resources, std::vector<Job>& jobs);
+        void collect_font(const char* tag, Object& font_ref, std::vector<Job>& jobs);
+        void collect_form_fonts(Object& xobj_ref, std::vector<Job>& jobs);
+        void analyse(std::vector<Job>& jobs);
+
+        // prohibit
+        FontPreloader();
+        FontPreloader(const FontPreloader&);
+        FontPreloader& operator=(const FontPreloader&);
+    };
+
+} // namespace
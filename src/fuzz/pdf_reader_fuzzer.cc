@@ -0,0 +1,284 @@
+//
+// fuzz harness for finding inputs that make pages slow to process.
+// Built as pdftoedn_fuzzer with ./configure --enable-fuzzer; the
+// LLVMFuzzerTestOneInput entry point works with libFuzzer and with
+// AFL++'s libFuzzer driver.
+//
+// Each input is read from memory with PDFReader and written to a
+// discarding stream. The time and number of allocations of every
+// page are bucketed by powers of two into libFuzzer's extra counters
+// so inputs that make a page slower or more allocation-heavy than
+// seen before are kept in the corpus even if they don't reach new
+// code. Run with -timeout=<s> and use tests/minimize_slow_input.sh
+// to reduce a slow input into the regression corpus.
+//
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
+#include <chrono>
+#include <atomic>
+#include <new>
+#include <vector>
+#include <ostream>
+#include <streambuf>
+
+#include <boost/filesystem.hpp>
+
+#include <poppler/GlobalParams.h>
+#include <poppler/Error.h>
+#include <poppler/Object.h>
+#include <poppler/Stream.h>
+
+#include "base_types.h"
+#include "pdf_error_tracker.h"
+#include "pdf_stats_tracker.h"
+#include "pdf_reader.h"
+#include "edsel_options.h"
+#include "font_maps.h"
+#include "util_edn.h"
+#include "util_xform.h"
+
+namespace pdftoedn {
+
+    // same globals as the command-line tool
+    pdftoedn::ErrorTracker et;
+    pdftoedn::StatsTracker stats;
+    pdftoedn::Options options;
+    pdftoedn::DocFontMaps doc_font_maps;
+    pdftoedn::util::edn::WriterPool edn_writer_pool;
+
+} // namespace
+
+
+// count every allocation made by the process. All the replaceable
+// forms are provided so none bypass the count or mismatch the
+// allocator
+static std::atomic<uintmax_t> num_allocs(0);
+
+static void* counted_alloc(std::size_t size) noexcept
+{
+    ++num_allocs;
+    return std::malloc(size ? size : 1);
+}
+
+void* operator new(std::size_t size)
+{
+    void* p = counted_alloc(size);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    return counted_alloc(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    return counted_alloc(size);
+}
+
+void operator delete(void* p) noexcept                          { std::free(p); }
+void operator delete[](void* p) noexcept                        { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept   { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept             { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept           { std::free(p); }
+
+#ifdef __cpp_aligned_new
+static void* counted_aligned_alloc(std::size_t size, std::align_val_t al) noexcept
+{
+    ++num_allocs;
+    void* p = NULL;
+    std::size_t align = std::max(static_cast<std::size_t>(al), sizeof(void*));
+    if (posix_memalign(&p, align, size ? size : 1) != 0) {
+        return NULL;
+    }
+    return p;
+}
+
+void* operator new(std::size_t size, std::align_val_t al)
+{
+    void* p = counted_aligned_alloc(size, al);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void* operator new[](std::size_t size, std::align_val_t al)
+{
+    return operator new(size, al);
+}
+
+void* operator new(std::size_t size, std::align_val_t al, const std::nothrow_t&) noexcept
+{
+    return counted_aligned_alloc(size, al);
+}
+
+void* operator new[](std::size_t size, std::align_val_t al, const std::nothrow_t&) noexcept
+{
+    return counted_aligned_alloc(size, al);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept                          { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept                        { std::free(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept   { std::free(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept             { std::free(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept           { std::free(p); }
+#endif
+
+
+// per-page cost feedback
+#ifdef __linux__
+#define FUZZ_EXTRA_COUNTERS __attribute__((section("__libfuzzer_extra_counters")))
+#else
+#define FUZZ_EXTRA_COUNTERS
+#endif
+
+static const uintmax_t COST_BUCKETS = 32;
+
+FUZZ_EXTRA_COUNTERS static uint8_t page_ms_counters[COST_BUCKETS];
+FUZZ_EXTRA_COUNTERS static uint8_t page_alloc_counters[COST_BUCKETS];
+
+//
+// bump the bucket for the value's magnitude
+static void add_cost(uint8_t* counters, uintmax_t value)
+{
+    uintmax_t bucket = 0;
+    while (value && bucket < COST_BUCKETS - 1) {
+        value >>= 1;
+        ++bucket;
+    }
+
+    if (counters[bucket] < UINT8_MAX) {
+        ++counters[bucket];
+    }
+}
+
+struct PageCost {
+    typedef std::chrono::steady_clock Clock;
+
+    Clock::time_point start;
+    uintmax_t allocs;
+
+    void reset() {
+        start = Clock::now();
+        allocs = num_allocs;
+    }
+};
+
+static void page_done(uintmax_t /*page_num*/, void* data)
+{
+    PageCost* cost = static_cast<PageCost*>(data);
+
+    std::chrono::duration<double, std::milli> elapsed = PageCost::Clock::now() - cost->start;
+    add_cost(page_ms_counters, static_cast<uintmax_t>(elapsed.count()));
+    add_cost(page_alloc_counters, num_allocs - cost->allocs);
+
+    cost->reset();
+}
+
+
+//
+// throws away the output
+class NullBuf : public std::streambuf
+{
+protected:
+    virtual int_type overflow(int_type c) { return traits_type::not_eof(c); }
+    virtual std::streamsize xsputn(const char*, std::streamsize n) { return n; }
+};
+
+
+// images are written next to the (unused) output file
+static boost::filesystem::path output_dir;
+
+//
+// empty the output directory so images don't pile up across inputs
+static void clear_output_dir()
+{
+    namespace fs = boost::filesystem;
+
+    boost::system::error_code ec;
+    for (fs::directory_iterator di(output_dir, ec), end; !ec && di != end; di.increment(ec)) {
+        fs::remove_all(di->path(), ec);
+    }
+}
+
+static void remove_output_dir()
+{
+    boost::system::error_code ec;
+    boost::filesystem::remove_all(output_dir, ec);
+}
+
+
+//
+// set up the options and poppler once
+extern "C" int LLVMFuzzerInitialize(int* argc, char*** argv)
+{
+    namespace fs = boost::filesystem;
+
+    output_dir = fs::temp_directory_path() / fs::unique_path("pdftoedn-fuzz-%%%%%%%%");
+    fs::create_directories(output_dir);
+    std::atexit(&remove_output_dir);
+
+    pdftoedn::Options::Flags flags = { false };
+    flags.force_output_write = true;
+
+    // no input file - the document is read from memory
+    pdftoedn::options = pdftoedn::Options("", "", "", (output_dir / "fuzz.edn").string(),
+                                          "", flags, -1);
+
+    pdftoedn::util::xform::init_transform_lib();
+
+    globalParams = new GlobalParams();
+    globalParams->setPrintCommands(false);
+
+    setErrorCallback(&pdftoedn::ErrorTracker::error_handler, &pdftoedn::et);
+    return 0;
+}
+
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    if (size == 0) {
+        return 0;
+    }
+
+    pdftoedn::et.reset();
+    pdftoedn::stats.clear();
+
+    // MemStream doesn't copy the data and needs it to be writable
+    std::vector<char> buf(data, data + size);
+    Object dict;
+    dict.initNull();
+
+    PageCost cost;
+
+    try
+    {
+        // the document owns the stream
+        pdftoedn::PDFReader doc_reader(new MemStream(buf.data(), 0, size, &dict));
+        doc_reader.set_page_done_cbk(&page_done, &cost);
+
+        NullBuf null_buf;
+        std::ostream output(&null_buf);
+
+        cost.reset();
+        output << doc_reader;
+
+    } catch (std::exception& e) {
+        // invalid documents are expected
+    }
+
+    clear_output_dir();
+    return 0;
+}
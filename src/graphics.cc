@@ -86,6 +86,12 @@ namespace pdftoedn
     const pdftoedn::Symbol PdfDocPath::SYMBOL_ID                = "id";
     const pdftoedn::Symbol PdfDocPath::SYMBOL_CLIP_TO           = "clip_path";
 
+    const pdftoedn::Symbol PdfGlyph::SYMBOL_CODE                = "code";
+    const pdftoedn::Symbol PdfGlyphRef::SYMBOL_TYPE_GLYPH       = "glyph";
+    const pdftoedn::Symbol PdfGlyphRef::SYMBOL_GLYPH_IDX        = "glyph_idx";
+
+    static const pdftoedn::Symbol SYMBOL_GLYPH_GFX_CMDS         = "graphics";
+
     const pdftoedn::Symbol PdfMoveTo::SYMBOL_COMMAND            = "move_to";
     const pdftoedn::Symbol PdfCurveTo::SYMBOL_COMMAND           = "curve_to";
     const pdftoedn::Symbol PdfLineTo::SYMBOL_COMMAND            = "line_to";
@@ -404,6 +410,30 @@ namespace pdftoedn
     }
 
 
+    //
+    // only the color for the type of path is output
+    intmax_t PdfDocPath::color_index() const
+    {
+        if (path_type == STROKE) {
+            return attribs.stroke.color_idx;
+        }
+        if (path_type == FILL) {
+            return attribs.fill.color_idx;
+        }
+        return -1;
+    }
+
+    void PdfDocPath::set_color_index(intmax_t idx)
+    {
+        if (path_type == STROKE) {
+            attribs.stroke.color_idx = idx;
+        }
+        else if (path_type == FILL) {
+            attribs.fill.color_idx = idx;
+        }
+    }
+
+
     //
     // doc path output
     std::ostream& PdfDocPath::to_edn(std::ostream& o) const
@@ -508,4 +538,61 @@ namespace pdftoedn
         }
         return attribs_h;
     }
+
+
+    // -------------------------------------------------------
+    // Type3 glyphs
+    //
+    PdfGlyph::~PdfGlyph()
+    {
+        util::delete_ptr_container_elems(cmds);
+    }
+
+    std::ostream& PdfGlyph::to_edn(std::ostream& o) const
+    {
+        util::edn::Hash glyph_h(3);
+        glyph_h.push( SYMBOL_CODE,                  code );
+
+        util::edn::Vector cmd_a(cmds.size());
+        for (const PdfGfxCmd* c : cmds) {
+            cmd_a.push( c );
+        }
+        glyph_h.push( SYMBOL_GLYPH_GFX_CMDS,        cmd_a );
+
+        if (!cmds.empty()) {
+            glyph_h.push( BoundingBox::SYMBOL,      bounds );
+        }
+        o << glyph_h;
+        return o;
+    }
+
+    //
+    // glyph occurrences carry the glyph space to page transform as
+    // [a b c d e f]
+    std::ostream& PdfGlyphRef::to_edn(std::ostream& o) const
+    {
+        util::edn::Hash ref_h(6);
+        ref_h.push( PdfGfxCmd::SYMBOL_TYPE,                  cmd );
+        ref_h.push( SYMBOL_GLYPH_IDX,                        glyph_idx );
+
+        util::edn::Vector tm_a(6);
+        tm_a.push( ctm.a() );
+        tm_a.push( ctm.b() );
+        tm_a.push( ctm.c() );
+        tm_a.push( ctm.d() );
+        tm_a.push( ctm.e() );
+        tm_a.push( ctm.f() );
+        ref_h.push( PdfBoxedItem::SYMBOL_XFORM,              tm_a );
+        ref_h.push( BoundingBox::SYMBOL,                     bbox );
+
+        if (color_idx != -1) {
+            ref_h.push( GfxAttribs::SYMBOL_FILL_COLOR_IDX,   color_idx );
+        }
+        if (clip_path_id != -1) {
+            ref_h.push( PdfDocPath::SYMBOL_CLIP_TO,          clip_path_id );
+        }
+        o << ref_h;
+        return o;
+    }
+
 } // namespace
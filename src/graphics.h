@@ -9,6 +9,8 @@
 
 namespace pdftoedn
 {
+    class PdfFont;
+
     // -------------------------------------------------------
     // abstract gfx-type for output commands
     //
@@ -262,6 +264,11 @@ namespace pdftoedn
         bool equals(const PdfDocPath& p2) const;
 
         void set_clip_id(intmax_t id) { clip_id = id; }
+
+        // index of the color used to paint the path (-1 for clip paths)
+        intmax_t color_index() const;
+        void set_color_index(intmax_t idx);
+
         void clip_bounds(const BoundingBox& clip_bbox) { bounds.clip(clip_bbox); }
 
         virtual std::ostream& to_edn(std::ostream& o) const;
@@ -279,4 +286,82 @@ namespace pdftoedn
         util::edn::Hash& attribs_to_edn_hash(util::edn::Hash& h) const;
     };
 
+    // -------------------------------------------------------
+    // Type3 glyph definition - what a character's CharProc draws,
+    // kept in glyph space so every occurrence of the character on a
+    // page can refer to it instead of repeating the graphics
+    //
+    class PdfGlyph : public gemable
+    {
+    public:
+        static const pdftoedn::Symbol SYMBOL_CODE;
+
+        // glyph_ctm maps glyph space to the device at the occurrence
+        // that is interpreted
+        PdfGlyph(const PdfFont* glyph_font, uintmax_t glyph_code, const PdfTM& glyph_ctm) :
+            font(glyph_font), code(glyph_code), device_to_glyph(glyph_ctm.invert())
+        { }
+        virtual ~PdfGlyph();
+
+        // accessors
+        const PdfFont* font_key() const { return font; }
+        uintmax_t char_code() const { return code; }
+        const PdfTM& glyph_space() const { return device_to_glyph; }
+        bool is_empty() const { return cmds.empty(); }
+        BoundingBox bounding_box() const { return bounds.bounding_box(); }
+        std::list<PdfGfxCmd *>& commands() { return cmds; }
+        const std::list<PdfGfxCmd *>& commands() const { return cmds; }
+
+        // takes ownership of the command; bbox in glyph space
+        void add(PdfGfxCmd* cmd, const BoundingBox& bbox) {
+            cmds.push_back(cmd);
+            bounds.expand(bbox);
+        }
+
+        virtual std::ostream& to_edn(std::ostream& o) const;
+
+    private:
+        const PdfFont* font;
+        uintmax_t code;
+        PdfTM device_to_glyph;
+        Bounds bounds;
+        std::list<PdfGfxCmd *> cmds;
+    };
+
+
+    // -------------------------------------------------------
+    // an occurrence of a Type3 glyph definition. The transform maps
+    // glyph space to the page
+    //
+    class PdfGlyphRef : public PdfGfxCmd
+    {
+    public:
+        static const pdftoedn::Symbol SYMBOL_TYPE_GLYPH;
+        static const pdftoedn::Symbol SYMBOL_GLYPH_IDX;
+
+        PdfGlyphRef(uintmax_t glyph_index, const PdfTM& glyph_ctm,
+                    const BoundingBox& b, intmax_t fill_color_idx) :
+            PdfGfxCmd(SYMBOL_TYPE_GLYPH),
+            glyph_idx(glyph_index), ctm(glyph_ctm), bbox(b),
+            color_idx(fill_color_idx), clip_path_id(-1)
+        { }
+
+        // accessors
+        const BoundingBox& bounding_box() const { return bbox; }
+        intmax_t color_index() const { return color_idx; }
+        intmax_t clip_id() const { return clip_path_id; }
+
+        void set_color_index(intmax_t idx) { color_idx = idx; }
+        void set_clip_id(intmax_t clip_id) { clip_path_id = clip_id; }
+
+        virtual std::ostream& to_edn(std::ostream& o) const;
+
+    private:
+        uintmax_t glyph_idx;
+        PdfTM ctm;
+        BoundingBox bbox;
+        intmax_t color_idx; // fill color - uncolored (d1) glyphs are painted with it
+        intmax_t clip_path_id;
+    };
+
 } // namespace
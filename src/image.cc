@@ -39,21 +39,6 @@ namespace pdftoedn
     static const pdftoedn::Symbol SYMBOL_SP_INLINED          = "inlined";
     static const pdftoedn::Symbol SYMBOL_SP_UPSIDE_DOWN      = "upside_down";
     static const pdftoedn::Symbol SYMBOL_SP_INVERT           = "invert";
-    static const pdftoedn::Symbol SYMBOL_SP_FILL_COLOR       = "fill";
-    static const pdftoedn::Symbol SYMBOL_SP_FILL_CSPACE      = "fill_cs";
-    static const pdftoedn::Symbol SYMBOL_SP_COLOR_SPACE_MODES[] = {
-        "device_gray",
-        "cal_gray",
-        "device_rgb",
-        "cal_rgb",
-        "device_cmyk",
-        "lab",
-        "icc_based",
-        "indexed",
-        "separation",
-        "device_n",
-        "pattern"
-    };
 
     const pdftoedn::Symbol ImageData::SYMBOL_ID               = "id";
     const pdftoedn::Symbol ImageData::SYMBOL_INSTANCE_COUNT   = "instances";
@@ -85,16 +70,6 @@ namespace pdftoedn
         interpolate(interp), invert(m_inverted)
     { }
 
-    StreamProps::MaskAttribs::MaskAttribs(StreamKind strKind, uintmax_t w, uintmax_t h,
-                                          uint8_t pix_comps, uint8_t bpp, bool interp, bool m_inverted,
-                                          const RGBColor& m_fill, GfxColorSpaceMode fill_cs_mode) :
-        stream_type(util::poppler_stream_type_to_edsel(strKind)),
-        width(w), height(h),
-        num_pixel_comps(pix_comps), bits_per_pixel(bpp),
-        interpolate(interp), invert(m_inverted),
-        fill(m_fill), fill_cspace_mode(fill_cs_mode)
-    { }
-
     //
     // EDN output
     std::ostream& StreamProps::to_edn(std::ostream& o) const
@@ -130,11 +105,6 @@ namespace pdftoedn
             mask_str_h.push( SYMBOL_SP_PIX_COMP, mask.num_pixel_comps );
             mask_str_h.push( SYMBOL_SP_BPP, mask.bits_per_pixel );
 
-            if (type == MASK) {
-                mask_str_h.push( SYMBOL_SP_FILL_COLOR, &mask.fill );
-                mask_str_h.push( SYMBOL_SP_FILL_CSPACE, SYMBOL_SP_COLOR_SPACE_MODES[ mask.fill_cspace_mode ] );
-            }
-
             if (mask.interpolate) {
                 mask_str_h.push( SYMBOL_SP_INTERPOLATE, true );
             }
@@ -184,11 +154,14 @@ namespace pdftoedn
     std::ostream& PdfImage::to_edn(std::ostream& o) const
     {
         // image fields
-        util::edn::Hash image_h(4);
+        util::edn::Hash image_h(5);
         image_h.push( SYMBOL_TYPE,               cmd );
         image_h.push( BoundingBox::SYMBOL,       bbox );
         image_h.push( ImageData::SYMBOL_ID,      res_id );
 
+        if (color_idx != -1) {
+            image_h.push( GfxAttribs::SYMBOL_FILL_COLOR_IDX, color_idx );
+        }
         if (clip_path_id != -1) {
             image_h.push( PdfDocPath::SYMBOL_CLIP_TO, clip_path_id );
         }
@@ -34,13 +34,13 @@ namespace pdftoedn
             STREAM_TYPE_COUNT
         };
 
-        // masks
+        // masks - the fill color is carried by the PdfImage so the
+        // encoded stencil can be shared by every fill
         StreamProps(StreamKind strKind, uint32_t width, uint32_t height,
-                    const RGBColor& fill, GfxColorSpaceMode fill_cs_mode,
                     bool interpolate, bool mask_upside_down, bool str_inlined,
                     bool invert) :
             type(MASK),
-            mask(strKind, width, height, 1, 1, interpolate, invert, fill, fill_cs_mode),
+            mask(strKind, width, height, 1, 1, interpolate, invert),
             inlined(str_inlined),
             upside_down(mask_upside_down)
         { }
@@ -85,7 +85,6 @@ namespace pdftoedn
         // query methods
         bool is_inlined() const { return inlined; }
         bool mask_is_inverted() const { return mask.invert; }
-        const RGBColor& mask_fill_color() const { return mask.fill; }
 
         uintmax_t mask_width() const { return mask.width; }
         uintmax_t mask_height() const { return mask.height; }
@@ -120,9 +119,6 @@ namespace pdftoedn
             MaskAttribs() : stream_type(STREAM_UNDEF), interpolate(false), invert(false) { }
             MaskAttribs(StreamKind strKind, uintmax_t w, uintmax_t h,
                         uint8_t pix_comps, uint8_t bpp, bool interp, bool m_inverted);
-            MaskAttribs(StreamKind strKind, uintmax_t w, uintmax_t h,
-                        uint8_t pix_comps, uint8_t bpp, bool interp, bool m_inverted,
-                        const RGBColor& m_fill, GfxColorSpaceMode fill_cs_mode);
 
             stream_type_e stream_type;
             uintmax_t width, height;
@@ -130,8 +126,6 @@ namespace pdftoedn
             uint8_t bits_per_pixel;
             bool interpolate;
             bool invert;
-            RGBColor fill;
-            GfxColorSpaceMode fill_cspace_mode;
         };
 
         cmd_type_e type;
@@ -171,6 +165,9 @@ namespace pdftoedn
         // accessors
         intmax_t id() const { return res_id; }
         const std::string& md5() const { return blob_md5; }
+        uintmax_t pixel_width() const { return width; }
+        uintmax_t pixel_height() const { return height; }
+        const std::string& filename() const { return file_name; }
         void ref() const { ref_count++; }
         bool equals(int id) const { return (res_id == id); }
 
@@ -215,11 +212,19 @@ namespace pdftoedn
             PdfGfxCmd(SYMBOL_TYPE_IMAGE),
             res_id(resource_id),
             clip_path_id(-1),
+            color_idx(-1),
             bbox(b)
         {  }
 
+        intmax_t resource_id() const { return res_id; }
+        const BoundingBox& bounding_box() const { return bbox; }
+        intmax_t clip_id() const { return clip_path_id; }
         void set_clip_id(intmax_t clip_id) { clip_path_id = clip_id; }
 
+        // stencil masks are painted with the fill color; -1 for images
+        intmax_t color_index() const { return color_idx; }
+        void set_color_index(intmax_t idx) { color_idx = idx; }
+
         virtual std::ostream& to_edn(std::ostream& o) const;
 
         static const pdftoedn::Symbol SYMBOL_TYPE_IMAGE;
@@ -227,6 +232,7 @@ namespace pdftoedn
     private:
         intmax_t res_id;
         intmax_t clip_path_id;
+        intmax_t color_idx;
         BoundingBox bbox;
     };
 
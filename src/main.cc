@@ -1,7 +1,9 @@
 #include <string>
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <clocale>
+#include <csignal>
 
 #include <boost/filesystem.hpp>
 #include <boost/program_options.hpp>
@@ -14,7 +16,11 @@
 #endif
 #include "base_types.h"
 #include "pdf_error_tracker.h"
+#include "pdf_stats_tracker.h"
 #include "pdf_reader.h"
+#include "pdf_doc_cache.h"
+#include "pdf_request_scheduler.h"
+#include "pdf_request_server.h"
 #include "edsel_options.h"
 #include "font_maps.h"
 #include "util_edn.h"
@@ -28,12 +34,18 @@ namespace pdftoedn {
     // task-level error handler for poppler errors
     pdftoedn::ErrorTracker et;
 
+    // processing counters reported with the debug meta
+    pdftoedn::StatsTracker stats;
+
     // run-time options passed as args
     pdftoedn::Options options;
 
     // process-wide font maps
     pdftoedn::DocFontMaps doc_font_maps;
 
+    // threads that serialize dense pages
+    pdftoedn::util::edn::WriterPool edn_writer_pool;
+
 } // namespace
 
 
@@ -48,39 +60,87 @@ int main(int argc, char** argv)
     // parse the options
     pdftoedn::Options::Flags flags = { false };
     std::string pdf_filename, pdf_owner_password, pdf_user_password, edn_output_filename, font_map_file;
+    std::string sqlite_db_filename;
     bool show_font_list = false;
+    bool serve = false;
+    uintmax_t serve_cache_docs = 8;
+    uintmax_t serve_cache_mb = 512;
     intmax_t page_number = -1;
+    intmax_t page_count = -1;
+    int progress_fd = -1;
+    intmax_t max_jpeg_dpi = -1;
+    std::vector<std::string> regions;
+    std::vector<std::string> search_terms;
+    pdftoedn::RequestScheduler scheduler;
 
     try
     {
         namespace po = boost::program_options;
         po::options_description opts("Options");
         opts.add_options()
-            ("output_file,o",       po::value<std::string>(&edn_output_filename)->required(),
-             "REQUIRED: Destination file path to write output to.")
+            ("output_file,o",       po::value<std::string>(&edn_output_filename),
+             "REQUIRED (except with --serve): Destination file path to write output to.")
             ("use_page_crop_box,a", po::bool_switch(&flags.use_page_crop_box),
              "Use page crop box instead of media box when reading page content.")
             ("debug_meta,D",        po::bool_switch(&flags.include_debug_info),
              "Include additional debug metadata in output.")
             ("show_font_map_list,F",po::bool_switch(&show_font_list),
              "Display the configured font substitution list and exit.")
+            ("fast_text",           po::bool_switch(&flags.fast_text),
+             "Extract only text using a minimal content stream interpreter. Implies -T. Pages it can't handle are read by poppler as usual.")
             ("force_output,f"  ,    po::bool_switch(&flags.force_output_write),
              "Overwrite output file if it exists.")
             ("invisible_text,i",    po::bool_switch(&flags.include_invisible_text),
              "Include invisible text in output (for use with OCR'd documents).")
             ("links_only,l",        po::bool_switch(&flags.link_output_only),
              "Extract only link data.")
+            ("preload_fonts,L",     po::bool_switch(&flags.preload_fonts),
+             "Analyse the document's embedded fonts in parallel before processing pages.")
             ("font_map_file,m",     po::value<std::string>(&font_map_file),
              "JSON font mapping configuration file to use for this run.")
+            ("mark_duplicate_text", po::bool_switch(&flags.mark_duplicate_text),
+             "Keep text drawn over an identical run (e.g., faux-bold) and mark it with :duplicate instead of dropping it.")
+            ("max_jpeg_dpi",        po::value<intmax_t>(&max_jpeg_dpi),
+             "Decode JPEG (DCTDecode) images at the smallest 1/2, 1/4, or 1/8 scale that still gives at least this resolution on the page.")
+            ("num_pages,n",         po::value<intmax_t>(&page_count),
+             "Number of pages to extract, starting at the page given by -p (or the first page).")
+            ("ocr_text_only",       po::bool_switch(&flags.ocr_text_only),
+             "Extract only invisible (OCR) text; images and vector content are skipped.")
             ("omit_outline,O",      po::bool_switch(&flags.omit_outline),
              "Don't extract outline data.")
             ("page_number,p",       po::value<intmax_t>(&page_number),
              "Extract data for only this page.")
+            ("profile_ops",         po::bool_switch(&flags.profile_ops),
+             "Profile the content stream operators on each page and include the timings in the output.")
+            ("progress_fd",         po::value<int>(&progress_fd),
+             "Write a JSON progress line to this file descriptor as each page is completed.")
+            ("region,r",            po::value<std::vector<std::string> >(&regions)->composing(),
+             "Only extract content inside this region, given as [page:]x,y,width,height in page coordinates. May be repeated.")
+            ("search,S",            po::value<std::vector<std::string> >(&search_terms)->composing(),
+             "Only report where this term is found in the text. Terms wrapped in slashes (/.../) are regular expressions. May be repeated.")
+            ("search_any",          po::bool_switch(&flags.search_any_match),
+             "Report only the first match of each search term and stop once all have been found.")
+            ("serve",               po::bool_switch(&serve),
+             "Read requests for documents and page ranges from standard input, one per line, keeping recently used documents open between them.")
+            ("serve_cache_docs",    po::value<uintmax_t>(&serve_cache_docs),
+             "Maximum number of documents kept open in server mode (default 8).")
+            ("serve_cache_mb",      po::value<uintmax_t>(&serve_cache_mb),
+             "Maximum combined size, in MB, of the documents kept open in server mode (default 512).")
+            ("serve_lane",          po::value<std::vector<std::string> >()->composing(),
+             "Server mode request lane, given as name:weight:limit. Lanes get pages in proportion to their weights and at most limit of their requests are in progress at once. May be repeated (default interactive:4:4 and bulk:1:1).")
+            ("serial_edn",          po::bool_switch(&flags.serial_edn),
+             "Write the output of dense pages on a single thread.")
+            ("span_table",          po::bool_switch(&flags.span_table),
+             "Also write the text spans as an Arrow IPC table (<output name>.spans.arrow) next to the output file.")
+            ("sqlite_db",           po::value<std::string>(&sqlite_db_filename),
+             "Also insert the document's pages, fonts, spans, paths, images, and links into the given SQLite database, with an R*Tree index of their bounding boxes.")
             ("owner_password,t",    po::value<std::string>(&pdf_owner_password),
              "PDF owner password if document is encrypted.")
+            ("text_only,T",         po::bool_switch(&flags.text_only),
+             "Extract only text; images and vector content are skipped.")
             ("user_password,u",     po::value<std::string>(&pdf_user_password),
              "PDF user password if document is encrypted.")
-            ("filename",            po::value<std::string>(&pdf_filename)->required(),
+            ("filename",            po::value<std::string>(&pdf_filename),
              "PDF document to process.")
             ("version,v",
              "Display version information and exit.")
@@ -116,6 +176,80 @@ int main(int argc, char** argv)
                     return pdftoedn::ErrorTracker::CODE_INIT_ERROR;
                 }
             }
+            if ( vm.count("num_pages")) {
+                intmax_t n = vm["num_pages"].as<intmax_t>();
+                if (n < 1) {
+                    std::cout << "Invalid number of pages " << n << std::endl;
+                    return pdftoedn::ErrorTracker::CODE_INIT_ERROR;
+                }
+            }
+            if ( vm.count("progress_fd")) {
+                int fd = vm["progress_fd"].as<int>();
+                if (fd < 0) {
+                    std::cout << "Invalid progress file descriptor " << fd << std::endl;
+                    return pdftoedn::ErrorTracker::CODE_INIT_ERROR;
+                }
+
+                // a reader that closes its end early must not kill
+                // the run - the writer sees EPIPE and stops reporting
+                signal(SIGPIPE, SIG_IGN);
+            }
+            if ( vm.count("max_jpeg_dpi")) {
+#ifdef HAVE_LIBJPEG
+                intmax_t dpi = vm["max_jpeg_dpi"].as<intmax_t>();
+                if (dpi < 1) {
+                    std::cout << "Invalid JPEG resolution " << dpi << std::endl;
+                    return pdftoedn::ErrorTracker::CODE_INIT_ERROR;
+                }
+#else
+                std::cout << "Scaled JPEG decoding is not available - pdftoedn was built without libjpeg" << std::endl;
+                return pdftoedn::ErrorTracker::CODE_INIT_ERROR;
+#endif
+            }
+#ifndef HAVE_SQLITE3
+            if ( vm.count("sqlite_db")) {
+                std::cout << "SQLite output is not available - pdftoedn was built without sqlite3" << std::endl;
+                return pdftoedn::ErrorTracker::CODE_INIT_ERROR;
+            }
+#endif
+            if ( vm.count("search") && vm["links_only"].as<bool>()) {
+                std::cout << "Search terms can't be combined with links-only output" << std::endl;
+                return pdftoedn::ErrorTracker::CODE_INIT_ERROR;
+            }
+            if ( vm["serve"].as<bool>()) {
+                if (vm.count("filename") || vm.count("output_file") ||
+                    vm.count("page_number") || vm.count("num_pages")) {
+                    std::cout << "The document, output file, and pages are given with each request in server mode" << std::endl;
+                    return pdftoedn::ErrorTracker::CODE_INIT_ERROR;
+                }
+                if (vm.count("serve_cache_docs") && vm["serve_cache_docs"].as<uintmax_t>() < 1) {
+                    std::cout << "Invalid document cache size" << std::endl;
+                    return pdftoedn::ErrorTracker::CODE_INIT_ERROR;
+                }
+                if (vm.count("serve_lane")) {
+                    for (const std::string& lane : vm["serve_lane"].as<std::vector<std::string> >()) {
+                        if (!scheduler.add_lane(lane)) {
+                            std::cout << "Invalid server lane '" << lane << "' - expected a unique name:weight:limit" << std::endl;
+                            return pdftoedn::ErrorTracker::CODE_INIT_ERROR;
+                        }
+                    }
+                } else {
+                    scheduler.add_lane("interactive:4:4");
+                    scheduler.add_lane("bulk:1:1");
+                }
+            } else {
+                if (vm.count("serve_lane")) {
+                    std::cout << "Request lanes can only be set in server mode" << std::endl;
+                    return pdftoedn::ErrorTracker::CODE_INIT_ERROR;
+                }
+                // only required when processing a single document
+                if (!vm.count("filename")) {
+                    throw po::required_option("--filename");
+                }
+                if (!vm.count("output_file")) {
+                    throw po::required_option("--output_file");
+                }
+            }
             po::notify(vm);
         }
         catch (po::error& e) {
@@ -139,6 +273,7 @@ int main(int argc, char** argv)
         // expand the paths if they start with ~
         pdftoedn::util::fs::expand_path(pdf_filename);
         pdftoedn::util::fs::expand_path(edn_output_filename);
+        pdftoedn::util::fs::expand_path(sqlite_db_filename);
 
         pdftoedn::options = pdftoedn::Options(pdf_filename,
                                               pdf_owner_password,
@@ -146,7 +281,13 @@ int main(int argc, char** argv)
                                               edn_output_filename,
                                               font_map_file,
                                               flags,
-                                              (page_number >= 0 ? page_number : -1));
+                                              (page_number >= 0 ? page_number : -1),
+                                              (page_count >= 1 ? page_count : -1),
+                                              progress_fd,
+                                              regions,
+                                              search_terms,
+                                              sqlite_db_filename,
+                                              max_jpeg_dpi);
     }
     catch (std::exception& e) {
         std::cout << e.what() << std::endl;
@@ -163,7 +304,7 @@ int main(int argc, char** argv)
     pdftoedn::util::xform::init_transform_lib();
 
     globalParams = new GlobalParams();
-    globalParams->setProfileCommands(false);
+    globalParams->setProfileCommands(pdftoedn::options.profile_ops() ? gTrue : gFalse);
     globalParams->setPrintCommands(false);
 
     // register the error handler for this document
@@ -172,28 +313,35 @@ int main(int argc, char** argv)
     uintmax_t status = 0;
     try
     {
-        // open the doc using arguments in Options - this step reads
-        // general properties from the doc (num pages, PDF version) and
-        // the outline
-        pdftoedn::PDFReader doc_reader;
-
-        std::ofstream output;
-        output.open(pdftoedn::options.edn_filename().c_str());
-
-        if (!output.is_open()) {
-            std::stringstream err;
-            err << pdftoedn::options.edn_filename() << "Cannot open file for write";
-            throw pdftoedn::invalid_file(err.str());
-        }
+        if (serve) {
+            // requests report their own status - documents are closed
+            // when the cache goes out of scope
+            pdftoedn::DocCache doc_cache(serve_cache_docs, serve_cache_mb * 1024 * 1024);
+            pdftoedn::serve_requests(std::cin, std::cout, doc_cache, scheduler);
+        } else {
+            // open the doc using arguments in Options - this step reads
+            // general properties from the doc (num pages, PDF version) and
+            // the outline
+            pdftoedn::PDFReader doc_reader;
+
+            std::ofstream output;
+            output.open(pdftoedn::options.edn_filename().c_str());
+
+            if (!output.is_open()) {
+                std::stringstream err;
+                err << pdftoedn::options.edn_filename() << "Cannot open file for write";
+                throw pdftoedn::invalid_file(err.str());
+            }
 
-        // write the document data
-        output << doc_reader;
+            // write the document data
+            output << doc_reader;
 
-        // done
-        output.close();
+            // done
+            output.close();
 
-        // set the exit code based on the logged errors
-        status = pdftoedn::et.exit_code();
+            // set the exit code based on the logged errors
+            status = pdftoedn::et.exit_code();
+        }
 
     } catch (std::exception& e) {
         std::cout << e.what() << std::endl;
@@ -0,0 +1,221 @@
+#include <poppler/poppler-config.h>
+#include <poppler/goo/GooString.h>
+#include <poppler/Function.h>
+
+#include "pdf_color_cache.h"
+#include "pdf_stats_tracker.h"
+
+namespace pdftoedn
+{
+    //
+    // converts the color, looking it up first if its space is one
+    // worth caching
+    void ColorCache::get_rgb(GfxColorSpace* cspace, const GfxColor* color, GfxRGB* rgb)
+    {
+        Key key;
+
+        switch (cspace->getMode())
+        {
+          case csICCBased:
+          case csSeparation:
+          case csDeviceN:
+              {
+                  const Description& d = description(cspace);
+                  if (d.cacheable) {
+                      key.cspace = d.cspace;
+                      break;
+                  }
+              }
+              // fall through
+          default:
+              cspace->getRGB(const_cast<GfxColor*>(color), rgb);
+              return;
+        }
+
+        key.comps.assign(color->c, color->c + cspace->getNComps());
+
+        std::unordered_map<Key, GfxRGB, KeyHash>::const_iterator it = entries.find(key);
+        if (it != entries.end()) {
+            *rgb = it->second;
+            hits++;
+            return;
+        }
+
+        cspace->getRGB(const_cast<GfxColor*>(color), rgb);
+        misses++;
+
+        // documents with continuous tints could grow this without
+        // bound. Start over instead of tracking use
+        if (entries.size() >= MAX_ENTRIES) {
+            entries.clear();
+        }
+        entries[key] = *rgb;
+    }
+
+
+    //
+    // returns the space's description, building it the first time
+    // the space is seen
+    const ColorCache::Description& ColorCache::description(GfxColorSpace* cspace)
+    {
+        std::unordered_map<const GfxColorSpace*, Description>::iterator it = described.find(cspace);
+        if (it != described.end()) {
+            return it->second;
+        }
+
+        Description& d = described[cspace];
+        d.cacheable = describe(cspace, d.cspace);
+        return d;
+    }
+
+
+    //
+    // builds a string identifying the conversion done by the
+    // space. Returns false if it can't be described, in which case
+    // colors are not cached
+    bool ColorCache::describe(GfxColorSpace* cspace, std::string& desc)
+    {
+        switch (cspace->getMode())
+        {
+          case csDeviceGray:
+          case csDeviceRGB:
+          case csDeviceCMYK:
+              desc += static_cast<char>('0' + cspace->getMode());
+              return true;
+
+          case csICCBased:
+#ifdef USE_CMS
+              // converted using the profile, which we can't identify
+              return false;
+#else
+              // poppler converts through the alternate space
+              desc += 'I';
+              return describe(static_cast<GfxICCBasedColorSpace*>(cspace)->getAlt(), desc);
+#endif
+
+          case csSeparation:
+              {
+                  // separations with the same colorant can use
+                  // different tint transforms so the function is
+                  // part of the key
+                  GfxSeparationColorSpace* sep = static_cast<GfxSeparationColorSpace*>(cspace);
+                  desc += 'S';
+                  desc += sep->getName()->getCString();
+                  desc += '\0';
+                  return (describe_func(sep->getFunc(), desc) &&
+                          describe(sep->getAlt(), desc));
+              }
+
+          case csDeviceN:
+              {
+                  GfxDeviceNColorSpace* dev_n = static_cast<GfxDeviceNColorSpace*>(cspace);
+                  desc += 'N';
+                  for (int i = 0; i < dev_n->getNComps(); ++i) {
+                      desc += dev_n->getColorantName(i)->getCString();
+                      desc += '\0';
+                  }
+                  return (describe_func(dev_n->getTintTransformFunc(), desc) &&
+                          describe(dev_n->getAlt(), desc));
+              }
+
+          default:
+              break;
+        }
+        return false;
+    }
+
+
+    //
+    // appends the function's type and parameters. Sampled functions
+    // return false - comparing their tables would cost more than
+    // the conversion
+    bool ColorCache::describe_func(Function* func, std::string& desc)
+    {
+        if (!func) {
+            return false;
+        }
+
+        desc += static_cast<char>('0' + func->getType());
+        for (int i = 0; i < func->getInputSize(); ++i) {
+            append(desc, func->getDomainMin(i));
+            append(desc, func->getDomainMax(i));
+        }
+        if (func->getHasRange()) {
+            for (int i = 0; i < func->getOutputSize(); ++i) {
+                append(desc, func->getRangeMin(i));
+                append(desc, func->getRangeMax(i));
+            }
+        }
+
+        switch (func->getType())
+        {
+          case 2:
+              {
+                  ExponentialFunction* exp = static_cast<ExponentialFunction*>(func);
+                  for (int i = 0; i < func->getOutputSize(); ++i) {
+                      append(desc, exp->getC0()[i]);
+                      append(desc, exp->getC1()[i]);
+                  }
+                  append(desc, exp->getE());
+                  return true;
+              }
+
+          case 3:
+              {
+                  StitchingFunction* st = static_cast<StitchingFunction*>(func);
+                  int k = st->getNumFuncs();
+                  for (int i = 0; i <= k; ++i) {
+                      append(desc, st->getBounds()[i]);
+                  }
+                  for (int i = 0; i < 2 * k; ++i) {
+                      append(desc, st->getEncode()[i]);
+                  }
+                  for (int i = 0; i < k; ++i) {
+                      if (!describe_func(st->getFunc(i), desc)) {
+                          return false;
+                      }
+                  }
+                  return true;
+              }
+
+          case 4:
+              {
+                  GooString* code = static_cast<PostScriptFunction*>(func)->getCodeString();
+                  desc.append(code->getCString(), code->getLength());
+                  desc += '\0';
+                  return true;
+              }
+
+          default:
+              break;
+        }
+        return false;
+    }
+
+    void ColorCache::append(std::string& desc, double v)
+    {
+        desc.append(reinterpret_cast<const char*>(&v), sizeof(v));
+    }
+
+
+    std::size_t ColorCache::KeyHash::operator()(const Key& k) const
+    {
+        std::size_t h = std::hash<std::string>()(k.cspace);
+        for (GfxColorComp c : k.comps) {
+            h = h * 31 + static_cast<std::size_t>(c);
+        }
+        return h;
+    }
+
+
+    void ColorCache::report_stats()
+    {
+        if (hits + misses == 0) {
+            return;
+        }
+        stats.add("color_cache", "hits", hits);
+        stats.add("color_cache", "misses", misses);
+        hits = misses = 0;
+    }
+
+} // namespace
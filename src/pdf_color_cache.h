@@ -0,0 +1,73 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include <poppler/GfxState.h>
+
+namespace pdftoedn
+{
+    // -------------------------------------------------------
+    // memoizes the RGB conversion of fill and stroke colors set in
+    // ICCBased, Separation, and DeviceN spaces. Those run a tint
+    // transform function or profile for every color operator while
+    // documents typically only use a handful of distinct colors.
+    //
+    // Poppler parses a new GfxColorSpace each time one is selected
+    // so entries are keyed on a description of the space (mode,
+    // colorant names, tint transform, alternate space) and the
+    // component values instead of the object's address. Spaces with
+    // sampled tint transforms are not cached. Device spaces are
+    // converted directly as it's cheaper than the lookup. The
+    // description is built once per space object and kept until
+    // forget_spaces() is called.
+    //
+    class ColorCache
+    {
+    public:
+        enum { MAX_ENTRIES = 4096 };
+
+        ColorCache() : hits(0), misses(0) {}
+
+        void get_rgb(GfxColorSpace* cspace, const GfxColor* color, GfxRGB* rgb);
+
+        // drops the descriptions kept by space address. Must be
+        // called whenever poppler may have freed a space: color
+        // space changes, state restores, and page starts
+        void forget_spaces() { described.clear(); }
+
+        // adds the hit & miss counts since the last call to the
+        // document stats
+        void report_stats();
+
+    private:
+        struct Key {
+            std::string cspace;
+            std::vector<GfxColorComp> comps;
+
+            bool operator==(const Key& k) const {
+                return (comps == k.comps && cspace == k.cspace);
+            }
+        };
+        struct KeyHash {
+            std::size_t operator()(const Key& k) const;
+        };
+
+        struct Description {
+            bool cacheable;
+            std::string cspace;
+        };
+
+        std::unordered_map<Key, GfxRGB, KeyHash> entries;
+        std::unordered_map<const GfxColorSpace*, Description> described;
+        uintmax_t hits;
+        uintmax_t misses;
+
+        const Description& description(GfxColorSpace* cspace);
+        static bool describe(GfxColorSpace* cspace, std::string& desc);
+        static bool describe_func(Function* func, std::string& desc);
+        static void append(std::string& desc, double v);
+    };
+
+} // namespace
@@ -0,0 +1,144 @@
+#include <algorithm>
+
+#include <boost/filesystem.hpp>
+
+#include "pdf_doc_cache.h"
+#include "pdf_reader.h"
+#include "pdf_stats_tracker.h"
+#include "edsel_options.h"
+
+namespace pdftoedn
+{
+    DocCache::DocCache(uintmax_t max_documents, uintmax_t max_bytes) :
+        max_docs(max_documents), max_mem(max_bytes), mem(0)
+    {
+    }
+
+    DocCache::~DocCache()
+    {
+        while (!entries.empty()) {
+            erase(entries.begin());
+        }
+    }
+
+
+    //
+    // look up the document, reopening it if it changed on disk
+    PDFReader* DocCache::get(bool& cached)
+    {
+        namespace fs = boost::filesystem;
+
+        fs::path pdf_path = fs::canonical(pdftoedn::options.pdf_filename());
+        std::string filename = pdf_path.string();
+        std::time_t mtime = fs::last_write_time(pdf_path);
+        uintmax_t size = fs::file_size(pdf_path);
+        const std::string& owner_pw = pdftoedn::options.pdf_owner_password();
+        const std::string& user_pw = pdftoedn::options.pdf_user_password();
+
+        std::list<Entry*>::iterator it = find(filename, owner_pw, user_pw);
+        if (it != entries.end()) {
+            if ((*it)->in_use) {
+                // a paused request is reading it - open another one
+                // that is deleted when released
+                stats.add("doc_cache", "in_use");
+                cached = false;
+                return new PDFReader;
+            }
+
+            if ((*it)->mtime == mtime && (*it)->size == size) {
+                // move it to the front
+                entries.splice(entries.begin(), entries, it);
+                entries.front()->in_use = true;
+                stats.add("doc_cache", "hits");
+                cached = true;
+                return entries.front()->reader;
+            }
+
+            // stale
+            erase(it);
+            stats.add("doc_cache", "invalidated");
+        }
+
+        // throws if poppler fails to open it
+        PDFReader* reader = new PDFReader;
+
+        entries.push_front( new Entry(filename, owner_pw, user_pw, mtime, size, reader) );
+        mem += size;
+        stats.add("doc_cache", "misses");
+
+        evict();
+
+        cached = false;
+        return reader;
+    }
+
+
+    //
+    // make the reader available again or drop it
+    void DocCache::release(PDFReader* reader, bool drop)
+    {
+        std::list<Entry*>::iterator it = find(reader);
+        if (it == entries.end()) {
+            // not cached
+            delete reader;
+            return;
+        }
+
+        if (drop) {
+            erase(it);
+            return;
+        }
+
+        (*it)->in_use = false;
+        evict();
+    }
+
+
+    std::list<DocCache::Entry*>::iterator DocCache::find(const std::string& filename,
+                                                         const std::string& owner_pw,
+                                                         const std::string& user_pw)
+    {
+        return std::find_if( entries.begin(), entries.end(),
+                             [&](const Entry* e) {
+                                 return (e->filename == filename &&
+                                         e->owner_password == owner_pw &&
+                                         e->user_password == user_pw);
+                             }
+                             );
+    }
+
+    std::list<DocCache::Entry*>::iterator DocCache::find(const PDFReader* reader)
+    {
+        return std::find_if( entries.begin(), entries.end(),
+                             [&](const Entry* e) { return e->reader == reader; }
+                             );
+    }
+
+    void DocCache::erase(std::list<Entry*>::iterator it)
+    {
+        mem -= (*it)->size;
+        delete (*it)->reader;
+        delete *it;
+        entries.erase(it);
+    }
+
+
+    //
+    // drop least recently used documents until the limits are met.
+    // The most recent one is always kept, even if it is larger than
+    // the memory limit on its own, and so are the ones in use
+    void DocCache::evict()
+    {
+        std::list<Entry*>::iterator it = entries.end();
+        while (it != entries.begin() &&
+               (entries.size() > max_docs || mem > max_mem)) {
+            --it;
+            if (it == entries.begin() || (*it)->in_use) {
+                continue;
+            }
+            erase(it++);
+            stats.add("doc_cache", "evictions");
+        }
+    }
+
+} // namespace
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <string>
+#include <list>
+#include <ctime>
+
+namespace pdftoedn
+{
+    class PDFReader;
+
+    // -------------------------------------------------------
+    // keeps recently used documents open in server mode so requests
+    // for other page ranges of the same file reuse the parsed XRef,
+    // outline, and loaded fonts.
+    //
+    // Entries are dropped, least recently used first, once there are
+    // more than the maximum number of documents or their combined
+    // size goes over the memory limit. The file size is used as the
+    // estimate of each document's footprint. Documents are reopened
+    // if the file's modification time or size changed. The passwords
+    // are part of the key so an encrypted document is only reused by
+    // requests that would have been able to open it.
+    //
+    // A reader is reserved by get() until it is released so a
+    // request paused between pages keeps its document and reading
+    // state. Reserved documents are not evicted and another request
+    // for one gets a separate, uncached reader.
+    //
+    class DocCache
+    {
+    public:
+        DocCache(uintmax_t max_documents, uintmax_t max_bytes);
+        ~DocCache();
+
+        // returns the reader for the document set in the options,
+        // opening it if needed. Throws if the document can't be
+        // opened
+        PDFReader* get(bool& cached);
+
+        // done with a reader returned by get(). The document is
+        // dropped if requested, e.g., after a processing error
+        void release(PDFReader* reader, bool drop = false);
+
+        uintmax_t size() const { return entries.size(); }
+
+    private:
+        struct Entry {
+            Entry(const std::string& path, const std::string& owner_pw, const std::string& user_pw,
+                  std::time_t mod_time, uintmax_t file_size, PDFReader* doc) :
+                filename(path), owner_password(owner_pw), user_password(user_pw),
+                mtime(mod_time), size(file_size), reader(doc), in_use(true) {}
+
+            std::string filename;
+            std::string owner_password;
+            std::string user_password;
+            std::time_t mtime;
+            uintmax_t size;
+            PDFReader* reader;
+            bool in_use;
+        };
+
+        std::list<Entry*> entries; // most recently used first
+        uintmax_t max_docs;
+        uintmax_t max_mem;
+        uintmax_t mem;
+
+        std::list<Entry*>::iterator find(const std::string& filename, const std::string& owner_pw,
+                                         const std::string& user_pw);
+        std::list<Entry*>::iterator find(const PDFReader* reader);
+        void erase(std::list<Entry*>::iterator it);
+        void evict();
+
+        // prohibit
+        DocCache();
+        DocCache(const DocCache&);
+        DocCache& operator=(const DocCache&);
+    };
+
+} // namespace
@@ -53,6 +53,8 @@ namespace pdftoedn
     const Symbol ErrorTracker::error::SYMBOL_DESC        = "desc";
     const Symbol ErrorTracker::error::SYMBOL_COUNT       = "count";
 
+    thread_local ErrorTracker::Diagnostics* ErrorTracker::captured = NULL;
+
 
     //
     // output error as EDN
@@ -153,6 +155,13 @@ namespace pdftoedn
     // add an entry to the list
     void ErrorTracker::log(error_type e, error::level l, const std::string& module, const std::string& msg)
     {
+        // collected on a worker thread - nothing shared is touched
+        if (captured) {
+            Diagnostic d = { e, l, module, msg };
+            captured->push_back(d);
+            return;
+        }
+
         if (error_muted(e)) {
             // don't log if it has been muted
             return;
@@ -181,6 +190,15 @@ namespace pdftoedn
         }
     }
 
+    //
+    // log the entries collected by a Capture
+    void ErrorTracker::replay(const Diagnostics& diagnostics)
+    {
+        for (const Diagnostic& d : diagnostics) {
+            log(d.type, d.lvl, d.mod, d.msg);
+        }
+    }
+
     //
     // purge the list of errors
     void ErrorTracker::flush_errors()
@@ -2,6 +2,7 @@
 
 #include <string>
 #include <list>
+#include <vector>
 #include <stdexcept>
 
 #ifdef __clang__
@@ -132,10 +133,34 @@ namespace pdftoedn
             log(e, error::L_CRITICAL, mod, msg);
         }
 
+        // log() calls made on a thread while a Capture is in scope
+        // are collected in the given list instead of being added to
+        // the tracker (this includes poppler errors). Worker threads
+        // use this so the main thread can report them with replay()
+        struct Diagnostic {
+            error_type type;
+            error::level lvl;
+            std::string mod;
+            std::string msg;
+        };
+        typedef std::vector<Diagnostic> Diagnostics;
+
+        struct Capture {
+            Capture(Diagnostics& diagnostics) : prev(captured) { captured = &diagnostics; }
+            ~Capture() { captured = prev; }
+
+        private:
+            Diagnostics* prev;
+        };
+
+        void replay(const Diagnostics& diagnostics);
+
         uint8_t exit_code() const { return exit_code_flags; }
         bool errors_reported() const;
         bool errors_or_warnings_reported() const { return !errors.empty(); }
         void flush_errors();
+        // clear errors and the exit code between server-mode requests
+        void reset() { flush_errors(); exit_code_flags = 0; }
 
         virtual std::ostream& to_edn(std::ostream& o) const;
 
@@ -148,6 +173,8 @@ namespace pdftoedn
         std::list<error *> errors;
         std::list<error_type> ignore_errors;
 
+        static thread_local Diagnostics* captured;
+
         void set_error_code(error_type e);
         bool error_muted(error_type e) const;
     };
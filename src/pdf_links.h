@@ -65,6 +65,9 @@ namespace pdftoedn
             ACTION_LAUNCH,
         };
 
+        type_e action_type() const { return type; }
+        const BoundingBox& bounding_box() const { return bbox; }
+
         // is the given point within this link? ideally should be the
         // center of a bbox
         bool encloses(const Coord& center) const {
@@ -107,6 +110,8 @@ namespace pdftoedn
     public:
         static const pdftoedn::Symbol SYMBOL_DEST;
 
+        const std::string& destination() const { return dest; }
+
     protected:
         PdfAnnotLinkDest(type_e action_type,
                          double x1, double y1, double x2, double y2,
@@ -135,6 +140,8 @@ namespace pdftoedn
             page(link_page)
         { }
 
+        uintmax_t target_page() const { return page; }
+
         virtual std::ostream& to_edn(std::ostream& o) const;
 
         static const pdftoedn::Symbol SYMBOL_PAGE;
@@ -0,0 +1,115 @@
+#include <algorithm>
+#include <vector>
+
+#include <poppler/goo/GooHash.h>
+#include <poppler/goo/GooString.h>
+#include <poppler/ProfileData.h>
+
+#include "pdf_op_profiler.h"
+#include "util_edn.h"
+
+namespace pdftoedn
+{
+    const Symbol OpProfiler::SYMBOL_OP_PROFILE = "op_profile";
+
+    static const pdftoedn::Symbol SYMBOL_PAGES       = "pages";
+    static const pdftoedn::Symbol SYMBOL_PAGE_NUMBER = "pgnum";
+    static const pdftoedn::Symbol SYMBOL_OPS         = "ops";
+    static const pdftoedn::Symbol SYMBOL_TOP         = "top";
+    static const pdftoedn::Symbol SYMBOL_OP          = "op";
+    static const pdftoedn::Symbol SYMBOL_COUNT       = "count";
+    static const pdftoedn::Symbol SYMBOL_MS          = "ms";
+    static const pdftoedn::Symbol SYMBOL_MAX_MS      = "max_ms";
+
+    // number of operators listed in the document summary
+    static const uintmax_t TOP_N_OPS = 10;
+
+    void OpProfiler::OpTimes::add(uintmax_t n, double total_ms, double op_max_ms)
+    {
+        count += n;
+        ms += total_ms;
+        max_ms = std::max(max_ms, op_max_ms);
+    }
+
+
+    //
+    // poppler times are in seconds
+    void OpProfiler::add_page(uintmax_t page_num, GooHash* profile)
+    {
+        if (!profile) {
+            return;
+        }
+
+        pages.push_back( std::make_pair(page_num, OpMap()) );
+        OpMap& page_ops = pages.back().second;
+
+        GooHashIter* iter;
+        GooString* op;
+        void* val;
+
+        profile->startIter(&iter);
+        while (profile->getNext(&iter, &op, &val)) {
+            ProfileData* data = static_cast<ProfileData*>(val);
+            double total_ms = data->getTotal() * 1000;
+            double max_ms = data->getMax() * 1000;
+
+            page_ops[op->getCString()].add(data->getCount(), total_ms, max_ms);
+            doc_ops[op->getCString()].add(data->getCount(), total_ms, max_ms);
+        }
+
+        deleteGooHash(profile, ProfileData);
+    }
+
+
+    //
+    // per-page profiles and the document's most expensive operators
+    std::ostream& OpProfiler::to_edn(std::ostream& o) const
+    {
+        util::edn::Hash profile_h(2);
+
+        util::edn::Vector pages_a(pages.size());
+        for (const std::pair<uintmax_t, OpMap>& p : pages) {
+            util::edn::Hash page_h(2);
+            util::edn::Hash ops_h(p.second.size());
+
+            for (const std::pair<const std::string, OpTimes>& op : p.second) {
+                util::edn::Hash op_h(3);
+                op_h.push( SYMBOL_COUNT,  op.second.count );
+                op_h.push( SYMBOL_MS,     op.second.ms );
+                op_h.push( SYMBOL_MAX_MS, op.second.max_ms );
+                ops_h.push( op.first, op_h );
+            }
+
+            page_h.push( SYMBOL_PAGE_NUMBER, p.first );
+            page_h.push( SYMBOL_OPS,         ops_h );
+            pages_a.push( page_h );
+        }
+        profile_h.push( SYMBOL_PAGES, pages_a );
+
+        // sort the document totals by time
+        std::vector<const std::pair<const std::string, OpTimes>*> sorted;
+        for (const std::pair<const std::string, OpTimes>& op : doc_ops) {
+            sorted.push_back(&op);
+        }
+        std::sort( sorted.begin(), sorted.end(),
+                   [](const std::pair<const std::string, OpTimes>* a,
+                      const std::pair<const std::string, OpTimes>* b) { return a->second.ms > b->second.ms; }
+                   );
+
+        uintmax_t top_n = std::min<uintmax_t>(TOP_N_OPS, sorted.size());
+        util::edn::Vector top_a(top_n);
+        for (uintmax_t ii = 0; ii < top_n; ++ii) {
+            util::edn::Hash op_h(4);
+            op_h.push( SYMBOL_OP,     sorted[ii]->first );
+            op_h.push( SYMBOL_COUNT,  sorted[ii]->second.count );
+            op_h.push( SYMBOL_MS,     sorted[ii]->second.ms );
+            op_h.push( SYMBOL_MAX_MS, sorted[ii]->second.max_ms );
+            top_a.push( op_h );
+        }
+        profile_h.push( SYMBOL_TOP, top_a );
+
+        o << profile_h;
+        return o;
+    }
+
+} // namespace
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <string>
+#include <map>
+#include <list>
+
+#include "base_types.h"
+
+class GooHash;
+
+namespace pdftoedn
+{
+    // -------------------------------------------------------
+    // collects poppler's content stream operator profile (enabled
+    // with GlobalParams::setProfileCommands) for each page and totals
+    // it for the document. Output as:
+    //
+    // {:pages [{:pgnum 1 :ops {"Tj" {:count 120 :ms 3.2 :max_ms 0.4} ...}} ...]
+    //  :top [{:op "Do" :count 3 :ms 512.7 :max_ms 410.1} ...]}
+    //
+    // where :top lists the operators that took the most time across
+    // the document
+    //
+    class OpProfiler : public gemable
+    {
+    public:
+        OpProfiler() {}
+
+        // read the profile returned by OutputDev::endProfile() - takes
+        // ownership of the hash
+        void add_page(uintmax_t page_num, GooHash* profile);
+
+        bool empty() const { return pages.empty(); }
+        void clear() { pages.clear(); doc_ops.clear(); }
+
+        virtual std::ostream& to_edn(std::ostream& o) const;
+
+        static const Symbol SYMBOL_OP_PROFILE;
+
+    private:
+        struct OpTimes {
+            OpTimes() : count(0), ms(0), max_ms(0) {}
+
+            uintmax_t count;
+            double ms;
+            double max_ms;
+
+            void add(uintmax_t n, double total_ms, double op_max_ms);
+        };
+        typedef std::map<std::string, OpTimes> OpMap;
+
+        std::list<std::pair<uintmax_t, OpMap> > pages;
+        OpMap doc_ops;
+
+        // prohibit
+        OpProfiler(const OpProfiler&);
+        OpProfiler& operator=(const OpProfiler&);
+    };
+
+} // namespace
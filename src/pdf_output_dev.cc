@@ -2,8 +2,13 @@
 #pragma implementation
 #endif
 
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
 #include <sstream>
 #include <vector>
+#include <cmath>
 #include <assert.h>
 
 #include <poppler/Error.h>
@@ -20,6 +25,7 @@
 #include "util_encode.h"
 #include "util_xform.h"
 #include "edsel_options.h"
+#include "pdf_stats_tracker.h"
 
 // debug
 //#define ENABLE_OP_TRACE            // dump traces to show op order
@@ -112,6 +118,18 @@ namespace pdftoedn
         }
         pg_data = new pdftoedn::PdfPage(pageNum, w, h, rot);
 
+        // drop ActualText left over from a page that was abandoned
+        // part way through
+        std::queue<Unicode>().swap(actual_text);
+        color_cache.forget_spaces();
+
+        // restrict the output to the requested regions, if any
+        for (const Options::Region& r : pdftoedn::options.regions()) {
+            if (r.page == -1 || r.page == pageNum - 1) {
+                pg_data->add_region(BoundingBox(r.x, r.y, r.width, r.height));
+            }
+        }
+
         // finally, update the xref pointer with the font engine
         if (xref) {
             font_engine.update_document_ref(xref);
@@ -132,6 +150,11 @@ namespace pdftoedn
 
         // close page collection
         pg_data->finalize();
+
+        // remap failures are collected per font while the page is
+        // read - log them once here
+        font_engine.report_remap_failures();
+        color_cache.report_stats();
     }
 
     //
@@ -148,6 +171,9 @@ namespace pdftoedn
         DBG_TRACE(std::cerr << __FUNCTION__ << std::endl);
 
         pg_data->pop_gfx_state();
+
+        // the restored-over state's color spaces were freed
+        color_cache.forget_spaces();
     }
 
 
@@ -207,15 +233,8 @@ namespace pdftoedn
     {
         DBG_TRACE_TXT(std::cerr << __FUNCTION__ << " ");
 
-        // we usually want to ignore non-marking text but some OCR'd
-        // PDFs carry text data this way so we've added an option to
-        // allow processing
-        bool invisible = (state->getRender() == util::TEXT_RENDER_INVISIBLE);
-        if (!pdftoedn::options.include_invisible_text() && invisible) {
-            return;
-        }
-
-        if (state->getStrokeColorSpace()->isNonMarking()) {
+        bool invisible;
+        if (skip_text(state, invisible)) {
             return;
         }
 
@@ -230,6 +249,47 @@ namespace pdftoedn
         dy -= dy2;
         state->transformDelta(dx, dy, &w1, &h1);
 
+        add_character(state, x1, y1, w1, h1, code, u, invisible);
+    }
+
+
+    //
+    // invisible & non-marking text checks
+    bool OutputDev::skip_text(GfxState* state, bool& invisible) const
+    {
+        // we usually want to ignore non-marking text but some OCR'd
+        // PDFs carry text data this way so we've added an option to
+        // allow processing
+        invisible = (state->getRender() == util::TEXT_RENDER_INVISIBLE);
+        if (!pdftoedn::options.include_invisible_text() && invisible) {
+            return true;
+        }
+
+        // the OCR layer of scanned documents is drawn as invisible
+        // text - keep only that if requested
+        if (pdftoedn::options.ocr_text_only() && !invisible) {
+            return true;
+        }
+
+        return state->getStrokeColorSpace()->isNonMarking();
+    }
+
+
+    //
+    // remaps the character code and adds it to the page
+    void OutputDev::add_character(GfxState* state, double x1, double y1, double w1, double h1,
+                                  CharCode code, Unicode* u, bool invisible)
+    {
+        // drop characters that can't be seen before doing any
+        // remapping or building the character data. Any pending
+        // actual text value for it is consumed as well
+        if (pg_data->char_is_hidden(x1, y1, w1, h1, text_tm, invisible)) {
+            if (!actual_text.empty()) {
+                actual_text.pop();
+            }
+            return;
+        }
+
         // try to do any re-mapping, if applicable
         size_t glyph_idx = -1;
         uintmax_t unicode;
@@ -292,6 +352,74 @@ namespace pdftoedn
     }
 
 
+    //
+    // Type3 characters - poppler has set the CTM to map glyph space
+    // to the device with the origin at the character's position
+    GBool OutputDev::beginType3Char(GfxState *state, double x, double y,
+                                    double dx, double dy,
+                                    CharCode code, Unicode *u, int uLen)
+    {
+        DBG_TRACE_TXT(std::cerr << __FUNCTION__ << " ");
+
+        GfxFont* gfx_font = state->getFont();
+        PdfTM glyph_ctm(state->getCTM());
+        PdfTM font_tm(gfx_font->getFontMatrix());
+
+        bool invisible;
+        bool skipped = skip_text(state, invisible);
+
+        if (!skipped && font_tm.determinant() != 0) {
+            // the font matrix maps glyph space to text space so its
+            // inverse gives the device advance for the glyph width
+            PdfTM text_ctm = font_tm.invert() * glyph_ctm;
+            Coord advance = text_ctm.transform_delta(static_cast<Gfx8BitFont*>(gfx_font)->getWidth(code), 0);
+
+            add_character(state, glyph_ctm.e(), glyph_ctm.f(), advance.x, advance.y,
+                          code, u, invisible);
+        }
+
+        // nothing to draw
+        if (skipped || invisible || pdftoedn::options.text_only()) {
+            return gTrue;
+        }
+
+        // CharProcs that show Type3 text themselves are interpreted
+        // every time - their graphics belong to the outer glyph.
+        // Degenerate glyph spaces can't be mapped back either
+        const PdfFont* font = font_engine.load_font(gfx_font);
+        if (!font || !type3_glyphs.empty() ||
+            !glyph_ctm.is_finite() || glyph_ctm.determinant() == 0) {
+            type3_glyphs.push(false);
+            return gFalse;
+        }
+
+        intmax_t glyph_idx = pg_data->find_glyph(font, code);
+        if (glyph_idx != -1) {
+            pg_data->new_glyph_ref(glyph_idx, glyph_ctm);
+            stats.add("type3_glyphs", "reused");
+            return gTrue;
+        }
+
+        // first occurrence on this page - have poppler run the
+        // CharProc and collect what it draws
+        type3_glyphs.push( pg_data->begin_glyph(font, code, glyph_ctm) );
+        stats.add("type3_glyphs", "interpreted");
+        return gFalse;
+    }
+
+    void OutputDev::endType3Char(GfxState *state)
+    {
+        if (type3_glyphs.empty()) {
+            return;
+        }
+
+        if (type3_glyphs.top()) {
+            pg_data->end_glyph();
+        }
+        type3_glyphs.pop();
+    }
+
+
     //
     // capture instances of the Actual Text command - these are used
     // so a PDF viewer shows different text from what's encoded. We
@@ -337,6 +465,12 @@ namespace pdftoedn
     // stroke
     void OutputDev::stroke(GfxState *state)
     {
+        // strokes don't affect text so they are skipped in
+        // text-only mode. Fills and clips are still tracked
+        if (pdftoedn::options.text_only()) {
+            return;
+        }
+
         if (state->getStrokeColorSpace()->isNonMarking()) {
             return;
         }
@@ -428,6 +562,11 @@ namespace pdftoedn
                                   int width, int height, GBool invert, GBool interpolate,
                                   GBool inlined)
     {
+        // image streams are never read in text-only mode
+        if (pdftoedn::options.text_only()) {
+            return;
+        }
+
         DBG_TRACE_IMG(std::cerr << "===========================" << std::endl << __FUNCTION__);
 
         if (state->getFillColorSpace()->isNonMarking()) {
@@ -461,6 +600,11 @@ namespace pdftoedn
 
         BoundingBox bbox(ctm);
 
+        // don't bother decoding images outside the regions of interest
+        if (pg_data->outside_regions(bbox, "images")) {
+            return;
+        }
+
         // lookup the object id to see if we've cached it already -
         // inlined images don't have a ref_num so we stream must be
         // extracted anyway and the md5 can be used to determine if
@@ -470,13 +614,9 @@ namespace pdftoedn
             // poppler's interface to rip through a stream for an image
             ImageStream *imgStr = new ImageStream(str, width, 1, 1);
 
-            // get the fill color of the mask
-            GfxRGB fill;
-            state->getFillRGB(&fill);
-
-            // set up stream properties
+            // set up stream properties - the fill color is not part
+            // of the blob so the mask is only encoded once
             StreamProps properties(str->getKind(), width, height,
-                                   fill, state->getFillColorSpace()->getMode(),
                                    interpolate, ctm.is_upside_down(), inlined, invert);
 
             DBG_TRACE_IMG( std::cerr << std::endl
@@ -506,7 +646,7 @@ namespace pdftoedn
                       );
 
         // add a meta container for the image
-        pg_data->new_image(ref_num, bbox);
+        pg_data->new_image(ref_num, bbox, true);
     }
 
 
@@ -521,6 +661,10 @@ namespace pdftoedn
                                         GfxImageColorMap *maskColorMap,
                                         GBool maskInterpolate)
     {
+        if (pdftoedn::options.text_only()) {
+            return;
+        }
+
         if (state->getFillColorSpace()->isNonMarking()) {
             return;
         }
@@ -545,6 +689,11 @@ namespace pdftoedn
 
         BoundingBox bbox(ctm);
 
+        // don't bother decoding images outside the regions of interest
+        if (pg_data->outside_regions(bbox, "images")) {
+            return;
+        }
+
         // lookup the object id to see if we've cached it already
         if (!pg_data->image_is_cached(ref_num))
         {
@@ -601,6 +750,10 @@ namespace pdftoedn
                                              int width, int height, GBool invert,
                                              GBool inlineImg, double *baseMatrix)
     {
+        if (pdftoedn::options.text_only()) {
+            return;
+        }
+
         DBG_TRACE_IMG(std::cerr << " + ---- " << __FUNCTION__ << " ---- + " << std::endl);
 
         et.log_info( ErrorTracker::ERROR_OD_UNIMPLEMENTED_CB, MODULE, __FUNCTION__ );
@@ -619,6 +772,10 @@ namespace pdftoedn
                                     Stream *maskStr, int maskWidth, int maskHeight,
                                     GBool maskInvert, GBool maskInterpolate)
     {
+        if (pdftoedn::options.text_only()) {
+            return;
+        }
+
         DBG_TRACE_IMG(std::cerr << " + ---- " << __FUNCTION__ << " ---- + " << std::endl);
 
         if (state->getFillColorSpace()->isNonMarking()) {
@@ -645,6 +802,11 @@ namespace pdftoedn
 
         BoundingBox bbox(ctm);
 
+        // don't bother decoding images outside the regions of interest
+        if (pg_data->outside_regions(bbox, "images")) {
+            return;
+        }
+
         // lookup the object id to see if we've cached it already
         if (!pg_data->image_is_cached(ref_num))
         {
@@ -696,6 +858,10 @@ namespace pdftoedn
                               int width, int height, GfxImageColorMap *colorMap,
                               GBool interpolate, int *maskColors, GBool inlined)
     {
+        if (pdftoedn::options.text_only()) {
+            return;
+        }
+
         if (state->getFillColorSpace()->isNonMarking()) {
             return;
         }
@@ -728,6 +894,11 @@ namespace pdftoedn
 
         BoundingBox bbox(ctm);
 
+        // don't bother decoding images outside the regions of interest
+        if (pg_data->outside_regions(bbox, "images")) {
+            return;
+        }
+
         // lookup the object id to see if we've cached it already -
         // inlined images don't have a ref_num so we stream must be
         // extracted anyway and the md5 can be used to determine if
@@ -736,7 +907,32 @@ namespace pdftoedn
         {
             int num_pix_comps = colorMap->getNumPixelComps();
             int bpp = colorMap->getBits();
-            StreamProps properties(str->getKind(), width, height,
+
+            // image data will be written here
+            std::ostringstream blob;
+            bool encode_status = false;
+            int img_width = width, img_height = height;
+
+#ifdef HAVE_LIBJPEG
+            // JPEGs much larger than needed at the size they're drawn
+            // are decoded directly at a reduced scale
+            Coord img_x = ctm.transform_delta(1, 0), img_y = ctm.transform_delta(0, 1);
+            uint8_t scale_denom = util::encode::dct_scale_denom(str, colorMap, width, height,
+                                                                std::hypot(img_x.x, img_x.y),
+                                                                std::hypot(img_y.x, img_y.y));
+            if (scale_denom > 1) {
+                encode_status = util::encode::encode_dct_image(blob, str, num_pix_comps, scale_denom,
+                                                               img_width, img_height);
+                if (!encode_status) {
+                    // let poppler have a go at it
+                    blob.str("");
+                    img_width = width;
+                    img_height = height;
+                }
+            }
+#endif
+
+            StreamProps properties(str->getKind(), img_width, img_height,
                                    num_pix_comps, bpp,
                                    interpolate, ctm.is_upside_down(), inlined);
 
@@ -746,18 +942,18 @@ namespace pdftoedn
                                     << " ctm: " << std::endl << ctm
                                     << std::endl);
 
-            // poppler's interface to rip through a stream for an image
-            ImageStream *imgStr = new ImageStream(str, width, num_pix_comps, bpp);
+            if (!encode_status) {
+                // poppler's interface to rip through a stream for an image
+                ImageStream *imgStr = new ImageStream(str, width, num_pix_comps, bpp);
 
-            // image data will be written here
-            std::ostringstream blob;
-            bool encode_status = util::encode::encode_image(blob, imgStr, properties, colorMap);
+                encode_status = util::encode::encode_image(blob, imgStr, properties, colorMap);
 
-            // poppler cleanup
-            delete imgStr;
+                // poppler cleanup
+                delete imgStr;
+            }
 
             if (!encode_status ||
-                !process_image_blob(blob, ctm, bbox, properties, width, height,
+                !process_image_blob(blob, ctm, bbox, properties, img_width, img_height,
                                     ref_num)) {
                 return;
             }
@@ -935,7 +1131,7 @@ namespace pdftoedn
     void OutputDev::updateFillColor(GfxState *state)
     {
         GfxRGB rgb;
-        state->getFillRGB(&rgb);
+        color_cache.get_rgb(state->getFillColorSpace(), state->getFillColor(), &rgb);
 
         DBG_TRACE(std::cerr << " + ---- " << __FUNCTION__ << ": " << RGBColor(rgb.r, rgb.g, rgb.b) << " ---- + " << std::endl);
 
@@ -947,7 +1143,7 @@ namespace pdftoedn
     void OutputDev::updateStrokeColor(GfxState *state)
     {
         GfxRGB rgb;
-        state->getStrokeRGB(&rgb);
+        color_cache.get_rgb(state->getStrokeColorSpace(), state->getStrokeColor(), &rgb);
 
         DBG_TRACE(std::cerr << " + ---- " << __FUNCTION__ << ":" << RGBColor(rgb.r, rgb.g, rgb.b) << " ---- + " << std::endl);
 
@@ -5,11 +5,14 @@
 #endif
 
 #include <queue>
+#include <stack>
 
 #include <poppler/GfxState.h>
 
 #include "eng_output_dev.h"
 #include "graphics.h"
+#include "edsel_options.h"
+#include "pdf_color_cache.h"
 
 namespace pdftoedn
 {
@@ -42,7 +45,8 @@ namespace pdftoedn
         // (Upside-down means (0,0) is the top left corner of the page.)
         virtual GBool upsideDown() { return gTrue; }
 
-        virtual GBool needNonText() { return gTrue; }
+        // text-only extraction tells poppler to skip images & patterns
+        virtual GBool needNonText() { return (pdftoedn::options.text_only() ? gFalse : gTrue); }
         virtual GBool needCharCount() { return gTrue; }
 
         // Does this device use drawChar() or drawString()?
@@ -76,8 +80,8 @@ namespace pdftoedn
         virtual void updateLineWidth(GfxState *state);
         virtual void updateAlphaIsShape(GfxState *state);
         virtual void updateTextKnockout(GfxState *state);
-        virtual void updateFillColorSpace(GfxState * /*state*/) {}
-        virtual void updateStrokeColorSpace(GfxState * /*state*/) {}
+        virtual void updateFillColorSpace(GfxState * /*state*/) { color_cache.forget_spaces(); }
+        virtual void updateStrokeColorSpace(GfxState * /*state*/) { color_cache.forget_spaces(); }
         virtual void updateFillColor(GfxState *state);
         virtual void updateStrokeColor(GfxState *state);
         virtual void updateBlendMode(GfxState *state);
@@ -98,6 +102,12 @@ namespace pdftoedn
                               double dx, double dy,
                               double originX, double originY,
                               CharCode code, int nBytes, Unicode *u, int uLen);
+        // Type3 characters are added as text; their CharProc is
+        // interpreted once per page and reused after that
+        virtual GBool beginType3Char(GfxState *state, double x, double y,
+                                     double dx, double dy,
+                                     CharCode code, Unicode *u, int uLen);
+        virtual void endType3Char(GfxState *state);
         virtual void beginActualText(GfxState* state, GooString *text );
         virtual void endActualText(GfxState * /*state*/) { }
 
@@ -168,8 +178,15 @@ namespace pdftoedn
         PdfTM text_tm;
         std::queue<Unicode> actual_text;
         int inline_img_id;
+        // one entry per CharProc being interpreted: true if its
+        // graphics are collected into a glyph definition
+        std::stack<bool> type3_glyphs;
+        pdftoedn::ColorCache color_cache;
 
         // non-virtual methods; helpers
+        bool skip_text(GfxState* state, bool& invisible) const;
+        void add_character(GfxState* state, double x, double y, double width, double height,
+                           CharCode code, Unicode* u, bool invisible);
         bool process_image_blob(const std::ostringstream& blob, const PdfTM& ctm,
                                 const BoundingBox& bbox, const StreamProps& properties,
                                 int width, int height,
@@ -0,0 +1,90 @@
+#include <sstream>
+#include <iomanip>
+#include <cerrno>
+
+#include <unistd.h>
+
+#include "pdf_progress_writer.h"
+
+namespace pdftoedn
+{
+    // number of recent pages used to compute the ETA
+    static const uintmax_t ETA_WINDOW_PAGES = 10;
+
+    ProgressWriter::ProgressWriter(int progress_fd, uintmax_t total_pages) :
+        fd(progress_fd), total(total_pages), done(0), images(0),
+        start(Clock::now()), last(start)
+    {
+    }
+
+
+    //
+    // update the counters and write the line
+    void ProgressWriter::page_done(uintmax_t page_num, uintmax_t page_images, intmax_t output_bytes)
+    {
+        if (fd < 0) {
+            return;
+        }
+
+        Clock::time_point now = Clock::now();
+        std::chrono::duration<double, std::milli> elapsed = now - start;
+        std::chrono::duration<double, std::milli> page_elapsed = now - last;
+        last = now;
+
+        ++done;
+        images += page_images;
+
+        page_ms.push_back(page_elapsed.count());
+        if (page_ms.size() > ETA_WINDOW_PAGES) {
+            page_ms.pop_front();
+        }
+
+        double avg_ms = 0;
+        for (double ms : page_ms) {
+            avg_ms += ms;
+        }
+        avg_ms /= page_ms.size();
+
+        std::stringstream line;
+        line << std::fixed << std::setprecision(1)
+             << "{\"page\":" << page_num
+             << ",\"done\":" << done
+             << ",\"total\":" << total
+             << ",\"elapsed_ms\":" << elapsed.count()
+             << ",\"images\":" << images
+             << ",\"bytes\":" << output_bytes
+             << ",\"eta_ms\":" << (avg_ms * (total > done ? total - done : 0))
+             << "}\n";
+
+        // stop reporting if the reader went away
+        if (!write_line(line.str())) {
+            fd = -1;
+        }
+    }
+
+
+    //
+    // write the full line, retrying on partial writes
+    bool ProgressWriter::write_line(const std::string& line)
+    {
+        const char* buf = line.c_str();
+        size_t remaining = line.length();
+
+        while (remaining > 0) {
+            ssize_t n = ::write(fd, buf, remaining);
+
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                // EPIPE - the reader closed its end (SIGPIPE is
+                // ignored when progress is reported)
+                return false;
+            }
+            buf += n;
+            remaining -= n;
+        }
+        return true;
+    }
+
+} // namespace
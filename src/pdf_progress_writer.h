@@ -0,0 +1,45 @@
+#pragma once
+
+#include <string>
+#include <deque>
+#include <chrono>
+
+namespace pdftoedn
+{
+    // -------------------------------------------------------
+    // writes one JSON line per completed page to a file descriptor
+    // so a caller can track the progress of long documents, e.g.:
+    //
+    // {"page":3,"done":3,"total":120,"elapsed_ms":1840.2,"images":7,"bytes":80231,"eta_ms":71640.0}
+    //
+    // The ETA is based on the moving average of the most recent page
+    // times
+    //
+    class ProgressWriter
+    {
+    public:
+        ProgressWriter(int progress_fd, uintmax_t total_pages);
+
+        // report a completed (1-based) document page
+        void page_done(uintmax_t page_num, uintmax_t page_images, intmax_t output_bytes);
+
+    private:
+        typedef std::chrono::steady_clock Clock;
+
+        int fd;
+        uintmax_t total;
+        uintmax_t done;
+        uintmax_t images;
+        Clock::time_point start;
+        Clock::time_point last;
+        std::deque<double> page_ms;
+
+        bool write_line(const std::string& line);
+
+        // prohibit
+        ProgressWriter();
+        ProgressWriter(const ProgressWriter&);
+        ProgressWriter& operator=(const ProgressWriter&);
+    };
+
+} // namespace
@@ -1,4 +1,9 @@
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
 #include <list>
+#include <algorithm>
 
 #include <poppler/goo/GooList.h>
 #include <poppler/Outline.h>
@@ -11,10 +16,17 @@
 #include "pdf_reader.h"
 #include "pdf_output_dev.h"
 #include "link_output_dev.h"
+#include "search_output_dev.h"
 #include "font_engine.h"
 #include "pdf_doc_outline.h"
 #include "doc_page.h"
 #include "edsel_options.h"
+#include "pdf_stats_tracker.h"
+#include "pdf_progress_writer.h"
+#include "pdf_op_profiler.h"
+#include "pdf_text_interpreter.h"
+#include "pdf_span_table.h"
+#include "pdf_sqlite_sink.h"
 
 namespace pdftoedn
 {
@@ -56,7 +68,45 @@ namespace pdftoedn
                get_pdf_password(pdftoedn::options.pdf_user_password())),
         font_engine(getXRef()),
         eng_odev(NULL),
+        search_odev(NULL),
+        op_profiler(NULL),
+        text_interp(NULL),
+        span_table(NULL),
+        sqlite_db(NULL),
+        page_done_cbk(NULL),
+        page_done_data(NULL),
+        progress(NULL),
+        next_page(0),
+        end_page(0),
         use_page_media_box(true)
+    {
+        init();
+    }
+
+    //
+    // same, reading the document from a stream (takes ownership)
+    PDFReader::PDFReader(BaseStream* doc_stream) :
+        PDFDoc(doc_stream,
+               get_pdf_password(pdftoedn::options.pdf_owner_password()),
+               get_pdf_password(pdftoedn::options.pdf_user_password())),
+        font_engine(getXRef()),
+        eng_odev(NULL),
+        search_odev(NULL),
+        op_profiler(NULL),
+        text_interp(NULL),
+        span_table(NULL),
+        sqlite_db(NULL),
+        page_done_cbk(NULL),
+        page_done_data(NULL),
+        progress(NULL),
+        next_page(0),
+        end_page(0),
+        use_page_media_box(true)
+    {
+        init();
+    }
+
+    void PDFReader::init()
     {
         if (!isOk()) {
             std::stringstream err;
@@ -68,18 +118,7 @@ namespace pdftoedn
         // document is open and basic meta has been read. Before
         // trying to do anything else, if a page number was given,
         // check it is within range
-        if (pdftoedn::options.page_number() >= 0 &&
-            pdftoedn::options.page_number() >= getNumPages()) {
-            std::stringstream err;
-            err << "Error: requested page number " << pdftoedn::options.page_number()
-                << " is not valid (document has "
-                << getNumPages() << " page";
-            if (getNumPages() > 1) {
-                err << "s";
-            }
-            err << " and value must be 0-indexed)";
-            throw init_error(err.str());
-        }
+        check_page_number();
 
         // TESLA-6245: Mike P requested a way to extract only links
         // from a doc. To do this, we use a different type of
@@ -87,7 +126,21 @@ namespace pdftoedn
         if (pdftoedn::options.link_output_only()) {
             eng_odev = new pdftoedn::LinkOutputDev(getCatalog());
         }
+        else if (!pdftoedn::options.search_terms().empty()) {
+            // search mode only reads the text so the rest of the
+            // set up is not needed
+            search_odev = new pdftoedn::SearchOutputDev(getCatalog(), font_engine);
+            eng_odev = search_odev;
+        }
         else {
+            // analyse the embedded fonts used by the requested pages
+            // up front if requested
+            if (pdftoedn::options.preload_fonts()) {
+                uintmax_t start_page, end_page;
+                get_page_range(start_page, end_page);
+                font_engine.preload_fonts(getCatalog(), start_page + 1, end_page);
+            }
+
             // pre-process the doc to extract fonts first. Needed
             // if additional font data needs to be included in the
             // meta before pages are parsed
@@ -97,6 +150,11 @@ namespace pdftoedn
 
             eng_odev = new pdftoedn::OutputDev(getCatalog(), font_engine);
 
+            // interpret only the text operators when possible
+            if (pdftoedn::options.fast_text()) {
+                text_interp = new pdftoedn::TextInterpreter(getXRef(), getCatalog(), eng_odev);
+            }
+
             // use page crop box if requested (page media box is the default)
             if (pdftoedn::options.use_page_crop_box()) {
                 use_page_media_box = false;
@@ -107,6 +165,61 @@ namespace pdftoedn
                 process_outline(outline_output);
             }
         }
+
+        // collect poppler's operator timings for each page
+        if (pdftoedn::options.profile_ops()) {
+            op_profiler = new pdftoedn::OpProfiler;
+        }
+    }
+
+    PDFReader::~PDFReader()
+    {
+        delete progress;
+        delete span_table;
+#ifdef HAVE_SQLITE3
+        delete sqlite_db;
+#endif
+        delete op_profiler;
+        delete text_interp;
+        delete eng_odev;
+    }
+
+
+    //
+    // throws if the requested page is not in the document
+    void PDFReader::check_page_number()
+    {
+        if (pdftoedn::options.page_number() >= 0 &&
+            pdftoedn::options.page_number() >= getNumPages()) {
+            std::stringstream err;
+            err << "Error: requested page number " << pdftoedn::options.page_number()
+                << " is not valid (document has "
+                << getNumPages() << " page";
+            if (getNumPages() > 1) {
+                err << "s";
+            }
+            err << " and value must be 0-indexed)";
+            throw init_error(err.str());
+        }
+    }
+
+
+    //
+    // 0-based [start, end) range of pages to process: the whole
+    // document, a single page, or a slice when a page count is given
+    void PDFReader::get_page_range(uintmax_t& start_page, uintmax_t& end_page)
+    {
+        uintmax_t num_pages = getNumPages();
+
+        start_page = (pdftoedn::options.page_number() < 0 ? 0 : pdftoedn::options.page_number());
+
+        if (pdftoedn::options.page_count() > 0) {
+            end_page = std::min<uintmax_t>(start_page + pdftoedn::options.page_count(), num_pages);
+        } else if (pdftoedn::options.page_number() < 0) {
+            end_page = num_pages;
+        } else {
+            end_page = start_page + 1;
+        }
     }
 
 
@@ -121,22 +234,14 @@ namespace pdftoedn
 
         // pre-process doc for font data
         FontEngDev fe_dev(font_engine);
-        uint32_t num_pages = getNumPages();
 
-        uintmax_t first, last;
-
-        if (pdftoedn::options.page_number() != -1) {
-            first = pdftoedn::options.page_number();
-            last = first + 1;
-        } else {
-            first = 1;
-            last = num_pages;
-        }
+        uintmax_t start_page, end_page;
+        get_page_range(start_page, end_page);
 
-        for (uintmax_t page = first; page <= last; page++)
+        for (uintmax_t page = start_page; page < end_page; page++)
         {
-            // process the PDF info on this page
-            process_page(&fe_dev, page);
+            // process the PDF info on this page (poppler is 1-based)
+            process_page(&fe_dev, page + 1);
         }
 
 #if 0
@@ -220,7 +325,53 @@ namespace pdftoedn
         // generated by the page
         et.flush_errors();
 
-        displayPage(dev, page_num, DPI_72, DPI_72, 0, gFalse, gTrue, gFalse);
+        // stop reading the page as soon as the search is done
+        GBool (*abort_check)(void*) = NULL;
+        if (dev == search_odev) {
+            abort_check = &SearchOutputDev::abort_check;
+        }
+
+        // only the output pass is profiled
+        bool profile = (op_profiler && dev == eng_odev);
+
+        // poppler's operator timings are what's profiled so the fast
+        // path isn't used then
+        if (text_interp && dev == eng_odev && !profile && process_page_text(page_num)) {
+            return;
+        }
+
+        if (profile) {
+            dev->startProfile();
+        }
+
+        displayPage(dev, page_num, DPI_72, DPI_72, 0, gFalse, gTrue, gFalse,
+                    abort_check, search_odev);
+
+        if (profile) {
+            op_profiler->add_page(page_num, dev->endProfile());
+        }
+    }
+
+
+    //
+    // runs the page through the text interpreter. If it gives up,
+    // undo what the partial pass recorded so the page can be read
+    // again by poppler
+    bool PDFReader::process_page_text(uintmax_t page_num)
+    {
+        pdftoedn::StatsTracker page_stats = stats;
+
+        if (text_interp->display_page(page_num)) {
+            stats.add("fast_text", "pages");
+            return true;
+        }
+
+        stats = page_stats;
+        stats.add("fast_text", std::string("fallback_") + text_interp->unsupported());
+
+        font_engine.discard_remap_failures();
+        et.flush_errors();
+        return false;
     }
 
 
@@ -238,9 +389,38 @@ namespace pdftoedn
             // process the PDF info on this page
             process_page(eng_odev, page_num);
 
+            // search mode only outputs the matches
+            if (search_odev) {
+                for (const SearchMatch* m : search_odev->page_matches()) {
+                    o << *m;
+                }
+                return o;
+            }
+
             const PdfPage* page = eng_odev->page_data();
 
             if (page) {
+                // add the page's spans to the sidecar table first so
+                // write errors are reported with the page
+                if (span_table) {
+                    page->add_spans_to(*span_table);
+                    if (!span_table->write_page()) {
+                        std::stringstream err;
+                        err << "error writing spans of page " << page_num << " to "
+                            << options.span_table_filename();
+                        et.log_error(ErrorTracker::ERROR_IO, MODULE, err.str());
+                    }
+                }
+
+#ifdef HAVE_SQLITE3
+                if (sqlite_db && !page->add_to(*sqlite_db)) {
+                    std::stringstream err;
+                    err << "error inserting page " << page_num << " into "
+                        << options.sqlite_db_filename() << ": " << sqlite_db->error();
+                    et.log_error(ErrorTracker::ERROR_IO, MODULE, err.str());
+                }
+#endif
+
                 o << *page;
             }
         }
@@ -248,33 +428,147 @@ namespace pdftoedn
         return o;
     }
 
+    //
+    // return a hash with the data in the format
+    // { :meta { <meta> }, :pages [ {<page1>} {<page2>} ... {<pageN>} ] }
+    // or, when searching,
+    // { :meta { <meta> }, :matches [ {<match1>} ... {<matchN>} ] }
     std::ostream& PDFReader::process(std::ostream& o)
     {
-        // return a hash with the data in the format
-        // { :meta { <meta> }, :pages [ {<page1>} {<page2>} ... {<pageN>} ] }
+        begin_output(o);
+        while (output_next_page(o)) {
+        }
+        return end_output(o);
+    }
+
+
+    //
+    // opens the sidecar outputs and writes the meta and the start of
+    // the page list
+    std::ostream& PDFReader::begin_output(std::ostream& o)
+    {
         static const pdftoedn::Symbol Meta("meta");
         static const pdftoedn::Symbol Pages("pages");
+        static const pdftoedn::Symbol Matches("matches");
+
+        // the reader is reused by server-mode requests so drop what
+        // was collected by the previous one
+        if (op_profiler) {
+            op_profiler->clear();
+        }
+        if (search_odev) {
+            search_odev->reset_search();
+        }
+        delete progress;
+        progress = NULL;
+
+        // columnar table of the text spans written alongside the
+        // EDN. Not available when searching
+        delete span_table;
+        span_table = NULL;
+        if (options.span_table() && !search_odev) {
+            span_table = new SpanTable;
+            if (!span_table->open(options.span_table_filename())) {
+                std::stringstream err;
+                err << "unable to open span table file " << options.span_table_filename();
+                throw invalid_file(err.str());
+            }
+        }
+
+#ifdef HAVE_SQLITE3
+        // same for the database
+        delete sqlite_db;
+        sqlite_db = NULL;
+        if (!options.sqlite_db_filename().empty() && !search_odev) {
+            sqlite_db = new SqliteSink;
+            if (!sqlite_db->open(options.sqlite_db_filename()) ||
+                !sqlite_db->add_document(options.pdf_filename(), getNumPages(), options.edn_filename())) {
+                std::stringstream err;
+                err << "unable to write to database " << options.sqlite_db_filename() << ": "
+                    << sqlite_db->error();
+                throw invalid_file(err.str());
+            }
+        }
+#endif
 
         // but dont store it in a hash so we write a page at a time
         o << "{" << Meta << " ";
         output_meta(o);
-        o << ", " << Pages << " [";
+        o << ", " << (search_odev ? Matches : Pages) << " [";
 
-        uintmax_t start_page, end_page;
+        get_page_range(next_page, end_page);
 
-        if (options.page_number() < 0) {
-            start_page = 0;
-            end_page = getNumPages();
-        } else {
-            start_page = options.page_number();
-            end_page = start_page + 1;
+        // report per-page progress if requested
+        if (options.progress_fd() >= 0) {
+            progress = new ProgressWriter(options.progress_fd(), end_page - next_page);
+        }
+        return o;
+    }
+
+
+    //
+    // writes the next page in the range. Returns false once there
+    // are no more
+    bool PDFReader::output_next_page(std::ostream& o)
+    {
+        if (next_page >= end_page) {
+            return false;
+        }
+
+        uintmax_t ii = next_page++;
+        output_page(ii, o);
+
+        if (page_done_cbk) {
+            page_done_cbk(ii + 1, page_done_data);
+        }
+
+        if (progress) {
+            const PdfPage* page = eng_odev->page_data();
+            progress->page_done(ii + 1, (page ? page->num_images() : 0), o.tellp());
+        }
+
+        // any-match search stops once every term has been found
+        if (search_odev && search_odev->search_done()) {
+            next_page = end_page;
+        }
+        return (next_page < end_page);
+    }
+
+
+    //
+    // closes the page list and the sidecar outputs
+    std::ostream& PDFReader::end_output(std::ostream& o)
+    {
+        delete progress;
+        progress = NULL;
+
+        o << "]";
+
+        // processing stats are only known once all pages have been
+        // read so they trail the page data
+        if (options.include_debug_info() && !stats.empty()) {
+            o << ", " << StatsTracker::SYMBOL_STATS << " " << stats;
         }
 
-        for (uintmax_t ii = start_page; ii < end_page; ++ii) {
-            output_page(ii, o);
+        if (op_profiler && !op_profiler->empty()) {
+            o << ", " << OpProfiler::SYMBOL_OP_PROFILE << " " << *op_profiler;
         }
+        o << "}";
 
-        o << "]}";
+        if (span_table) {
+            if (!span_table->close()) {
+                std::stringstream err;
+                err << "error closing span table file " << options.span_table_filename();
+                et.log_error(ErrorTracker::ERROR_IO, MODULE, err.str());
+            }
+            delete span_table;
+            span_table = NULL;
+        }
+
+#ifdef HAVE_SQLITE3
+        delete sqlite_db;
+        sqlite_db = NULL;
+#endif
         return o;
     }
 
@@ -18,9 +18,17 @@ class LinkGoTo;
 class LinkGoToR;
 class LinkURI;
 class GooList;
+class BaseStream;
 
 namespace pdftoedn
 {
+    class SearchOutputDev;
+    class OpProfiler;
+    class TextInterpreter;
+    class SpanTable;
+    class SqliteSink;
+    class ProgressWriter;
+
     //
     // Poppler PDF Doc reader
     class PDFReader : public PDFDoc
@@ -28,12 +36,32 @@ namespace pdftoedn
     public:
         static const double DPI_72; // 72.0
 
+        // called after each (1-based) page is written
+        typedef void (*PageDoneCbk)(uintmax_t page_num, void* data);
+
         PDFReader();
-        virtual ~PDFReader() { delete eng_odev; }
+        PDFReader(BaseStream* doc_stream);
+        virtual ~PDFReader();
+
+        void set_page_done_cbk(PageDoneCbk cbk, void* data) {
+            page_done_cbk = cbk;
+            page_done_data = data;
+        }
+
+        // throws if the page number set in the options is out of range
+        void check_page_number();
 
         bool pre_process_fonts();
         std::ostream& process(std::ostream& o);
 
+        // process() in steps so server mode can pause a request
+        // between pages: begin_output() writes the meta,
+        // output_next_page() the next page of the range (returns
+        // false once the range is done), and end_output() the rest
+        std::ostream& begin_output(std::ostream& o);
+        bool output_next_page(std::ostream& o);
+        std::ostream& end_output(std::ostream& o);
+
         friend std::ostream& operator<<(std::ostream& o, PDFReader& doc) {
             return doc.process(o);
         }
@@ -41,9 +69,20 @@ namespace pdftoedn
     private:
         pdftoedn::FontEngine font_engine;
         pdftoedn::EngOutputDev* eng_odev;
+        pdftoedn::SearchOutputDev* search_odev; // alias of eng_odev in search mode
+        pdftoedn::OpProfiler* op_profiler;
+        pdftoedn::TextInterpreter* text_interp;
+        pdftoedn::SpanTable* span_table; // set while processing if requested
+        pdftoedn::SqliteSink* sqlite_db; // same
+        PageDoneCbk page_done_cbk;
+        void* page_done_data;
+        pdftoedn::ProgressWriter* progress; // set while processing if requested
+        uintmax_t next_page; // 0-based range being written
+        uintmax_t end_page;
         pdftoedn::PdfOutline outline_output;
         bool use_page_media_box;
 
+        void init();
         bool init_font_engine();
         bool process_outline(pdftoedn::PdfOutline& outline_output);
         void outline_level(GooList* items, int level, std::list<PdfOutline::Entry *>& entry_list);
@@ -53,7 +92,9 @@ namespace pdftoedn
         void outline_link_dest(LinkDest* dest, PdfOutline::Entry& entry);
         uintmax_t get_link_page_num(LinkDest* link);
 
+        void get_page_range(uintmax_t& start_page, uintmax_t& end_page);
         void process_page(::OutputDev* dev, uintmax_t page);
+        bool process_page_text(uintmax_t page);
 
         // returns document metadata
         std::ostream& output_meta(std::ostream& o);
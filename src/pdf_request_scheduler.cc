@@ -0,0 +1,132 @@
+#include <sstream>
+#include <algorithm>
+#include <cstdlib>
+
+#include "pdf_request_scheduler.h"
+
+namespace pdftoedn
+{
+    RequestScheduler::~RequestScheduler()
+    {
+        for (Lane& l : lanes) {
+            for (Request* r : l.queued) { delete r; }
+            for (Request* r : l.active) { delete r; }
+        }
+    }
+
+
+    //
+    // parse <name>:<weight>:<limit> and add the lane
+    bool RequestScheduler::add_lane(const std::string& spec)
+    {
+        std::vector<std::string> fields;
+        std::stringstream ss(spec);
+        std::string field;
+        while (std::getline(ss, field, ':')) {
+            fields.push_back(field);
+        }
+
+        if (fields.size() != 3 || fields[0].empty() || lane_index(fields[0]) != -1) {
+            return false;
+        }
+
+        uintmax_t values[2];
+        for (uintmax_t ii = 0; ii < 2; ++ii) {
+            const std::string& f = fields[ii + 1];
+            char* end = NULL;
+            values[ii] = std::strtoull(f.c_str(), &end, 10);
+            if (f.empty() || *end != '\0' || f[0] == '-' || values[ii] < 1) {
+                return false;
+            }
+        }
+
+        lanes.push_back( Lane(fields[0], values[0], values[1]) );
+        return true;
+    }
+
+
+    intmax_t RequestScheduler::lane_index(const std::string& name) const
+    {
+        for (uintmax_t ii = 0; ii < lanes.size(); ++ii) {
+            if (lanes[ii].name == name) {
+                return ii;
+            }
+        }
+        return -1;
+    }
+
+
+    void RequestScheduler::push(Request* r)
+    {
+        lanes[r->lane].queued.push_back(r);
+    }
+
+
+    //
+    // pick the lane with the earliest turn and the next request in it
+    RequestScheduler::Request* RequestScheduler::next()
+    {
+        Lane* lane = NULL;
+        for (Lane& l : lanes) {
+            if (!l.runnable()) {
+                l.idle = true;
+                continue;
+            }
+
+            // a lane that had no work doesn't get to catch up on the
+            // turns it missed
+            if (l.idle) {
+                l.pass = std::max(l.pass, vtime);
+                l.idle = false;
+            }
+
+            if (!lane || l.pass < lane->pass) {
+                lane = &l;
+            }
+        }
+
+        if (!lane) {
+            return NULL;
+        }
+
+        vtime = lane->pass;
+        lane->pass += 1.0 / lane->weight;
+
+        // start the next queued request if the lane has room
+        if (lane->active.size() < lane->limit && !lane->queued.empty()) {
+            lane->active.splice(lane->active.end(), lane->queued, lane->queued.begin());
+        }
+
+        // take turns with the other requests in progress
+        Request* r = lane->active.front();
+        lane->active.splice(lane->active.end(), lane->active, lane->active.begin());
+
+        if (last && last != r) {
+            ++last->preemptions;
+        }
+        last = r;
+        return r;
+    }
+
+
+    void RequestScheduler::done(Request* r)
+    {
+        Lane& l = lanes[r->lane];
+        l.active.remove(r);
+        l.queued.remove(r);
+
+        if (last == r) {
+            last = NULL;
+        }
+        delete r;
+    }
+
+
+    bool RequestScheduler::empty() const
+    {
+        return std::all_of( lanes.begin(), lanes.end(),
+                            [](const Lane& l) { return (l.queued.empty() && l.active.empty()); }
+                            );
+    }
+
+} // namespace
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <list>
+#include <fstream>
+
+#include "base_types.h"
+#include "edsel_options.h"
+#include "pdf_stats_tracker.h"
+
+namespace pdftoedn
+{
+    class PDFReader;
+
+    // -------------------------------------------------------
+    // server-mode request queues. Each request is placed in a lane
+    // (e.g., interactive and bulk) that has a weight and a limit on
+    // how many of its requests can be in progress at once.
+    //
+    // Requests are processed a page at a time and next() picks the
+    // request to run the next page of. Lanes with work are served in
+    // proportion to their weights (stride scheduling) and the
+    // requests in progress in a lane take turns so a long request in
+    // a low-weight lane is paused between pages while others run and
+    // resumes where it left off.
+    //
+    class RequestScheduler
+    {
+    public:
+        // a request and the state kept while it is paused
+        struct Request {
+            Request(uintmax_t request_num, uintmax_t lane_idx, const Options& request_opts) :
+                number(request_num), lane(lane_idx), opts(request_opts), reader(NULL),
+                cached(false), status(0), pages(0), preemptions(0)
+            {}
+
+            uintmax_t number;
+            uintmax_t lane;
+            Options opts;         // document, output file and pages
+            PDFReader* reader;    // set once started
+            std::ofstream output;
+            bool cached;
+            uint8_t status;       // exit code flags of the pages so far
+            StatsTracker stats;
+            uintmax_t pages;
+            uintmax_t preemptions;
+
+            bool started() const { return (reader != NULL); }
+        };
+
+        RequestScheduler() : last(NULL), vtime(0) {}
+        ~RequestScheduler();
+
+        // lanes are given as <name>:<weight>:<limit> - returns false
+        // if the spec is not valid or the name is in use. Earlier
+        // lanes win ties
+        bool add_lane(const std::string& spec);
+        uintmax_t num_lanes() const { return lanes.size(); }
+
+        // index of the named lane or -1 if there's no such lane
+        intmax_t lane_index(const std::string& name) const;
+        const Symbol& lane_symbol(uintmax_t lane_idx) const { return lanes[lane_idx].symbol; }
+
+        // queue a request (takes ownership)
+        void push(Request* r);
+
+        // the request to process the next page of or NULL if there's
+        // nothing to do
+        Request* next();
+
+        // remove a completed or failed request and delete it
+        void done(Request* r);
+
+        bool empty() const;
+
+        // number of requests waiting to start in a lane
+        uintmax_t queued(uintmax_t lane_idx) const { return lanes[lane_idx].queued.size(); }
+        // number of started requests in a lane, paused or not
+        uintmax_t in_progress(uintmax_t lane_idx) const { return lanes[lane_idx].active.size(); }
+
+    private:
+        struct Lane {
+            Lane(const std::string& lane_name, uintmax_t lane_weight, uintmax_t max_active) :
+                name(lane_name), symbol(lane_name), weight(lane_weight), limit(max_active),
+                pass(0), idle(true)
+            {}
+
+            std::string name;
+            Symbol symbol;
+            uintmax_t weight;
+            uintmax_t limit;
+            double pass;                 // virtual time of its next turn
+            bool idle;
+            std::list<Request*> queued;  // not started
+            std::list<Request*> active;  // started, in turn order
+
+            bool runnable() const {
+                return (!active.empty() || (!queued.empty() && active.size() < limit));
+            }
+        };
+
+        std::vector<Lane> lanes;
+        Request* last;                   // request that ran the last page
+        double vtime;
+
+        // prohibit
+        RequestScheduler(const RequestScheduler&);
+        RequestScheduler& operator=(const RequestScheduler&);
+    };
+
+} // namespace
@@ -0,0 +1,273 @@
+#include <string>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdlib>
+
+#include "base_types.h"
+#include "pdf_error_tracker.h"
+#include "pdf_stats_tracker.h"
+#include "pdf_reader.h"
+#include "pdf_doc_cache.h"
+#include "pdf_request_scheduler.h"
+#include "pdf_request_server.h"
+#include "edsel_options.h"
+#include "util_edn.h"
+#include "util_fs.h"
+
+namespace pdftoedn
+{
+    //
+    // parses a page argument from a server request, returning false if
+    // it is not a number
+    static bool parse_request_int(const std::string& field, intmax_t& value)
+    {
+        char* end = NULL;
+        value = std::strtoll(field.c_str(), &end, 10);
+        return (!field.empty() && *end == '\0');
+    }
+
+
+    //
+    // lines read from the server input on a separate thread so requests
+    // are queued while others are processed
+    struct RequestInput {
+        RequestInput() : eof(false) {}
+
+        std::mutex mtx;
+        std::condition_variable cv;
+        std::deque<std::string> lines;
+        bool eof;
+    };
+
+
+    //
+    // writes the result of a request, along with the number of requests
+    // waiting in each lane
+    static void write_response(std::ostream& out, const pdftoedn::RequestScheduler& scheduler,
+                               uintmax_t request_num, intmax_t lane, uintmax_t status, bool cached,
+                               uintmax_t preemptions, const std::string& output_filename,
+                               const std::string& error)
+    {
+        static const pdftoedn::Symbol SYMBOL_REQUEST     = "request";
+        static const pdftoedn::Symbol SYMBOL_STATUS      = "status";
+        static const pdftoedn::Symbol SYMBOL_CACHED      = "cached";
+        static const pdftoedn::Symbol SYMBOL_LANE        = "lane";
+        static const pdftoedn::Symbol SYMBOL_PREEMPTIONS = "preemptions";
+        static const pdftoedn::Symbol SYMBOL_QUEUE_DEPTH = "queue_depth";
+        static const pdftoedn::Symbol SYMBOL_OUTPUT      = "output";
+        static const pdftoedn::Symbol SYMBOL_ERROR       = "error";
+
+        pdftoedn::util::edn::Hash response_h(8);
+        response_h.push( SYMBOL_REQUEST, request_num );
+        response_h.push( SYMBOL_STATUS,  status );
+        response_h.push( SYMBOL_CACHED,  cached );
+        if (lane >= 0) {
+            response_h.push( SYMBOL_LANE,        scheduler.lane_symbol(lane) );
+            response_h.push( SYMBOL_PREEMPTIONS, preemptions );
+        }
+
+        pdftoedn::util::edn::Hash depth_h(scheduler.num_lanes());
+        for (uintmax_t ii = 0; ii < scheduler.num_lanes(); ++ii) {
+            depth_h.push( scheduler.lane_symbol(ii), scheduler.queued(ii) );
+        }
+        response_h.push( SYMBOL_QUEUE_DEPTH, depth_h );
+
+        if (!output_filename.empty()) {
+            response_h.push( SYMBOL_OUTPUT, output_filename );
+        }
+        if (!error.empty()) {
+            response_h.push( SYMBOL_ERROR, error );
+        }
+        out << response_h << std::endl;
+    }
+
+
+    //
+    // checks a request line and queues it. Requests that can't be
+    // queued are answered right away
+    static void queue_request(const std::string& line, uintmax_t request_num, std::ostream& out,
+                              pdftoedn::RequestScheduler& scheduler)
+    {
+        std::string output_filename;
+
+        try
+        {
+            std::vector<std::string> fields;
+            std::stringstream ss(line);
+            std::string field;
+            while (std::getline(ss, field, '\t')) {
+                fields.push_back(field);
+            }
+
+            if (fields.size() < 2 || fields.size() > 5) {
+                throw pdftoedn::init_error("Invalid request - expected <pdf file> <output file> [<page number> [<number of pages> [<lane>]]] separated by tabs");
+            }
+            output_filename = fields[1];
+
+            // the page fields can be left empty when a lane is given
+            intmax_t page_number = -1;
+            intmax_t page_count = -1;
+            if (fields.size() > 2 && !fields[2].empty() &&
+                (!parse_request_int(fields[2], page_number) || page_number < 0)) {
+                std::stringstream err;
+                err << "Invalid page number " << fields[2];
+                throw pdftoedn::init_error(err.str());
+            }
+            if (fields.size() > 3 && !fields[3].empty() &&
+                (!parse_request_int(fields[3], page_count) || page_count < 1)) {
+                std::stringstream err;
+                err << "Invalid number of pages " << fields[3];
+                throw pdftoedn::init_error(err.str());
+            }
+
+            // requests without a lane go in the last one
+            intmax_t lane = scheduler.num_lanes() - 1;
+            if (fields.size() > 4) {
+                lane = scheduler.lane_index(fields[4]);
+                if (lane < 0) {
+                    std::stringstream err;
+                    err << "Invalid lane " << fields[4];
+                    throw pdftoedn::init_error(err.str());
+                }
+            }
+
+            pdftoedn::util::fs::expand_path(fields[0]);
+            pdftoedn::util::fs::expand_path(fields[1]);
+
+            // checks the files - throws if not valid
+            pdftoedn::Options request_opts = pdftoedn::options;
+            request_opts.set_document(fields[0], fields[1], page_number, page_count);
+
+            scheduler.push( new pdftoedn::RequestScheduler::Request(request_num, lane, request_opts) );
+        }
+        catch (std::exception& e) {
+            write_response(out, scheduler, request_num, -1, pdftoedn::ErrorTracker::CODE_INIT_ERROR,
+                           false, 0, output_filename, e.what());
+        }
+    }
+
+
+    //
+    // processes the next page of a request, opening its document and
+    // output on the first one. Its options, exit code, and stats are
+    // swapped in while it runs so it can be paused between pages
+    static void process_request_page(pdftoedn::RequestScheduler::Request& r, std::ostream& out,
+                                     pdftoedn::DocCache& doc_cache, pdftoedn::RequestScheduler& scheduler)
+    {
+        pdftoedn::options = r.opts;
+        pdftoedn::et.reset();
+        std::swap(pdftoedn::stats, r.stats);
+
+        bool processing = r.started();
+        bool done = false;
+        std::string error;
+
+        try
+        {
+            if (!r.started()) {
+                r.reader = doc_cache.get(r.cached);
+                r.reader->check_page_number();
+
+                r.output.open(pdftoedn::options.edn_filename().c_str());
+
+                if (!r.output.is_open()) {
+                    std::stringstream err;
+                    err << pdftoedn::options.edn_filename() << "Cannot open file for write";
+                    throw pdftoedn::invalid_file(err.str());
+                }
+
+                processing = true;
+                r.reader->begin_output(r.output);
+            }
+
+            if (!r.reader->output_next_page(r.output)) {
+                r.reader->end_output(r.output);
+                r.output.close();
+                done = true;
+            }
+
+            r.status |= pdftoedn::et.exit_code();
+        }
+        catch (std::exception& e) {
+            error = e.what();
+            r.status = pdftoedn::ErrorTracker::CODE_INIT_ERROR;
+            done = true;
+        }
+
+        std::swap(pdftoedn::stats, r.stats);
+
+        if (done) {
+            // don't reuse a document that failed mid-way
+            if (r.reader) {
+                doc_cache.release(r.reader, (processing && !error.empty()));
+            }
+
+            write_response(out, scheduler, r.number, r.lane, r.status, r.cached, r.preemptions,
+                           r.opts.edn_filename(), error);
+            scheduler.done(&r);
+        }
+    }
+
+
+    //
+    // queue requests as they are read and run a page of the next
+    // scheduled one until the input is closed and all are done
+    void serve_requests(std::istream& in, std::ostream& out, pdftoedn::DocCache& doc_cache,
+                        pdftoedn::RequestScheduler& scheduler)
+    {
+        RequestInput input;
+
+        std::thread input_reader([&in, &input]() {
+                std::string line;
+                while (std::getline(in, line)) {
+                    std::lock_guard<std::mutex> lock(input.mtx);
+                    input.lines.push_back(line);
+                    input.cv.notify_one();
+                }
+
+                std::lock_guard<std::mutex> lock(input.mtx);
+                input.eof = true;
+                input.cv.notify_one();
+            });
+
+        uintmax_t request_num = 0;
+
+        while (true) {
+            std::deque<std::string> lines;
+            bool eof;
+            {
+                // only wait for more input when there's nothing to do
+                std::unique_lock<std::mutex> lock(input.mtx);
+                input.cv.wait(lock, [&]() {
+                        return (!input.lines.empty() || input.eof || !scheduler.empty());
+                    });
+                lines.swap(input.lines);
+                eof = input.eof;
+            }
+
+            for (const std::string& line : lines) {
+                if (!line.empty()) {
+                    queue_request(line, ++request_num, out, scheduler);
+                }
+            }
+
+            pdftoedn::RequestScheduler::Request* r = scheduler.next();
+            if (!r) {
+                if (eof) {
+                    break;
+                }
+                continue;
+            }
+
+            process_request_page(*r, out, doc_cache, scheduler);
+        }
+
+        input_reader.join();
+    }
+
+} // namespace
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <iostream>
+
+namespace pdftoedn
+{
+    class DocCache;
+    class RequestScheduler;
+
+    // -------------------------------------------------------
+    // server mode: reads one request per line from the input in the
+    // form
+    //
+    //   <pdf file>\t<output file>[\t<page number>[\t<number of pages>[\t<lane>]]]
+    //
+    // and writes a line with the result of each as it completes, e.g.:
+    //
+    //   {:request 1, :status 0, :cached false, :lane :bulk, :preemptions 0,
+    //    :queue_depth {:interactive 0, :bulk 2}, :output "/tmp/doc-1.edn"}
+    //
+    // Input is read on a separate thread so requests are queued while
+    // others are processed. Requests are processed a page at a time
+    // in the order given by the scheduler's lanes, with their options,
+    // exit code and stats swapped in while they run. Documents are
+    // kept open between requests by the cache
+    //
+    void serve_requests(std::istream& in, std::ostream& out, DocCache& doc_cache,
+                        RequestScheduler& scheduler);
+
+} // namespace
@@ -0,0 +1,91 @@
+#include "pdf_span_table.h"
+#include "text.h"
+#include "color.h"
+
+namespace pdftoedn
+{
+    namespace arrow = util::arrow;
+
+    // column order
+    enum {
+        COL_PAGE,
+        COL_X,
+        COL_Y,
+        COL_WIDTH,
+        COL_HEIGHT,
+        COL_FONT_IDX,
+        COL_SIZE,
+        COL_COLOR_IDX,
+        COL_COLOR,
+        COL_TEXT,
+        COL_LINK_IDX,
+    };
+
+    static std::vector<arrow::Field> span_fields()
+    {
+        std::vector<arrow::Field> fields;
+        fields.push_back(arrow::Field("page",      arrow::INT32));
+        fields.push_back(arrow::Field("x",         arrow::FLOAT64));
+        fields.push_back(arrow::Field("y",         arrow::FLOAT64));
+        fields.push_back(arrow::Field("width",     arrow::FLOAT64));
+        fields.push_back(arrow::Field("height",    arrow::FLOAT64));
+        fields.push_back(arrow::Field("font_idx",  arrow::INT32));
+        fields.push_back(arrow::Field("size",      arrow::FLOAT64));
+        fields.push_back(arrow::Field("color_idx", arrow::INT32));
+        fields.push_back(arrow::Field("color",     arrow::UINT32));
+        fields.push_back(arrow::Field("text",      arrow::UTF8));
+        fields.push_back(arrow::Field("link_idx",  arrow::INT32, true));
+        return fields;
+    }
+
+
+    SpanTable::SpanTable() :
+        writer(span_fields())
+    {
+        for (const arrow::Field& f : span_fields()) {
+            columns.push_back(arrow::Column(f.type));
+        }
+    }
+
+    bool SpanTable::open(const std::string& filename)
+    {
+        return writer.open(filename);
+    }
+
+
+    //
+    // add a row for the span
+    void SpanTable::add_span(uintmax_t page_num, const PdfText& span, const RGBColor* color)
+    {
+        const BoundingBox& bbox = span.bounding_box();
+
+        columns[COL_PAGE].push_int(page_num);
+        columns[COL_X].push_double(bbox.x1());
+        columns[COL_Y].push_double(bbox.y1());
+        columns[COL_WIDTH].push_double(bbox.width());
+        columns[COL_HEIGHT].push_double(bbox.height());
+        columns[COL_FONT_IDX].push_int(span.font_index());
+        columns[COL_SIZE].push_double(span.font_size());
+        columns[COL_COLOR_IDX].push_int(span.color_index());
+        columns[COL_COLOR].push_int(color ? color->rgb() : 0);
+        columns[COL_TEXT].push_string(span.text());
+
+        if (span.link_index() != -1) {
+            columns[COL_LINK_IDX].push_int(span.link_index());
+        } else {
+            columns[COL_LINK_IDX].push_null();
+        }
+    }
+
+
+    bool SpanTable::write_page()
+    {
+        bool ok = writer.write_batch(columns);
+
+        for (arrow::Column& c : columns) {
+            c.clear();
+        }
+        return ok;
+    }
+
+} // namespace
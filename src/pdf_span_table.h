@@ -0,0 +1,47 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "util_arrow.h"
+
+namespace pdftoedn
+{
+    class PdfText;
+    class RGBColor;
+
+    // -------------------------------------------------------
+    // writes the document's text spans as a columnar table (Arrow IPC
+    // file) next to the EDN output, with one record batch per page and
+    // one row per span:
+    //
+    // page, x, y, width, height, font_idx, size, color_idx, color,
+    // text, link_idx
+    //
+    // Indices refer to the page's resource tables in the EDN. color is
+    // the span's fill as 0xRRGGBB and link_idx is null for spans
+    // without a link
+    //
+    class SpanTable
+    {
+    public:
+        SpanTable();
+
+        bool open(const std::string& filename);
+
+        void add_span(uintmax_t page_num, const PdfText& span, const RGBColor* color);
+
+        // writes the spans added since the last call as a record batch
+        bool write_page();
+        bool close() { return writer.close(); }
+
+    private:
+        util::arrow::FileWriter writer;
+        std::vector<util::arrow::Column> columns;
+
+        // prohibit
+        SpanTable(const SpanTable&);
+        SpanTable& operator=(const SpanTable&);
+    };
+
+} // namespace
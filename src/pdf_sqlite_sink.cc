@@ -0,0 +1,344 @@
+#include <algorithm>
+
+#include <sqlite3.h>
+
+#include "pdf_sqlite_sink.h"
+#include "base_types.h"
+#include "color.h"
+#include "font.h"
+#include "text.h"
+#include "graphics.h"
+#include "image.h"
+#include "pdf_links.h"
+
+namespace pdftoedn
+{
+    static const char* SCHEMA_SQL =
+        "CREATE TABLE IF NOT EXISTS documents ("
+        "  id INTEGER PRIMARY KEY, filename TEXT, num_pages INTEGER, output TEXT);"
+        "CREATE TABLE IF NOT EXISTS pages ("
+        "  doc_id INTEGER, page INTEGER, width REAL, height REAL, rotation INTEGER,"
+        "  PRIMARY KEY (doc_id, page));"
+        "CREATE TABLE IF NOT EXISTS fonts ("
+        "  doc_id INTEGER, page INTEGER, font_idx INTEGER, name TEXT, family TEXT,"
+        "  embedded INTEGER, bold INTEGER, italic INTEGER,"
+        "  PRIMARY KEY (doc_id, page, font_idx));"
+        "CREATE TABLE IF NOT EXISTS spans ("
+        "  id INTEGER PRIMARY KEY, doc_id INTEGER, page INTEGER, font_idx INTEGER, size REAL,"
+        "  color_idx INTEGER, color INTEGER, link_idx INTEGER, text TEXT);"
+        "CREATE TABLE IF NOT EXISTS paths ("
+        "  id INTEGER PRIMARY KEY, doc_id INTEGER, page INTEGER, type TEXT,"
+        "  color_idx INTEGER, color INTEGER, clip_id INTEGER);"
+        "CREATE TABLE IF NOT EXISTS images ("
+        "  id INTEGER PRIMARY KEY, doc_id INTEGER, page INTEGER, resource_id INTEGER,"
+        "  width INTEGER, height INTEGER, md5 TEXT, filename TEXT, clip_id INTEGER);"
+        "CREATE TABLE IF NOT EXISTS links ("
+        "  id INTEGER PRIMARY KEY, doc_id INTEGER, page INTEGER, link_idx INTEGER,"
+        "  action TEXT, dest TEXT, target_page INTEGER);"
+        "CREATE INDEX IF NOT EXISTS spans_page ON spans (doc_id, page);"
+        "CREATE INDEX IF NOT EXISTS paths_page ON paths (doc_id, page);"
+        "CREATE INDEX IF NOT EXISTS images_page ON images (doc_id, page);"
+        "CREATE INDEX IF NOT EXISTS links_page ON links (doc_id, page);"
+        "CREATE VIRTUAL TABLE IF NOT EXISTS item_bounds USING rtree (id, x1, x2, y1, y2);";
+
+    // must match the Stmt enum
+    static const char* STMT_SQL[] = {
+        "INSERT INTO documents (filename, num_pages, output) VALUES (?, ?, ?)",
+        "INSERT OR REPLACE INTO pages VALUES (?, ?, ?, ?, ?)",
+        "INSERT OR REPLACE INTO fonts VALUES (?, ?, ?, ?, ?, ?, ?, ?)",
+        "INSERT INTO spans VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?)",
+        "INSERT INTO paths VALUES (?, ?, ?, ?, ?, ?, ?)",
+        "INSERT INTO images VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?)",
+        "INSERT INTO links VALUES (?, ?, ?, ?, ?, ?, ?)",
+        "INSERT INTO item_bounds VALUES (?, ?, ?, ?, ?)",
+    };
+
+
+    SqliteSink::SqliteSink() :
+        db(NULL), stmts(STMT_COUNT, NULL),
+        doc_id(-1), page(0), last_item_id(0)
+    {
+    }
+
+    SqliteSink::~SqliteSink()
+    {
+        close();
+    }
+
+
+    //
+    // create the tables if needed and prepare the inserts
+    bool SqliteSink::open(const std::string& db_filename)
+    {
+        close();
+
+        if (sqlite3_open(db_filename.c_str(), &db) != SQLITE_OK) {
+            return fail();
+        }
+
+        // a crash can lose the last pages but won't corrupt the db
+        if (!exec("PRAGMA synchronous = NORMAL;") ||
+            !exec(SCHEMA_SQL)) {
+            return false;
+        }
+
+        for (uintmax_t ii = 0; ii < STMT_COUNT; ++ii) {
+            if (sqlite3_prepare_v2(db, STMT_SQL[ii], -1, &stmts[ii], NULL) != SQLITE_OK) {
+                return fail();
+            }
+        }
+
+        // item ids continue from previous documents in the db
+        sqlite3_stmt* max_id;
+        if (sqlite3_prepare_v2(db, "SELECT IFNULL(MAX(id), 0) FROM item_bounds", -1, &max_id, NULL) != SQLITE_OK) {
+            return fail();
+        }
+        if (sqlite3_step(max_id) == SQLITE_ROW) {
+            last_item_id = sqlite3_column_int64(max_id, 0);
+        }
+        sqlite3_finalize(max_id);
+        return true;
+    }
+
+    void SqliteSink::close()
+    {
+        if (!db) {
+            return;
+        }
+
+        for (sqlite3_stmt*& s : stmts) {
+            sqlite3_finalize(s);
+            s = NULL;
+        }
+        sqlite3_close(db);
+        db = NULL;
+        doc_id = -1;
+    }
+
+
+    bool SqliteSink::add_document(const std::string& pdf_filename, uintmax_t num_pages,
+                                  const std::string& output_filename)
+    {
+        bind(INSERT_DOCUMENT, 1, pdf_filename);
+        bind(INSERT_DOCUMENT, 2, static_cast<intmax_t>(num_pages));
+        bind(INSERT_DOCUMENT, 3, output_filename);
+
+        if (!step(INSERT_DOCUMENT)) {
+            return false;
+        }
+        doc_id = sqlite3_last_insert_rowid(db);
+        return true;
+    }
+
+
+    //
+    // page transactions
+    bool SqliteSink::begin_page(uintmax_t page_num, double width, double height, intmax_t rotation)
+    {
+        page = page_num;
+
+        if (!exec("BEGIN;")) {
+            return false;
+        }
+
+        bind(INSERT_PAGE, 1, doc_id);
+        bind(INSERT_PAGE, 2, static_cast<intmax_t>(page));
+        bind(INSERT_PAGE, 3, width);
+        bind(INSERT_PAGE, 4, height);
+        bind(INSERT_PAGE, 5, rotation);
+
+        // callers only end pages that began
+        if (!step(INSERT_PAGE)) {
+            return end_page(false);
+        }
+        return true;
+    }
+
+    bool SqliteSink::end_page(bool commit)
+    {
+        if (commit) {
+            return exec("COMMIT;");
+        }
+
+        // keep the error that caused the rollback
+        sqlite3_exec(db, "ROLLBACK;", NULL, NULL, NULL);
+        return false;
+    }
+
+
+    //
+    // resources and items
+    bool SqliteSink::add_font(uintmax_t font_idx, const PdfFont& font)
+    {
+        bind(INSERT_FONT, 1, doc_id);
+        bind(INSERT_FONT, 2, static_cast<intmax_t>(page));
+        bind(INSERT_FONT, 3, static_cast<intmax_t>(font_idx));
+        bind(INSERT_FONT, 4, font.name());
+        bind(INSERT_FONT, 5, font.family());
+        bind(INSERT_FONT, 6, static_cast<intmax_t>(font.is_embedded()));
+        bind(INSERT_FONT, 7, static_cast<intmax_t>(font.is_bold()));
+        bind(INSERT_FONT, 8, static_cast<intmax_t>(font.is_italic()));
+        return step(INSERT_FONT);
+    }
+
+    bool SqliteSink::add_span(const PdfText& span, const RGBColor* color)
+    {
+        intmax_t id;
+        if (!add_item_bounds(span.bounding_box(), id)) {
+            return false;
+        }
+
+        bind(INSERT_SPAN, 1, id);
+        bind(INSERT_SPAN, 2, doc_id);
+        bind(INSERT_SPAN, 3, static_cast<intmax_t>(page));
+        bind_index(INSERT_SPAN, 4, span.font_index());
+        bind(INSERT_SPAN, 5, span.font_size());
+        bind_index(INSERT_SPAN, 6, span.color_index());
+        bind_index(INSERT_SPAN, 7, (color ? static_cast<intmax_t>(color->rgb()) : -1));
+        bind_index(INSERT_SPAN, 8, span.link_index());
+        bind(INSERT_SPAN, 9, span.text());
+        return step(INSERT_SPAN);
+    }
+
+    bool SqliteSink::add_path(const PdfDocPath& path, const RGBColor* color)
+    {
+        intmax_t id;
+        if (!add_item_bounds(path.bounding_box(), id)) {
+            return false;
+        }
+
+        bind(INSERT_PATH, 1, id);
+        bind(INSERT_PATH, 2, doc_id);
+        bind(INSERT_PATH, 3, static_cast<intmax_t>(page));
+        bind(INSERT_PATH, 4, PdfDocPath::SYMBOL_PATH_TYPES[ path.type() ].name());
+        bind_index(INSERT_PATH, 5, path.color_index());
+        bind_index(INSERT_PATH, 6, (color ? static_cast<intmax_t>(color->rgb()) : -1));
+        bind_index(INSERT_PATH, 7, path.id());
+        return step(INSERT_PATH);
+    }
+
+    bool SqliteSink::add_image(const PdfImage& image, const ImageData* data)
+    {
+        intmax_t id;
+        if (!add_item_bounds(image.bounding_box(), id)) {
+            return false;
+        }
+
+        bind(INSERT_IMAGE, 1, id);
+        bind(INSERT_IMAGE, 2, doc_id);
+        bind(INSERT_IMAGE, 3, static_cast<intmax_t>(page));
+        bind(INSERT_IMAGE, 4, image.resource_id());
+        if (data) {
+            bind(INSERT_IMAGE, 5, static_cast<intmax_t>(data->pixel_width()));
+            bind(INSERT_IMAGE, 6, static_cast<intmax_t>(data->pixel_height()));
+            bind(INSERT_IMAGE, 7, data->md5());
+            bind(INSERT_IMAGE, 8, data->filename());
+        } else {
+            for (int pos = 5; pos <= 8; ++pos) {
+                bind_null(INSERT_IMAGE, pos);
+            }
+        }
+        bind_index(INSERT_IMAGE, 9, image.clip_id());
+        return step(INSERT_IMAGE);
+    }
+
+    bool SqliteSink::add_link(uintmax_t link_idx, const PdfAnnotLink& link)
+    {
+        intmax_t id;
+        if (!add_item_bounds(link.bounding_box(), id)) {
+            return false;
+        }
+
+        bind(INSERT_LINK, 1, id);
+        bind(INSERT_LINK, 2, doc_id);
+        bind(INSERT_LINK, 3, static_cast<intmax_t>(page));
+        bind(INSERT_LINK, 4, static_cast<intmax_t>(link_idx));
+        bind(INSERT_LINK, 5, PdfAnnotLink::SYMBOL_ACTION_TYPES[ link.action_type() ].name());
+
+        const PdfAnnotLinkDest* dest_link = dynamic_cast<const PdfAnnotLinkDest*>(&link);
+        if (dest_link) {
+            bind(INSERT_LINK, 6, dest_link->destination());
+        } else {
+            bind_null(INSERT_LINK, 6);
+        }
+
+        const PdfAnnotLinkGoto* goto_link = dynamic_cast<const PdfAnnotLinkGoto*>(&link);
+        if (goto_link) {
+            bind(INSERT_LINK, 7, static_cast<intmax_t>(goto_link->target_page()));
+        } else {
+            bind_null(INSERT_LINK, 7);
+        }
+        return step(INSERT_LINK);
+    }
+
+
+    bool SqliteSink::add_item_bounds(const BoundingBox& bbox, intmax_t& item_id)
+    {
+        item_id = ++last_item_id;
+
+        // the R*Tree rejects boxes with min > max
+        bind(INSERT_BOUNDS, 1, item_id);
+        bind(INSERT_BOUNDS, 2, std::min(bbox.x1(), bbox.x2()));
+        bind(INSERT_BOUNDS, 3, std::max(bbox.x1(), bbox.x2()));
+        bind(INSERT_BOUNDS, 4, std::min(bbox.y1(), bbox.y2()));
+        bind(INSERT_BOUNDS, 5, std::max(bbox.y1(), bbox.y2()));
+        return step(INSERT_BOUNDS);
+    }
+
+
+    //
+    // sqlite helpers
+    bool SqliteSink::exec(const char* sql)
+    {
+        if (sqlite3_exec(db, sql, NULL, NULL, NULL) != SQLITE_OK) {
+            return fail();
+        }
+        return true;
+    }
+
+    bool SqliteSink::fail()
+    {
+        err_msg = (db ? sqlite3_errmsg(db) : "out of memory");
+        return false;
+    }
+
+    void SqliteSink::bind(Stmt s, int pos, intmax_t v)
+    {
+        sqlite3_bind_int64(stmts[s], pos, v);
+    }
+
+    void SqliteSink::bind(Stmt s, int pos, double v)
+    {
+        sqlite3_bind_double(stmts[s], pos, v);
+    }
+
+    void SqliteSink::bind(Stmt s, int pos, const std::string& v)
+    {
+        sqlite3_bind_text(stmts[s], pos, v.c_str(), v.length(), SQLITE_TRANSIENT);
+    }
+
+    void SqliteSink::bind_index(Stmt s, int pos, intmax_t idx)
+    {
+        if (idx == -1) {
+            bind_null(s, pos);
+        } else {
+            bind(s, pos, idx);
+        }
+    }
+
+    void SqliteSink::bind_null(Stmt s, int pos)
+    {
+        sqlite3_bind_null(stmts[s], pos);
+    }
+
+    bool SqliteSink::step(Stmt s)
+    {
+        bool ok = (sqlite3_step(stmts[s]) == SQLITE_DONE);
+        if (!ok) {
+            fail();
+        }
+        sqlite3_reset(stmts[s]);
+        return ok;
+    }
+
+} // namespace
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+struct sqlite3;
+struct sqlite3_stmt;
+
+namespace pdftoedn
+{
+    class BoundingBox;
+    class RGBColor;
+    class PdfFont;
+    class PdfText;
+    class PdfDocPath;
+    class PdfImage;
+    class ImageData;
+    class PdfAnnotLink;
+
+    // -------------------------------------------------------
+    // writes the extracted data to an SQLite database so it can be
+    // queried without a separate import. Documents are appended to
+    // the tables:
+    //
+    // documents (id, filename, num_pages, output)
+    // pages     (doc_id, page, width, height, rotation)
+    // fonts     (doc_id, page, font_idx, name, family, embedded, bold, italic)
+    // spans     (id, doc_id, page, font_idx, size, color_idx, color, link_idx, text)
+    // paths     (id, doc_id, page, type, color_idx, color, clip_id)
+    // images    (id, doc_id, page, resource_id, width, height, md5, filename, clip_id)
+    // links     (id, doc_id, page, link_idx, action, dest, target_page)
+    //
+    // Spans, paths, images, and links share an id space and their
+    // bounding boxes are stored in the item_bounds R*Tree, e.g.:
+    //
+    // SELECT s.page, s.text FROM item_bounds b JOIN spans s ON s.id = b.id
+    //  WHERE b.x1 >= 72 AND b.x2 <= 300 AND b.y1 >= 72 AND b.y2 <= 400
+    //    AND s.doc_id = 1 AND s.page BETWEEN 10 AND 40;
+    //
+    // Colors are stored as 0xRRGGBB. Each page is inserted in its own
+    // transaction using prepared statements.
+    //
+    class SqliteSink
+    {
+    public:
+        SqliteSink();
+        ~SqliteSink();
+
+        // opens or creates the database and its tables
+        bool open(const std::string& db_filename);
+        void close();
+
+        // adds the document entry the following pages are linked to
+        bool add_document(const std::string& pdf_filename, uintmax_t num_pages,
+                          const std::string& output_filename);
+
+        // inserts between begin_page() and end_page() are committed
+        // together. Rolled back if end_page() is passed false
+        bool begin_page(uintmax_t page_num, double width, double height, intmax_t rotation);
+        bool end_page(bool commit = true);
+
+        bool add_font(uintmax_t font_idx, const PdfFont& font);
+        bool add_span(const PdfText& span, const RGBColor* color);
+        bool add_path(const PdfDocPath& path, const RGBColor* color);
+        bool add_image(const PdfImage& image, const ImageData* data);
+        bool add_link(uintmax_t link_idx, const PdfAnnotLink& link);
+
+        // last SQLite error message
+        const std::string& error() const { return err_msg; }
+
+    private:
+        enum Stmt {
+            INSERT_DOCUMENT,
+            INSERT_PAGE,
+            INSERT_FONT,
+            INSERT_SPAN,
+            INSERT_PATH,
+            INSERT_IMAGE,
+            INSERT_LINK,
+            INSERT_BOUNDS,
+
+            STMT_COUNT // delim
+        };
+
+        sqlite3* db;
+        std::vector<sqlite3_stmt*> stmts;
+        std::string err_msg;
+        intmax_t doc_id;
+        uintmax_t page;
+        intmax_t last_item_id;
+
+        bool exec(const char* sql);
+        bool fail();
+
+        // bind helpers - positions are 1-based. Indices of -1 are
+        // stored as NULL
+        void bind(Stmt s, int pos, intmax_t v);
+        void bind(Stmt s, int pos, double v);
+        void bind(Stmt s, int pos, const std::string& v);
+        void bind_index(Stmt s, int pos, intmax_t idx);
+        void bind_null(Stmt s, int pos);
+        bool step(Stmt s);
+
+        // allocates the item's id and indexes its bounding box
+        bool add_item_bounds(const BoundingBox& bbox, intmax_t& item_id);
+
+        // prohibit
+        SqliteSink(const SqliteSink&);
+        SqliteSink& operator=(const SqliteSink&);
+    };
+
+} // namespace
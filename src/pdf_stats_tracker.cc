@@ -0,0 +1,50 @@
+#include <string>
+#include <map>
+
+#include "pdf_stats_tracker.h"
+#include "util_edn.h"
+
+namespace pdftoedn
+{
+    const Symbol StatsTracker::SYMBOL_STATS              = "stats";
+
+    //
+    // returns the counter value or 0 if not set
+    uintmax_t StatsTracker::count(const std::string& group, const std::string& name) const
+    {
+        auto g = groups.find(group);
+        if (g == groups.end()) {
+            return 0;
+        }
+
+        auto v = g->second.find(name);
+        if (v == g->second.end()) {
+            return 0;
+        }
+        return v->second.count;
+    }
+
+
+    //
+    // output the counters as a hash of hashes
+    std::ostream& StatsTracker::to_edn(std::ostream& o) const
+    {
+        util::edn::Hash stats_h(groups.size());
+
+        for (const auto& g : groups) {
+            util::edn::Hash group_h(g.second.size());
+
+            for (const auto& v : g.second) {
+                if (v.second.is_time) {
+                    group_h.push( Symbol(v.first), v.second.ms );
+                } else {
+                    group_h.push( Symbol(v.first), v.second.count );
+                }
+            }
+            stats_h.push( Symbol(g.first), group_h );
+        }
+        o << stats_h;
+        return o;
+    }
+
+} // namespace
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <string>
+#include <map>
+
+#include "base_types.h"
+
+namespace pdftoedn
+{
+    // ----------------------------------
+    // document-wide processing counters. Values are grouped by
+    // category (e.g., "png_gray") and included in the output when
+    // debug meta is requested
+    //
+    struct StatsTracker : public gemable {
+
+        static const Symbol SYMBOL_STATS;
+
+        StatsTracker() {}
+
+        void add(const std::string& group, const std::string& name, uintmax_t v = 1) {
+            groups[group][name].count += v;
+        }
+        void add_time(const std::string& group, const std::string& name, double ms) {
+            Value& val = groups[group][name];
+            val.is_time = true;
+            val.ms += ms;
+        }
+
+        uintmax_t count(const std::string& group, const std::string& name) const;
+        bool empty() const { return groups.empty(); }
+        void clear() { groups.clear(); }
+
+        virtual std::ostream& to_edn(std::ostream& o) const;
+
+    private:
+        struct Value {
+            Value() : is_time(false), count(0), ms(0) {}
+
+            bool is_time;
+            uintmax_t count;
+            double ms;
+        };
+
+        std::map<std::string, std::map<std::string, Value> > groups;
+    };
+
+    extern pdftoedn::StatsTracker stats;
+} // namespace
@@ -0,0 +1,1102 @@
+#include <cstring>
+#include <algorithm>
+
+#include <poppler/XRef.h>
+#include <poppler/Catalog.h>
+#include <poppler/Page.h>
+#include <poppler/Annot.h>
+#include <poppler/Array.h>
+#include <poppler/Dict.h>
+#include <poppler/Lexer.h>
+#include <poppler/Parser.h>
+#include <poppler/Gfx.h>
+#include <poppler/GfxState.h>
+#include <poppler/GfxFont.h>
+#include <poppler/OutputDev.h>
+#include <poppler/goo/GooString.h>
+
+#include "pdf_text_interpreter.h"
+
+namespace pdftoedn
+{
+    // same resolution PDFReader displays pages at
+    static const double PAGE_DPI = 72.0;
+
+    enum OpCode {
+        OP_SAVE, OP_RESTORE, OP_CONCAT,
+        OP_BEGIN_TEXT, OP_END_TEXT,
+        OP_CHAR_SPACE, OP_WORD_SPACE, OP_HORIZ_SCALING, OP_LEADING,
+        OP_FONT, OP_RENDER, OP_RISE,
+        OP_MOVE, OP_MOVE_SET_LEADING, OP_TEXT_MATRIX, OP_NEXT_LINE,
+        OP_SHOW, OP_SHOW_SPACED, OP_NEXT_LINE_SHOW, OP_NEXT_LINE_SET_SHOW,
+        OP_FILL_GRAY, OP_STROKE_GRAY, OP_FILL_RGB, OP_STROKE_RGB,
+        OP_FILL_CMYK, OP_STROKE_CMYK,
+        OP_FILL_CSPACE, OP_STROKE_CSPACE, OP_FILL_COLOR, OP_STROKE_COLOR,
+        OP_EXT_GSTATE, OP_XOBJECT,
+        OP_BEGIN_MARKED, OP_END_MARKED,
+        OP_MOVE_TO, OP_LINE_TO, OP_CURVE_TO, OP_CURVE_TO_1, OP_CURVE_TO_2,
+        OP_RECTANGLE, OP_CLOSE_PATH, OP_END_PATH,
+        OP_STROKE, OP_CLOSE_STROKE, OP_FILL, OP_EO_FILL,
+        OP_FILL_STROKE, OP_EO_FILL_STROKE, OP_CLOSE_FILL_STROKE, OP_CLOSE_EO_FILL_STROKE,
+        OP_CLIP, OP_EO_CLIP,
+        OP_SHADING_FILL, OP_INLINE_IMAGE
+    };
+
+    // operators that are interpreted with the number of arguments
+    // they take (negative for a variable count up to that
+    // number). Anything else is skipped. Sorted for binary search
+    struct Operator {
+        const char* name;
+        int num_args;
+        OpCode code;
+    };
+
+    static const Operator OPERATORS[] = {
+        { "\"",  3, OP_NEXT_LINE_SET_SHOW },
+        { "'",   1, OP_NEXT_LINE_SHOW },
+        { "B",   0, OP_FILL_STROKE },
+        { "B*",  0, OP_EO_FILL_STROKE },
+        { "BDC", 2, OP_BEGIN_MARKED },
+        { "BI",  0, OP_INLINE_IMAGE },
+        { "BMC", 1, OP_BEGIN_MARKED },
+        { "BT",  0, OP_BEGIN_TEXT },
+        { "CS",  1, OP_STROKE_CSPACE },
+        { "Do",  1, OP_XOBJECT },
+        { "EMC", 0, OP_END_MARKED },
+        { "ET",  0, OP_END_TEXT },
+        { "F",   0, OP_FILL },
+        { "G",   1, OP_STROKE_GRAY },
+        { "K",   4, OP_STROKE_CMYK },
+        { "Q",   0, OP_RESTORE },
+        { "RG",  3, OP_STROKE_RGB },
+        { "S",   0, OP_STROKE },
+        { "SC", -4, OP_STROKE_COLOR },
+        { "SCN", -TextInterpreter::MAX_ARGS, OP_STROKE_COLOR },
+        { "T*",  0, OP_NEXT_LINE },
+        { "TD",  2, OP_MOVE_SET_LEADING },
+        { "TJ",  1, OP_SHOW_SPACED },
+        { "TL",  1, OP_LEADING },
+        { "Tc",  1, OP_CHAR_SPACE },
+        { "Td",  2, OP_MOVE },
+        { "Tf",  2, OP_FONT },
+        { "Tj",  1, OP_SHOW },
+        { "Tm",  6, OP_TEXT_MATRIX },
+        { "Tr",  1, OP_RENDER },
+        { "Ts",  1, OP_RISE },
+        { "Tw",  1, OP_WORD_SPACE },
+        { "Tz",  1, OP_HORIZ_SCALING },
+        { "W",   0, OP_CLIP },
+        { "W*",  0, OP_EO_CLIP },
+        { "b",   0, OP_CLOSE_FILL_STROKE },
+        { "b*",  0, OP_CLOSE_EO_FILL_STROKE },
+        { "c",   6, OP_CURVE_TO },
+        { "cm",  6, OP_CONCAT },
+        { "cs",  1, OP_FILL_CSPACE },
+        { "f",   0, OP_FILL },
+        { "f*",  0, OP_EO_FILL },
+        { "g",   1, OP_FILL_GRAY },
+        { "gs",  1, OP_EXT_GSTATE },
+        { "h",   0, OP_CLOSE_PATH },
+        { "k",   4, OP_FILL_CMYK },
+        { "l",   2, OP_LINE_TO },
+        { "m",   2, OP_MOVE_TO },
+        { "n",   0, OP_END_PATH },
+        { "q",   0, OP_SAVE },
+        { "re",  4, OP_RECTANGLE },
+        { "rg",  3, OP_FILL_RGB },
+        { "s",   0, OP_CLOSE_STROKE },
+        { "sc", -4, OP_FILL_COLOR },
+        { "scn", -TextInterpreter::MAX_ARGS, OP_FILL_COLOR },
+        { "sh",  1, OP_SHADING_FILL },
+        { "v",   4, OP_CURVE_TO_1 },
+        { "y",   4, OP_CURVE_TO_2 },
+    };
+
+    static const Operator* find_operator(const char* name)
+    {
+        const Operator* end = OPERATORS + sizeof(OPERATORS) / sizeof(OPERATORS[0]);
+        const Operator* op = std::lower_bound(OPERATORS, end, name,
+                                              [](const Operator& o, const char* n) { return std::strcmp(o.name, n) < 0; });
+        if (op == end || std::strcmp(op->name, name) != 0) {
+            return NULL;
+        }
+        return op;
+    }
+
+    static bool all_nums(Object args[], int num_args)
+    {
+        for (int i = 0; i < num_args; ++i) {
+            if (!args[i].isNum()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+
+    TextInterpreter::TextInterpreter(XRef* doc_xref, Catalog* doc_catalog, ::OutputDev* dev) :
+        xref(doc_xref), catalog(doc_catalog), out(dev),
+        state(NULL), res(NULL),
+        font_changed(false), clip_mode(CLIP_NONE), form_depth(0), state_depth(0),
+        unsupported_reason(NULL)
+    {
+    }
+
+
+    //
+    // set up the state as poppler's Gfx does and run through the
+    // page's content
+    bool TextInterpreter::display_page(int page_num)
+    {
+        unsupported_reason = NULL;
+
+        Page* page = catalog->getPage(page_num);
+        if (!page || !page->isOk()) {
+            return abandon("page");
+        }
+
+        // annotation appearance streams are drawn by poppler after
+        // the page content. Links don't have any
+        Annots* annots = page->getAnnots();
+        if (annots) {
+            for (int i = 0; i < annots->getNumAnnots(); ++i) {
+                if (annots->getAnnot(i)->getType() != Annot::typeLink) {
+                    return abandon("annotations");
+                }
+            }
+        }
+
+        state = new GfxState(PAGE_DPI, PAGE_DPI, page->getCropBox(), page->getRotate(), out->upsideDown());
+        res = new GfxResources(xref, page->getResourceDict(), NULL);
+        font_changed = false;
+        clip_mode = CLIP_NONE;
+        form_depth = state_depth = 0;
+
+        out->startPage(page_num, state, xref);
+        out->setDefaultCTM(state->getCTM());
+        out->updateAll(state);
+
+        // pages are displayed cropped
+        PDFRectangle* crop_box = page->getCropBox();
+        clip_to_rect(crop_box->x1, crop_box->y1, crop_box->x2, crop_box->y2);
+
+        bool status = true;
+        Object contents;
+        page->getContents(&contents);
+
+        if (!contents.isNull()) {
+            save_state();
+            status = display(&contents);
+            if (status) {
+                restore_state();
+            }
+        } else {
+            out->dump();
+        }
+        contents.free();
+
+        if (status) {
+            while (state_depth > 0) {
+                restore_state();
+            }
+            out->endPage();
+        }
+
+        cleanup();
+        return status;
+    }
+
+
+    //
+    // tokenize the content stream(s) and execute the operators
+    bool TextInterpreter::display(Object* contents)
+    {
+        if (contents->isArray()) {
+            for (int i = 0; i < contents->arrayGetLength(); ++i) {
+                Object obj;
+                bool is_stream = contents->arrayGet(i, &obj)->isStream();
+                obj.free();
+                if (!is_stream) {
+                    // poppler reports these and draws nothing
+                    return true;
+                }
+            }
+        } else if (!contents->isStream()) {
+            return true;
+        }
+
+        // unbalanced q operators are restored at the end of the
+        // stream
+        state_guards.push(state_depth);
+
+        Parser parser(xref, new Lexer(xref, contents), gFalse);
+        Object args[MAX_ARGS];
+        int num_args = 0;
+        bool status = true;
+
+        Object obj;
+        parser.getObj(&obj);
+
+        while (!obj.isEOF()) {
+            if (obj.isCmd()) {
+                status = exec_op(obj.getCmd(), args, num_args);
+                obj.free();
+                for (int i = 0; i < num_args; ++i) {
+                    args[i].free();
+                }
+                num_args = 0;
+
+                if (!status) {
+                    break;
+                }
+            } else if (num_args < MAX_ARGS) {
+                args[num_args++] = obj;
+            } else {
+                obj.free();
+            }
+
+            parser.getObj(&obj);
+        }
+        obj.free();
+
+        for (int i = 0; i < num_args; ++i) {
+            args[i].free();
+        }
+
+        if (status) {
+            while (state_depth > state_guards.top()) {
+                restore_state();
+            }
+        }
+        state_guards.pop();
+        return status;
+    }
+
+
+    //
+    // returns false if the page must be processed by poppler
+    bool TextInterpreter::exec_op(const char* name, Object args[], int num_args)
+    {
+        const Operator* op = find_operator(name);
+        if (!op) {
+            return true;
+        }
+
+        // poppler reports and skips operators with too few or too
+        // many arguments and uses the last ones if there are extras
+        if (op->num_args >= 0) {
+            if (num_args < op->num_args) {
+                return true;
+            }
+            args += num_args - op->num_args;
+            num_args = op->num_args;
+        } else if (num_args > -op->num_args) {
+            return true;
+        }
+
+        switch (op->code)
+        {
+          case OP_SAVE:
+              save_state();
+              break;
+          case OP_RESTORE:
+              restore_state();
+              break;
+          case OP_CONCAT:
+              if (all_nums(args, 6)) {
+                  state->concatCTM(args[0].getNum(), args[1].getNum(), args[2].getNum(),
+                                   args[3].getNum(), args[4].getNum(), args[5].getNum());
+                  out->updateCTM(state, args[0].getNum(), args[1].getNum(), args[2].getNum(),
+                                 args[3].getNum(), args[4].getNum(), args[5].getNum());
+                  font_changed = true;
+              }
+              break;
+
+          case OP_BEGIN_TEXT:
+              out->beginTextObject(state);
+              state->setTextMat(1, 0, 0, 1, 0, 0);
+              state->textMoveTo(0, 0);
+              out->updateTextMat(state);
+              out->updateTextPos(state);
+              font_changed = true;
+              break;
+          case OP_END_TEXT:
+              out->endTextObject(state);
+              break;
+
+          case OP_CHAR_SPACE:
+              if (args[0].isNum()) {
+                  state->setCharSpace(args[0].getNum());
+                  out->updateCharSpace(state);
+              }
+              break;
+          case OP_WORD_SPACE:
+              if (args[0].isNum()) {
+                  state->setWordSpace(args[0].getNum());
+                  out->updateWordSpace(state);
+              }
+              break;
+          case OP_HORIZ_SCALING:
+              if (args[0].isNum()) {
+                  state->setHorizScaling(args[0].getNum());
+                  out->updateHorizScaling(state);
+                  font_changed = true;
+              }
+              break;
+          case OP_LEADING:
+              if (args[0].isNum()) {
+                  state->setLeading(args[0].getNum());
+              }
+              break;
+          case OP_FONT:
+              if (args[0].isName() && args[1].isNum()) {
+                  return set_font(args);
+              }
+              break;
+          case OP_RENDER:
+              if (args[0].isInt()) {
+                  state->setRender(args[0].getInt());
+                  out->updateRender(state);
+              }
+              break;
+          case OP_RISE:
+              if (args[0].isNum()) {
+                  state->setRise(args[0].getNum());
+                  out->updateRise(state);
+              }
+              break;
+
+          case OP_MOVE:
+              if (all_nums(args, 2)) {
+                  state->textMoveTo(state->getLineX() + args[0].getNum(),
+                                    state->getLineY() + args[1].getNum());
+                  out->updateTextPos(state);
+              }
+              break;
+          case OP_MOVE_SET_LEADING:
+              if (all_nums(args, 2)) {
+                  state->setLeading(-args[1].getNum());
+                  state->textMoveTo(state->getLineX() + args[0].getNum(),
+                                    state->getLineY() + args[1].getNum());
+                  out->updateTextPos(state);
+              }
+              break;
+          case OP_TEXT_MATRIX:
+              if (all_nums(args, 6)) {
+                  state->setTextMat(args[0].getNum(), args[1].getNum(), args[2].getNum(),
+                                    args[3].getNum(), args[4].getNum(), args[5].getNum());
+                  state->textMoveTo(0, 0);
+                  out->updateTextMat(state);
+                  out->updateTextPos(state);
+                  font_changed = true;
+              }
+              break;
+          case OP_NEXT_LINE:
+              move_to_next_line();
+              break;
+
+          case OP_SHOW:
+              if (args[0].isString() && font_ready()) {
+                  show_text(args[0].getString());
+              }
+              break;
+          case OP_SHOW_SPACED:
+              if (args[0].isArray() && font_ready()) {
+                  show_space_text(args[0].getArray());
+              }
+              break;
+          case OP_NEXT_LINE_SHOW:
+              if (args[0].isString() && font_ready()) {
+                  move_to_next_line();
+                  show_text(args[0].getString());
+              }
+              break;
+          case OP_NEXT_LINE_SET_SHOW:
+              if (all_nums(args, 2) && args[2].isString() && font_ready()) {
+                  state->setWordSpace(args[0].getNum());
+                  state->setCharSpace(args[1].getNum());
+                  out->updateWordSpace(state);
+                  out->updateCharSpace(state);
+                  move_to_next_line();
+                  show_text(args[2].getString());
+              }
+              break;
+
+          case OP_FILL_GRAY:
+              return set_device_color(true, new GfxDeviceGrayColorSpace(), args, num_args);
+          case OP_STROKE_GRAY:
+              return set_device_color(false, new GfxDeviceGrayColorSpace(), args, num_args);
+          case OP_FILL_RGB:
+              return set_device_color(true, new GfxDeviceRGBColorSpace(), args, num_args);
+          case OP_STROKE_RGB:
+              return set_device_color(false, new GfxDeviceRGBColorSpace(), args, num_args);
+          case OP_FILL_CMYK:
+              return set_device_color(true, new GfxDeviceCMYKColorSpace(), args, num_args);
+          case OP_STROKE_CMYK:
+              return set_device_color(false, new GfxDeviceCMYKColorSpace(), args, num_args);
+          case OP_FILL_CSPACE:
+              return set_color_space(true, args[0]);
+          case OP_STROKE_CSPACE:
+              return set_color_space(false, args[0]);
+          case OP_FILL_COLOR:
+              return set_color(true, args, num_args);
+          case OP_STROKE_COLOR:
+              return set_color(false, args, num_args);
+
+          case OP_EXT_GSTATE:
+              return set_gstate(args[0]);
+          case OP_XOBJECT:
+              return draw_xobject(args[0]);
+
+          case OP_BEGIN_MARKED:
+              return begin_marked_content(args, num_args);
+          case OP_END_MARKED:
+              end_marked_content();
+              break;
+
+          case OP_MOVE_TO:
+              if (all_nums(args, 2)) {
+                  state->moveTo(args[0].getNum(), args[1].getNum());
+              }
+              break;
+          case OP_LINE_TO:
+              if (all_nums(args, 2) && state->isCurPt()) {
+                  state->lineTo(args[0].getNum(), args[1].getNum());
+              }
+              break;
+          case OP_CURVE_TO:
+              if (all_nums(args, 6) && state->isCurPt()) {
+                  state->curveTo(args[0].getNum(), args[1].getNum(), args[2].getNum(),
+                                 args[3].getNum(), args[4].getNum(), args[5].getNum());
+              }
+              break;
+          case OP_CURVE_TO_1:
+              if (all_nums(args, 4) && state->isCurPt()) {
+                  state->curveTo(state->getCurX(), state->getCurY(), args[0].getNum(), args[1].getNum(),
+                                 args[2].getNum(), args[3].getNum());
+              }
+              break;
+          case OP_CURVE_TO_2:
+              if (all_nums(args, 4) && state->isCurPt()) {
+                  state->curveTo(args[0].getNum(), args[1].getNum(), args[2].getNum(),
+                                 args[3].getNum(), args[2].getNum(), args[3].getNum());
+              }
+              break;
+          case OP_RECTANGLE:
+              if (all_nums(args, 4)) {
+                  double x = args[0].getNum(), y = args[1].getNum();
+                  double w = args[2].getNum(), h = args[3].getNum();
+                  state->moveTo(x, y);
+                  state->lineTo(x + w, y);
+                  state->lineTo(x + w, y + h);
+                  state->lineTo(x, y + h);
+                  state->closePath();
+              }
+              break;
+          case OP_CLOSE_PATH:
+              if (state->isCurPt()) {
+                  state->closePath();
+              }
+              break;
+          case OP_END_PATH:
+              end_path();
+              break;
+
+          case OP_STROKE:
+          case OP_CLOSE_STROKE:
+          case OP_FILL:
+          case OP_EO_FILL:
+          case OP_FILL_STROKE:
+          case OP_EO_FILL_STROKE:
+          case OP_CLOSE_FILL_STROKE:
+          case OP_CLOSE_EO_FILL_STROKE:
+              paint_path(op->code);
+              break;
+          case OP_CLIP:
+              clip_mode = CLIP_NORMAL;
+              break;
+          case OP_EO_CLIP:
+              clip_mode = CLIP_EO;
+              break;
+
+          case OP_SHADING_FILL:
+              // poppler clips to the shading's bbox while painting it
+              return abandon("shading");
+          case OP_INLINE_IMAGE:
+              // the image data must be read through its filters to
+              // find where it ends
+              return abandon("inline_image");
+        }
+        return true;
+    }
+
+
+    //
+    // paths - painted and ended as poppler's Gfx does so the device
+    // gets the same fill and clip callbacks
+    void TextInterpreter::paint_path(int code)
+    {
+        if (!state->isCurPt()) {
+            return;
+        }
+
+        if (state->isPath()) {
+            if (code == OP_CLOSE_STROKE || code == OP_CLOSE_FILL_STROKE ||
+                code == OP_CLOSE_EO_FILL_STROKE) {
+                state->closePath();
+            }
+
+            if (code == OP_FILL || code == OP_FILL_STROKE || code == OP_CLOSE_FILL_STROKE) {
+                out->fill(state);
+            } else if (code == OP_EO_FILL || code == OP_EO_FILL_STROKE ||
+                       code == OP_CLOSE_EO_FILL_STROKE) {
+                out->eoFill(state);
+            }
+
+            if (code != OP_FILL && code != OP_EO_FILL) {
+                out->stroke(state);
+            }
+        }
+        end_path();
+    }
+
+    void TextInterpreter::end_path()
+    {
+        if (state->isCurPt() && clip_mode != CLIP_NONE) {
+            state->clip();
+            if (clip_mode == CLIP_NORMAL) {
+                out->clip(state);
+            } else {
+                out->eoClip(state);
+            }
+        }
+        clip_mode = CLIP_NONE;
+        state->clearPath();
+    }
+
+    void TextInterpreter::clip_to_rect(double x1, double y1, double x2, double y2)
+    {
+        state->moveTo(x1, y1);
+        state->lineTo(x2, y1);
+        state->lineTo(x2, y2);
+        state->lineTo(x1, y2);
+        state->closePath();
+        state->clip();
+        out->clip(state);
+        state->clearPath();
+    }
+
+
+    //
+    // graphics state
+    void TextInterpreter::save_state()
+    {
+        out->saveState(state);
+        state = state->save();
+        state_depth++;
+    }
+
+    void TextInterpreter::restore_state()
+    {
+        // poppler ignores Q operators without a matching q in the
+        // same stream
+        if (state_depth <= (state_guards.empty() ? 0 : state_guards.top()) ||
+            !state->hasSaves()) {
+            return;
+        }
+
+        state = state->restore();
+        out->restoreState(state);
+        state_depth--;
+    }
+
+    //
+    // only the ExtGState entries that affect text attributes are
+    // read
+    bool TextInterpreter::set_gstate(Object& name)
+    {
+        if (!name.isName()) {
+            return true;
+        }
+
+        Object gstate;
+        if (!res->lookupGState(name.getName(), &gstate) || !gstate.isDict()) {
+            gstate.free();
+            return true;
+        }
+
+        Object obj;
+        bool needs_gfx = (gstate.dictLookup("Font", &obj)->isArray());
+        obj.free();
+        // soft masks are drawn by interpreting their group
+        needs_gfx = needs_gfx || (gstate.dictLookup("SMask", &obj)->isDict());
+        obj.free();
+
+        if (needs_gfx) {
+            gstate.free();
+            return abandon("ext_gstate");
+        }
+
+        if (gstate.dictLookup("CA", &obj)->isNum()) {
+            state->setStrokeOpacity(obj.getNum());
+            out->updateStrokeOpacity(state);
+        }
+        obj.free();
+
+        if (gstate.dictLookup("ca", &obj)->isNum()) {
+            state->setFillOpacity(obj.getNum());
+            out->updateFillOpacity(state);
+        }
+        obj.free();
+
+        bool fill_op_set = false;
+        if (gstate.dictLookup("op", &obj)->isBool()) {
+            state->setFillOverprint(obj.getBool());
+            out->updateFillOverprint(state);
+            fill_op_set = true;
+        }
+        obj.free();
+
+        if (gstate.dictLookup("OP", &obj)->isBool()) {
+            state->setStrokeOverprint(obj.getBool());
+            out->updateStrokeOverprint(state);
+            if (!fill_op_set) {
+                state->setFillOverprint(obj.getBool());
+                out->updateFillOverprint(state);
+            }
+        }
+        obj.free();
+
+        if (gstate.dictLookup("OPM", &obj)->isInt()) {
+            state->setOverprintMode(obj.getInt());
+            out->updateOverprintMode(state);
+        }
+        obj.free();
+
+        gstate.free();
+        return true;
+    }
+
+    //
+    // g, rg, k & stroke counterparts. Takes ownership of the color
+    // space
+    bool TextInterpreter::set_device_color(bool fill, GfxColorSpace* cspace, Object args[], int num_args)
+    {
+        if (!all_nums(args, num_args)) {
+            delete cspace;
+            return true;
+        }
+
+        // a Default color space in the resources replaces the device
+        // one
+        static const char* DEFAULT_CSPACES[] = { "DefaultGray", NULL, "DefaultRGB", NULL, "DefaultCMYK" };
+        Object def;
+        res->lookupColorSpace(DEFAULT_CSPACES[ cspace->getMode() ], &def);
+        bool has_default = !def.isNull();
+        def.free();
+
+        if (has_default) {
+            delete cspace;
+            return abandon("color_space");
+        }
+
+        GfxColor color;
+        for (int i = 0; i < num_args; ++i) {
+            color.c[i] = dblToCol(args[i].getNum());
+        }
+
+        if (fill) {
+            state->setFillPattern(NULL);
+            state->setFillColorSpace(cspace);
+            out->updateFillColorSpace(state);
+            state->setFillColor(&color);
+            out->updateFillColor(state);
+        } else {
+            state->setStrokePattern(NULL);
+            state->setStrokeColorSpace(cspace);
+            out->updateStrokeColorSpace(state);
+            state->setStrokeColor(&color);
+            out->updateStrokeColor(state);
+        }
+        return true;
+    }
+
+    //
+    // cs & CS. Only the device color spaces are handled; anything
+    // defined in the resources needs poppler's parser
+    bool TextInterpreter::set_color_space(bool fill, Object& name)
+    {
+        if (!name.isName()) {
+            return true;
+        }
+
+        Object obj;
+        res->lookupColorSpace(name.getName(), &obj);
+        bool in_resources = !obj.isNull();
+        obj.free();
+
+        GfxColorSpace* cspace = NULL;
+        if (!in_resources) {
+            if (name.isName("DeviceGray")) {
+                cspace = new GfxDeviceGrayColorSpace();
+            } else if (name.isName("DeviceRGB")) {
+                cspace = new GfxDeviceRGBColorSpace();
+            } else if (name.isName("DeviceCMYK")) {
+                cspace = new GfxDeviceCMYKColorSpace();
+            }
+        }
+
+        if (!cspace) {
+            return abandon("color_space");
+        }
+
+        GfxColor color;
+        cspace->getDefaultColor(&color);
+
+        Object args[gfxColorMaxComps];
+        for (int i = 0; i < cspace->getNComps(); ++i) {
+            args[i].initReal(colToDbl(color.c[i]));
+        }
+        return set_device_color(fill, cspace, args, cspace->getNComps());
+    }
+
+    //
+    // sc, scn & stroke counterparts. Color spaces other than the
+    // device ones are never set so the components can be read as is
+    bool TextInterpreter::set_color(bool fill, Object args[], int num_args)
+    {
+        if (num_args > 0 && args[num_args - 1].isName()) {
+            return abandon("pattern");
+        }
+
+        GfxColorSpace* cspace = (fill ? state->getFillColorSpace() : state->getStrokeColorSpace());
+        if (num_args != cspace->getNComps() || !all_nums(args, num_args)) {
+            return true;
+        }
+
+        GfxColor color;
+        for (int i = 0; i < num_args; ++i) {
+            color.c[i] = dblToCol(args[i].getNum());
+        }
+
+        if (fill) {
+            state->setFillPattern(NULL);
+            state->setFillColor(&color);
+            out->updateFillColor(state);
+        } else {
+            state->setStrokePattern(NULL);
+            state->setStrokeColor(&color);
+            out->updateStrokeColor(state);
+        }
+        return true;
+    }
+
+
+    //
+    // text
+    bool TextInterpreter::set_font(Object args[])
+    {
+        GfxFont* font = res->lookupFont(args[0].getName());
+
+        // Type3 glyphs are content streams of their own
+        if (font && font->getType() == fontType3) {
+            return abandon("type3_font");
+        }
+
+        // unknown fonts unset the current one, as poppler does
+        if (font) {
+            font->incRefCnt();
+        }
+        state->setFont(font, args[1].getNum());
+        font_changed = true;
+        return true;
+    }
+
+    //
+    // show operators are skipped if there's no font. The device is
+    // told about font changes lazily, like poppler does
+    bool TextInterpreter::font_ready()
+    {
+        if (!state->getFont()) {
+            return false;
+        }
+
+        if (font_changed) {
+            out->updateFont(state);
+            font_changed = false;
+        }
+        return true;
+    }
+
+    void TextInterpreter::move_to_next_line()
+    {
+        state->textMoveTo(state->getLineX(), state->getLineY() - state->getLeading());
+        out->updateTextPos(state);
+    }
+
+    //
+    // computes each character's position and advance as poppler's
+    // Gfx::doShowText does and passes it to the device
+    void TextInterpreter::show_text(GooString* s)
+    {
+        GfxFont* font = state->getFont();
+        int wmode = font->getWMode();
+        double font_size = state->getFontSize();
+
+        double rise_x, rise_y;
+        state->textTransformDelta(0, state->getRise(), &rise_x, &rise_y);
+
+        out->beginString(state, s);
+
+        char* p = s->getCString();
+        int len = s->getLength();
+
+        while (len > 0) {
+            CharCode code;
+            Unicode* u = NULL;
+            int u_len;
+            double dx, dy, origin_x, origin_y;
+
+            int n = font->getNextChar(p, len, &code, &u, &u_len, &dx, &dy, &origin_x, &origin_y);
+            if (n <= 0) {
+                break;
+            }
+
+            if (wmode) {
+                dx *= font_size;
+                dy = dy * font_size + state->getCharSpace();
+                if (n == 1 && *p == ' ') {
+                    dy += state->getWordSpace();
+                }
+            } else {
+                dx = dx * font_size + state->getCharSpace();
+                if (n == 1 && *p == ' ') {
+                    dx += state->getWordSpace();
+                }
+                dx *= state->getHorizScaling();
+                dy *= font_size;
+            }
+
+            double tdx, tdy, t_origin_x, t_origin_y;
+            state->textTransformDelta(dx, dy, &tdx, &tdy);
+            state->textTransformDelta(origin_x * font_size, origin_y * font_size, &t_origin_x, &t_origin_y);
+
+            out->drawChar(state, state->getCurX() + rise_x, state->getCurY() + rise_y,
+                          tdx, tdy, t_origin_x, t_origin_y, code, n, u, u_len);
+
+            state->shift(tdx, tdy);
+            p += n;
+            len -= n;
+        }
+
+        out->endString(state);
+    }
+
+    void TextInterpreter::show_space_text(Array* a)
+    {
+        int wmode = state->getFont()->getWMode();
+
+        for (int i = 0; i < a->getLength(); ++i) {
+            Object obj;
+            a->get(i, &obj);
+
+            if (obj.isNum()) {
+                double shift = -obj.getNum() * 0.001 * state->getFontSize();
+                if (wmode) {
+                    state->textShift(0, shift);
+                } else {
+                    state->textShift(shift * state->getHorizScaling(), 0);
+                }
+                out->updateTextShift(state, obj.getNum());
+            } else if (obj.isString()) {
+                show_text(obj.getString());
+            }
+            obj.free();
+        }
+    }
+
+
+    //
+    // marked content - ActualText spans are passed on. Optional
+    // content can hide what follows so leave that to poppler
+    bool TextInterpreter::begin_marked_content(Object args[], int num_args)
+    {
+        if (!args[0].isName()) {
+            return true;
+        }
+
+        if (std::strncmp(args[0].getName(), "OC", 2) == 0 && catalog->getOptContentConfig()) {
+            return abandon("optional_content");
+        }
+
+        bool actual_text = false;
+        if (num_args == 2 && args[0].isName("Span") && args[1].isDict()) {
+            Object obj;
+            if (args[1].dictLookup("ActualText", &obj)->isString()) {
+                out->beginActualText(state, obj.getString());
+                actual_text = true;
+            }
+            obj.free();
+        }
+
+        marked_content.push(actual_text);
+        return true;
+    }
+
+    void TextInterpreter::end_marked_content()
+    {
+        if (marked_content.empty()) {
+            return;
+        }
+
+        if (marked_content.top()) {
+            out->endActualText(state);
+        }
+        marked_content.pop();
+    }
+
+
+    //
+    // XObjects - only forms can draw text
+    bool TextInterpreter::draw_xobject(Object& name)
+    {
+        if (!name.isName()) {
+            return true;
+        }
+
+        Object xobj;
+        if (!res->lookupXObject(name.getName(), &xobj) || !xobj.isStream()) {
+            xobj.free();
+            return true;
+        }
+
+        bool status = true;
+        Object obj;
+        if (xobj.streamGetDict()->lookup("Subtype", &obj)->isName("Form")) {
+            Object oc;
+            bool has_oc = !xobj.streamGetDict()->lookupNF("OC", &oc)->isNull();
+            oc.free();
+
+            if (has_oc && catalog->getOptContentConfig()) {
+                status = abandon("optional_content");
+            } else {
+                status = draw_form(xobj);
+            }
+        }
+        obj.free();
+        xobj.free();
+        return status;
+    }
+
+    //
+    // follows Gfx::doForm & drawForm
+    bool TextInterpreter::draw_form(Object& form)
+    {
+        // poppler stops drawing nested forms at this depth
+        if (form_depth > MAX_FORM_DEPTH) {
+            return true;
+        }
+
+        Dict* dict = form.streamGetDict();
+
+        // the bounding box is required
+        Object obj;
+        double bbox[4];
+        bool bbox_ok = dict->lookup("BBox", &obj)->isArray();
+        for (int i = 0; bbox_ok && i < 4; ++i) {
+            Object n;
+            bbox_ok = obj.arrayGet(i, &n)->isNum();
+            if (bbox_ok) {
+                bbox[i] = n.getNum();
+            }
+            n.free();
+        }
+        obj.free();
+
+        if (!bbox_ok) {
+            return true;
+        }
+
+        double m[6] = { 1, 0, 0, 1, 0, 0 };
+        if (dict->lookup("Matrix", &obj)->isArray()) {
+            for (int i = 0; i < 6; ++i) {
+                Object n;
+                m[i] = (obj.arrayGet(i, &n)->isNum() ? n.getNum() : 0);
+                n.free();
+            }
+        }
+        obj.free();
+
+        bool transparency_group = false;
+        if (dict->lookup("Group", &obj)->isDict()) {
+            Object s;
+            transparency_group = obj.dictLookup("S", &s)->isName("Transparency");
+            s.free();
+        }
+        obj.free();
+
+        Object resources;
+        dict->lookup("Resources", &resources);
+        res = new GfxResources(xref, (resources.isDict() ? resources.getDict() : NULL), res);
+
+        save_state();
+        state->clearPath();
+        state->concatCTM(m[0], m[1], m[2], m[3], m[4], m[5]);
+        out->updateCTM(state, m[0], m[1], m[2], m[3], m[4], m[5]);
+        clip_to_rect(bbox[0], bbox[1], bbox[2], bbox[3]);
+
+        // groups start out opaque
+        if (transparency_group) {
+            if (state->getFillOpacity() != 1) {
+                state->setFillOpacity(1);
+                out->updateFillOpacity(state);
+            }
+            if (state->getStrokeOpacity() != 1) {
+                state->setStrokeOpacity(1);
+                out->updateStrokeOpacity(state);
+            }
+        }
+
+        form_depth++;
+        bool status = display(&form);
+        form_depth--;
+
+        if (status) {
+            restore_state();
+
+            GfxResources* form_res = res;
+            res = res->getNext();
+            delete form_res;
+        }
+        resources.free();
+        return status;
+    }
+
+
+    //
+    // free the page's state and resource stacks
+    void TextInterpreter::cleanup()
+    {
+        while (res) {
+            GfxResources* next = res->getNext();
+            delete res;
+            res = next;
+        }
+
+        if (state) {
+            while (state->hasSaves()) {
+                state = state->restore();
+            }
+            delete state;
+            state = NULL;
+        }
+
+        while (!state_guards.empty()) {
+            state_guards.pop();
+        }
+        while (!marked_content.empty()) {
+            marked_content.pop();
+        }
+    }
+
+} // namespace
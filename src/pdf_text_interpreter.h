@@ -0,0 +1,104 @@
+#pragma once
+
+#include <stack>
+
+#include <poppler/Object.h>
+
+class XRef;
+class Catalog;
+class GfxState;
+class GfxResources;
+class GfxColorSpace;
+class OutputDev;
+
+namespace pdftoedn
+{
+    // -------------------------------------------------------
+    // minimal content stream interpreter for text-only extraction.
+    //
+    // Only the text state, text positioning and showing operators,
+    // q / Q / cm, fill & stroke colors in device spaces, the
+    // opacity entries of ExtGStates, ActualText marked content,
+    // paths, clips, and Form XObjects are interpreted. Characters are
+    // passed to the output device's drawChar() and paths to its fill,
+    // stroke and clip callbacks as poppler's Gfx would, so font
+    // mapping, span assembly, clipping and opaque fill whiteout are
+    // unchanged. Image operators are skipped, as the output device
+    // does in text-only mode.
+    //
+    // Pages using something that can't be handled this way (Type3
+    // fonts, inline images, shadings, optional content, color spaces
+    // from the resources, annotation appearances, etc.) are abandoned before
+    // endPage() is called so the caller can process them again with
+    // poppler.
+    //
+    class TextInterpreter
+    {
+    public:
+        enum { MAX_ARGS = 33, MAX_FORM_DEPTH = 100 };
+
+        TextInterpreter(XRef* doc_xref, Catalog* doc_catalog, ::OutputDev* dev);
+
+        // interprets the page's content. Returns false if the page
+        // must be processed by poppler instead - the output device's
+        // page data is incomplete in that case
+        bool display_page(int page_num);
+
+        // why the last page was abandoned
+        const char* unsupported() const { return unsupported_reason; }
+
+    private:
+        XRef* xref;
+        Catalog* catalog;
+        ::OutputDev* out;
+
+        // per page
+        GfxState* state;
+        GfxResources* res;
+        bool font_changed;
+        enum { CLIP_NONE, CLIP_NORMAL, CLIP_EO } clip_mode; // pending W / W*
+        int form_depth;
+        int state_depth;
+        std::stack<int> state_guards; // depth at which each form began
+        std::stack<bool> marked_content; // true if ActualText
+        const char* unsupported_reason;
+
+        bool display(Object* contents);
+        bool exec_op(const char* op, Object args[], int num_args);
+
+        // graphics state
+        void save_state();
+        void restore_state();
+        bool set_gstate(Object& name);
+        bool set_device_color(bool fill, GfxColorSpace* cspace, Object args[], int num_args);
+        bool set_color_space(bool fill, Object& name);
+        bool set_color(bool fill, Object args[], int num_args);
+
+        // paths
+        void paint_path(int code);
+        void end_path();
+        void clip_to_rect(double x1, double y1, double x2, double y2);
+
+        // text
+        bool set_font(Object args[]);
+        bool font_ready();
+        void move_to_next_line();
+        void show_text(GooString* s);
+        void show_space_text(Array* a);
+
+        // marked content & XObjects
+        bool begin_marked_content(Object args[], int num_args);
+        void end_marked_content();
+        bool draw_xobject(Object& name);
+        bool draw_form(Object& form);
+
+        bool abandon(const char* reason) { unsupported_reason = reason; return false; }
+        void cleanup();
+
+        // prohibit
+        TextInterpreter();
+        TextInterpreter(const TextInterpreter&);
+        TextInterpreter& operator=(const TextInterpreter&);
+    };
+
+} // namespace
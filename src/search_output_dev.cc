@@ -0,0 +1,310 @@
+#include <sstream>
+#include <cmath>
+#include <cwctype>
+
+#include <poppler/GfxState.h>
+#include <poppler/GfxFont.h>
+
+#include "search_output_dev.h"
+#include "font_engine.h"
+#include "edsel_options.h"
+#include "pdf_error_tracker.h"
+#include "pdf_stats_tracker.h"
+#include "util.h"
+#include "util_edn.h"
+
+namespace pdftoedn
+{
+    static const pdftoedn::Symbol SYMBOL_PAGE_NUMBER = "pgnum";
+    static const pdftoedn::Symbol SYMBOL_TERM        = "term";
+    static const pdftoedn::Symbol SYMBOL_TEXT        = "text";
+
+    // horizontal gap, relative to the font size, above which two
+    // characters are considered separate words
+    static const double WORD_GAP_FONT_SIZE_RATIO = 0.25;
+
+    //
+    // search hit output
+    std::ostream& SearchMatch::to_edn(std::ostream& o) const
+    {
+        util::edn::Hash match_h(4);
+        match_h.push( SYMBOL_PAGE_NUMBER,  page );
+        match_h.push( SYMBOL_TERM,         term );
+        match_h.push( SYMBOL_TEXT,         text );
+        match_h.push( BoundingBox::SYMBOL, bbox );
+        o << match_h;
+        return o;
+    }
+
+
+    //------------------------------------------------------------------------
+    // SearchOutputDev
+    //------------------------------------------------------------------------
+    SearchOutputDev::SearchOutputDev(Catalog* doc_cat, pdftoedn::FontEngine& fnt_engine) :
+        EngOutputDev(doc_cat),
+        font_engine(fnt_engine),
+        any_match(pdftoedn::options.search_any_match()),
+        page_num(0), page_w(0), page_h(0),
+        last_x(0), last_y(0)
+    {
+        for (const std::string& term : pdftoedn::options.search_terms()) {
+
+            // terms wrapped in slashes are regular expressions
+            if (term.length() > 2 && term[0] == '/' && term[term.length() - 1] == '/') {
+                terms.push_back(Term(term, true));
+
+                try {
+                    terms.back().re.assign(util::utfstring_to_wstring(term.substr(1, term.length() - 2)));
+                } catch (boost::regex_error& e) {
+                    std::stringstream err;
+                    err << "invalid search expression '" << term << "': " << e.what();
+                    throw init_error(err.str());
+                }
+                continue;
+            }
+
+            // literal terms are matched against the page text, where
+            // runs of whitespace are reduced to a single space, so do
+            // the same with the term
+            std::wstring w_term;
+            for (wchar_t c : util::utfstring_to_wstring(term)) {
+                if (std::iswspace(c)) {
+                    if (w_term.empty() || w_term[w_term.length() - 1] == L' ') {
+                        continue;
+                    }
+                    c = L' ';
+                }
+                w_term += c;
+            }
+
+            // a trailing space would only match before another word
+            if (!w_term.empty() && w_term[w_term.length() - 1] == L' ') {
+                w_term.erase(w_term.length() - 1);
+            }
+
+            if (w_term.empty()) {
+                std::stringstream err;
+                err << "invalid search term '" << term << "'";
+                throw init_error(err.str());
+            }
+
+            terms.push_back(Term(term, false));
+            matcher.add_term(w_term);
+            matcher_terms.push_back(terms.size() - 1);
+        }
+    }
+
+
+    //
+    // any-match mode is done once each term has been found
+    bool SearchOutputDev::search_done() const
+    {
+        if (!any_match) {
+            return false;
+        }
+
+        for (const Term& t : terms) {
+            if (!t.found) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void SearchOutputDev::reset_search()
+    {
+        for (Term& t : terms) {
+            t.found = false;
+        }
+    }
+
+    GBool SearchOutputDev::abort_check(void* search_dev)
+    {
+        return (static_cast<SearchOutputDev*>(search_dev)->search_done() ? gTrue : gFalse);
+    }
+
+
+    //
+    // reset the page state
+    void SearchOutputDev::startPage(int pageNum, GfxState *state, XRef *xref)
+    {
+        page_num = pageNum;
+
+        if (state) {
+            page_w = state->getPageWidth();
+            page_h = state->getPageHeight();
+        } else {
+            page_w = page_h = 0;
+        }
+
+        clear_matches();
+        page_text.clear();
+        char_bboxes.clear();
+        matcher.reset();
+
+        if (xref) {
+            font_engine.update_document_ref(xref);
+        }
+    }
+
+
+    //
+    // run the regular expressions on the page text
+    void SearchOutputDev::endPage()
+    {
+        for (uintmax_t idx = 0; idx < terms.size(); ++idx) {
+            Term& t = terms[idx];
+
+            if (!t.is_regex || (any_match && t.found)) {
+                continue;
+            }
+
+            boost::wsregex_iterator end;
+            for (boost::wsregex_iterator mi(page_text.begin(), page_text.end(), t.re); mi != end; ++mi) {
+                if (mi->length() == 0) {
+                    continue;
+                }
+
+                add_match(idx, mi->position(), mi->position() + mi->length());
+
+                if (any_match) {
+                    break;
+                }
+            }
+        }
+
+        stats.add("search", "matches", matches.size());
+
+        font_engine.report_remap_failures();
+    }
+
+
+    //
+    // load the font so character codes can be mapped
+    void SearchOutputDev::updateFont(GfxState *state)
+    {
+        GfxFont *gfx_font = state->getFont();
+        if (!gfx_font) {
+            return;
+        }
+
+        // sanity-check the font size
+        if (EngOutputDev::state_font_size_not_sane(state)) {
+            return;
+        }
+
+        font_engine.load_font(gfx_font);
+    }
+
+
+    //
+    // map the character and append it to the page text
+    void SearchOutputDev::drawChar(GfxState *state, double x, double y,
+                                   double dx, double dy,
+                                   double originX, double originY,
+                                   CharCode code, int nBytes,
+                                   Unicode *u, int uLen)
+    {
+        // same visibility rules as the regular output
+        bool invisible = (state->getRender() == util::TEXT_RENDER_INVISIBLE);
+        if (!pdftoedn::options.include_invisible_text() && invisible) {
+            return;
+        }
+
+        if (state->getStrokeColorSpace()->isNonMarking()) {
+            return;
+        }
+
+        x -= originX;
+        y -= originY;
+
+        double x1, y1, w1, h1, dx2, dy2;
+        state->transform(x, y, &x1, &y1);
+        state->textTransformDelta(state->getCharSpace() * state->getHorizScaling(), 0, &dx2, &dy2);
+        dx -= dx2;
+        dy -= dy2;
+        state->transformDelta(dx, dy, &w1, &h1);
+
+        uintmax_t unicode;
+        switch (font_engine.get_code_unicode(code, u, unicode)) {
+          case FontEngine::CODE_REMAP_IGNORE:
+          case FontEngine::CODE_REMAP_ERROR:
+              return;
+          default:
+              break;
+        }
+
+        double font_size = get_transformed_font_size(state);
+        BoundingBox bbox(x1, y1, w1, (std::abs(h1) < 0.001 ? -font_size : h1));
+
+        // skip characters that fall off the page
+        Coord c = bbox.center();
+        if (c.x < 0 || c.y < 0 || c.x > page_w || c.y > page_h) {
+            return;
+        }
+
+        // insert a space between words and lines so terms don't match
+        // text that reads as separate words
+        if (!page_text.empty() &&
+            (std::abs(y1 - last_y) > font_size / 2 ||
+             x1 - last_x > font_size * WORD_GAP_FONT_SIZE_RATIO)) {
+            add_char(L' ', char_bboxes.back());
+        }
+
+        last_x = x1 + w1;
+        last_y = y1;
+
+        add_char(static_cast<wchar_t>(unicode), bbox);
+    }
+
+
+    //
+    // append a character to the page text and feed it to the
+    // matcher. Whitespace is collapsed to a single space
+    void SearchOutputDev::add_char(wchar_t c, const BoundingBox& bbox)
+    {
+        if (std::iswspace(c)) {
+            if (page_text.empty() || page_text[page_text.length() - 1] == L' ') {
+                return;
+            }
+            c = L' ';
+        }
+
+        page_text += c;
+        char_bboxes.push_back(bbox);
+
+        for (uintmax_t id : matcher.feed(c)) {
+            uintmax_t idx = matcher_terms[id];
+
+            if (any_match && terms[idx].found) {
+                continue;
+            }
+
+            uintmax_t end = page_text.length();
+            add_match(idx, end - matcher.term_length(id), end);
+        }
+    }
+
+
+    //
+    // record a match covering page text [start, end)
+    void SearchOutputDev::add_match(uintmax_t term_idx, uintmax_t start, uintmax_t end)
+    {
+        Bounds b;
+        for (uintmax_t ii = start; ii < end; ++ii) {
+            b.expand(char_bboxes[ii]);
+        }
+
+        matches.push_back( new SearchMatch(page_num, terms[term_idx].term,
+                                           util::wstring_to_utfstring(page_text.substr(start, end - start)),
+                                           b.bounding_box()) );
+        terms[term_idx].found = true;
+    }
+
+
+    void SearchOutputDev::clear_matches()
+    {
+        util::delete_ptr_container_elems(matches);
+    }
+
+} // namespace
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <list>
+
+#include <boost/regex.hpp>
+
+#include "eng_output_dev.h"
+#include "base_types.h"
+#include "text_search.h"
+
+namespace pdftoedn
+{
+    class FontEngine;
+
+    // -------------------------------------------------------
+    // a search hit: the page it was found in, the term that matched
+    // and the area covered by the matched text
+    //
+    struct SearchMatch : public gemable {
+        SearchMatch(uintmax_t page_num, const std::string& search_term,
+                    const std::string& match_text, const BoundingBox& match_bbox) :
+            page(page_num), term(search_term), text(match_text), bbox(match_bbox) {}
+
+        uintmax_t page;
+        std::string term;
+        std::string text;
+        BoundingBox bbox;
+
+        virtual std::ostream& to_edn(std::ostream& o) const;
+    };
+
+
+    //------------------------------------------------------------------------
+    // SearchOutputDev - only reads the text in the page and reports
+    // where the search terms are found. Literal terms are matched as
+    // the characters are drawn so they are found across span
+    // boundaries; terms given as /regex/ are run on the page text once
+    // the page has been read
+    //------------------------------------------------------------------------
+    class SearchOutputDev : public EngOutputDev
+    {
+    public:
+        SearchOutputDev(Catalog* doc_cat, pdftoedn::FontEngine& fnt_engine);
+        virtual ~SearchOutputDev() { clear_matches(); }
+
+        // POPPLER virtual interface
+        // =========================
+        virtual GBool upsideDown() { return gTrue; }
+
+        virtual GBool needNonText() { return gFalse; }
+        virtual GBool needCharCount() { return gFalse; }
+
+        // Does this device use drawChar() or drawString()?
+        virtual GBool useDrawChar() { return gTrue; }
+        virtual GBool useTilingPatternFill() { return gFalse; }
+
+        // Type 3 text is reported through drawChar
+        virtual GBool interpretType3Chars() { return gFalse; }
+        virtual GBool supportTextCSPattern(GfxState *state) { return gFalse; }
+
+        //----- initialization and control
+        virtual void startPage(int pageNum, GfxState *state, XRef *xref);
+        virtual void endPage();
+
+        //----- text state
+        virtual void updateFont(GfxState* state);
+
+        //----- text drawing
+        virtual void beginString(GfxState * /*state*/, GooString * /*s*/) {}
+        virtual void endString(GfxState * /*state*/) {}
+        virtual void drawChar(GfxState *state, double x, double y,
+                              double dx, double dy,
+                              double originX, double originY,
+                              CharCode code, int nBytes, Unicode *u, int uLen);
+
+        // matches found in the last page processed
+        const std::list<SearchMatch*>& page_matches() const { return matches; }
+
+        // true when only the first match of each term is wanted and
+        // all have been found
+        bool search_done() const;
+
+        // clear the found state of the terms for a new search
+        void reset_search();
+
+        // displayPage abort callback - stops reading the page once the
+        // search is done
+        static GBool abort_check(void* search_dev);
+
+    private:
+        struct Term {
+            Term(const std::string& t, bool is_re) : term(t), is_regex(is_re), found(false) {}
+
+            std::string term;
+            bool is_regex;
+            bool found;
+            boost::wregex re;
+        };
+
+        pdftoedn::FontEngine& font_engine;
+        TextMatcher matcher;
+        std::vector<Term> terms;
+        std::vector<uintmax_t> matcher_terms; // matcher term id -> terms index
+        bool any_match;
+
+        // current page state
+        int page_num;
+        double page_w, page_h;
+        double last_x, last_y;
+        std::wstring page_text;
+        std::vector<BoundingBox> char_bboxes;
+        std::list<SearchMatch*> matches;
+
+        void add_char(wchar_t c, const BoundingBox& bbox);
+        void add_match(uintmax_t term_idx, uintmax_t start, uintmax_t end);
+        void clear_matches();
+    };
+
+} // namespace
@@ -1,8 +1,12 @@
 #include <string>
 #include <sstream>
 #include <list>
+#include <vector>
 #include <ostream>
 #include <complex>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
 
 #include "doc_page.h"
 #include "text.h"
@@ -13,18 +17,21 @@
 namespace pdftoedn
 {
     // static initializers
-    const pdftoedn::Symbol PdfGlyph::SYMBOL             = "glyph";
 
     const pdftoedn::Symbol PdfText::SYMBOL_TYPE_SPAN    = "span";
     const pdftoedn::Symbol PdfText::SYMBOL_ORIGIN       = "origin";
     const pdftoedn::Symbol PdfText::SYMBOL_GLYPH_IDX    = "glyph_idx";
 
     static const pdftoedn::Symbol SYMBOL_X_POS_VECTOR   = "x_vector";
+    static const pdftoedn::Symbol SYMBOL_X_START        = "x_start";
+    static const pdftoedn::Symbol SYMBOL_X_ADVANCE      = "x_advance";
+    static const pdftoedn::Symbol SYMBOL_BASELINE_OFFS  = "baseline_offsets";
     static const pdftoedn::Symbol SYMBOL_Y_POS_VECTOR   = "y_vector";
     static const pdftoedn::Symbol SYMBOL_TEXT           = "text";
     static const pdftoedn::Symbol SYMBOL_PT_SIZE        = "size";
     static const pdftoedn::Symbol SYMBOL_INVISIBLE      = "invisible";
     static const pdftoedn::Symbol SYMBOL_LINK_IDX       = "link_idx";
+    static const pdftoedn::Symbol SYMBOL_DUPLICATE      = "duplicate";
 
     // when two spans overlap, this is the minimum ratio between their
     // intersection and union to call it a full overlap
@@ -49,15 +56,9 @@ namespace pdftoedn
     // check if this character looks to be adjacent to a previous one
     bool PdfChar::spans(const PdfChar& prev) const
     {
-        // if we have rotation but are not rotation along 90, 180, or
-        // 270, we don't bother computing span
-        if (!ctm.is_rotation_orthogonal()) {
-            return false;
-        }
-
         // check that text looks like it might actually follow the
         // previous character
-        if (prev.x1() > x2()) {
+        if (prev.left() > right()) {
             return false;
         }
 
@@ -73,20 +74,13 @@ namespace pdftoedn
         double bbox_delta = left() - prev.right();
         double min_ws_space = 0.2 * scaling;
 
-        if (ctm.rotation_deg() == 90) {
-            // TESLA-7613: when text is rotated by 90, left -
-            // prev.right results in a negative value due to inverted
-            // y axis. Compensate here so the calculation below works
-            bbox_delta = std::abs(bbox_delta);
-        }
-
 #if 0 // you don't really want to enable this
         cerr << " ----------------- comparing spans -------------- " << endl
              << " a: " << prev << endl
              << " b: " << *this << endl;
 
         cerr << boolalpha
-             << "   rotated orth? " << (ctm.is_rotation_orthogonal()) << " (deg: " << ctm.rotation_deg() << ")" << endl
+             << "   rotated? " << (ctm.is_rotated()) << " (deg: " << ctm.rotation_deg() << ")" << endl
              << "   glyph idx is -1? " << ((int) glyph_idx == -1) << endl
              << "   attribs are equal? " <<  (attribs == prev.attribs) << endl
              << "   font_size equal? " <<  (attribs.font_size == prev.attribs.font_size) << " (font size: " << attribs.font_size << ")" <<  endl
@@ -121,23 +115,50 @@ namespace pdftoedn
         return true;
     }
 
+    //
+    // project the bbox of a rotated character onto its baseline
+    // frame. The bbox spans the pen position to the end of the
+    // advance so, along the baseline, the corners project to the
+    // start and end of the character and, across it, they are
+    // symmetric about the baseline
+    void PdfChar::baseline_extent(double& start, double& end, double& baseline) const
+    {
+        double angle = ctm.rotation();
+        double cos_a = std::cos(angle);
+        double sin_a = std::sin(angle);
+
+        const Coord corners[4] = { bbox.p1(), bbox.p2(),
+                                   Coord(bbox.x1(), bbox.y2()), Coord(bbox.x2(), bbox.y1()) };
+
+        double across_min = 0, across_max = 0;
+        for (uintmax_t ii = 0; ii < 4; ++ii) {
+            // device y grows down the page
+            double along = corners[ii].x * cos_a - corners[ii].y * sin_a;
+            double across = corners[ii].x * sin_a + corners[ii].y * cos_a;
+
+            if (ii == 0) {
+                start = end = along;
+                across_min = across_max = across;
+                continue;
+            }
+            start = std::min(start, along);
+            end = std::max(end, along);
+            across_min = std::min(across_min, across);
+            across_max = std::max(across_max, across);
+        }
+
+        baseline = (across_min + across_max) / 2;
+    }
+
     double PdfChar::left() const
     {
         if (!ctm.is_rotated()) {
             return bbox.x_min();
         }
-        else {
-            double rotation = ctm.rotation_deg();
-            if (rotation == 90) {
-                return bbox.y_max();
-            } else if (rotation == 180) {
-                return bbox.y_min();
-            } else if (rotation == 270) {
-                return bbox.x_max();
-            }
-            // don't span for arbitrary angles
-            return 0;
-        }
+
+        double start, end, baseline;
+        baseline_extent(start, end, baseline);
+        return start;
     }
 
     double PdfChar::right() const
@@ -145,18 +166,10 @@ namespace pdftoedn
         if (!ctm.is_rotated()) {
             return bbox.x_max();
         }
-        else {
-            double rotation = ctm.rotation_deg();
-            if (rotation == 90) {
-                return bbox.y_min();
-            } else if (rotation == 180) {
-                return bbox.y_max();
-            } else if (rotation == 270) {
-                return bbox.x_min();
-            }
-            // don't span for arbitrary angles
-            return 0;
-        }
+
+        double start, end, baseline;
+        baseline_extent(start, end, baseline);
+        return end;
     }
 
     double PdfChar::top() const
@@ -164,18 +177,10 @@ namespace pdftoedn
         if (!ctm.is_rotated()) {
             return bbox.y_min();
         }
-        else {
-            double rotation = ctm.rotation_deg();
-            if (rotation == 90) {
-                return bbox.x_min();
-            } else if (rotation == 180) {
-                return bbox.x_max();
-            } else if (rotation == 270) {
-                return bbox.y_max();
-            }
-            // don't span for arbitrary angles
-            return 0;
-        }
+
+        double start, end, baseline;
+        baseline_extent(start, end, baseline);
+        return baseline - attribs.txt.font_size;
     }
 
     double PdfChar::bottom() const
@@ -183,18 +188,10 @@ namespace pdftoedn
         if (!ctm.is_rotated()) {
             return bbox.y_max();
         }
-        else {
-            double rotation = ctm.rotation_deg();
-            if (rotation == 90) {
-                return bbox.x_max();
-            } else if (rotation == 180) {
-                return bbox.x_min();
-            } else if (rotation == 270) {
-                return bbox.y_min();
-            }
-            // don't span for arbitrary angles
-            return 0;
-        }
+
+        double start, end, baseline;
+        baseline_extent(start, end, baseline);
+        return baseline;
     }
 
 
@@ -204,11 +201,29 @@ namespace pdftoedn
 
     bool PdfText::OverlapPred::operator()(PdfBoxedItem* const bi)
     {
-        // TODO: re-work rotated text spans to let this work
-        if (bi->CTM().is_rotated()) {
+        if (!bi->CTM().is_rotated() && !ps.CTM().is_rotated()) {
+            return (bi->bounding_box().intersection_area_ratio(ps_bbox) > SPAN_OVERLAP_THRESHOLD);
+        }
+
+        // rotated spans are compared in their baseline frame: they
+        // must share the angle and baseline and their runs along it
+        // must overlap
+        const PdfText* span = dynamic_cast<const PdfText*>(bi);
+
+        if (!span || span->chars.empty() || ps.chars.empty() ||
+            span->CTM().rotation() != ps.CTM().rotation() ||
+            std::abs(span->chars.front()->bottom() - ps.chars.front()->bottom()) > ps.attribs.txt.baseline_threshold) {
+            return false;
+        }
+
+        double start = span->chars.front()->left(), end = span->chars.back()->right();
+        double ps_start = ps.chars.front()->left(), ps_end = ps.chars.back()->right();
+
+        double overlap = std::min(end, ps_end) - std::max(start, ps_start);
+        if (overlap <= 0) {
             return false;
         }
-        return (bi->bounding_box().intersection_area_ratio(ps_bbox) > SPAN_OVERLAP_THRESHOLD);
+        return (overlap / (end - start) > SPAN_OVERLAP_THRESHOLD);
     }
 
     //
@@ -288,9 +303,53 @@ namespace pdftoedn
 
 
     //
-    // remove characters from the span covered by the region
+    // extent of a device-space region along the baseline of the
+    // given transform - same frame as PdfChar::left() / right()
+    static void region_baseline_extent(const PdfTM& ctm, const BoundingBox& region,
+                                       double& start, double& end)
+    {
+        if (!ctm.is_rotated()) {
+            start = region.x_min();
+            end = region.x_max();
+            return;
+        }
+
+        double angle = ctm.rotation();
+        double cos_a = std::cos(angle);
+        double sin_a = std::sin(angle);
+
+        const Coord corners[4] = { region.p1(), region.p2(),
+                                   Coord(region.x1(), region.y2()), Coord(region.x2(), region.y1()) };
+
+        for (uintmax_t ii = 0; ii < 4; ++ii) {
+            double along = corners[ii].x * cos_a - corners[ii].y * sin_a;
+            if (ii == 0) {
+                start = end = along;
+                continue;
+            }
+            start = std::min(start, along);
+            end = std::max(end, along);
+        }
+    }
+
+
+    //
+    // remove characters from the span covered by the region. Nothing
+    // is removed if the region covers the span's full run along its
+    // baseline
     void PdfText::whiteout(const BoundingBox& wo_region)
     {
+        if (chars.empty()) {
+            return;
+        }
+
+        double wo_start, wo_end;
+        region_baseline_extent(ctm, wo_region, wo_start, wo_end);
+
+        if (chars.front()->left() >= wo_start && chars.back()->right() <= wo_end) {
+            return;
+        }
+
         std::list<PdfChar *>::iterator ci = chars.begin();
 
         while (ci != chars.end())
@@ -298,11 +357,11 @@ namespace pdftoedn
             std::list<PdfChar *>::iterator cur = ci++;
             PdfChar* c = *cur;
 
-            if (c->right() < wo_region.x_min()) {
+            if (c->right() < wo_start) {
                 continue;
             }
 
-            if (c->left() > wo_region.x_max()) {
+            if (c->left() > wo_end) {
                 break;
             }
 
@@ -314,6 +373,54 @@ namespace pdftoedn
     }
 
 
+    //
+    // the span's characters as a UTF-8 string
+    std::string PdfText::text() const
+    {
+        std::string str;
+        for (const PdfChar* c : chars) {
+            str += util::wstring_to_utfstring(c->wstr());
+        }
+        return str;
+    }
+
+
+    //
+    // a double as written to the output - the default stream
+    // precision of 6 significant digits
+    static std::string written_value(double v)
+    {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%g", v);
+        return buf;
+    }
+
+    //
+    // checks if the positions are evenly spaced so they can be
+    // represented by the first one and a constant advance. Needs at
+    // least 3 positions to save anything. Positions computed from the
+    // written start and advance must write out the same as the
+    // originals so nothing is lost
+    static bool uniform_advance(const std::vector<double>& x_pos, double& advance)
+    {
+        if (x_pos.size() < 3) {
+            return false;
+        }
+
+        advance = (x_pos.back() - x_pos.front()) / (x_pos.size() - 1);
+
+        double start = std::strtod(written_value(x_pos.front()).c_str(), NULL);
+        double step = std::strtod(written_value(advance).c_str(), NULL);
+
+        for (uintmax_t ii = 1; ii < x_pos.size(); ++ii) {
+            if (written_value(start + ii * step) != written_value(x_pos[ii])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+
     //
     // text span output in EDN
     std::ostream& PdfText::to_edn(std::ostream& o) const
@@ -416,8 +523,16 @@ namespace pdftoedn
         }
 
         // run through the list of characters to build the string and
-        // the x-position vector..
-        util::edn::Vector x_vector_a(chars.size());
+        // the x-positions.. Rotated spans have no page x-positions;
+        // they carry each character's offset along the baseline from
+        // the span's origin instead
+        std::vector<double> x_pos;
+        util::edn::Vector baseline_offs_a(0);
+        if (!ctm.is_rotated()) {
+            x_pos.reserve(chars.size());
+        } else {
+            baseline_offs_a.reserve(chars.size());
+        }
         std::string str;
         intmax_t glyph_idx = -1;
 
@@ -425,7 +540,9 @@ namespace pdftoedn
             str += util::wstring_to_utfstring(c->wstr());
 
             if (!ctm.is_rotated()) {
-                x_vector_a.push( c->bounding_box().x1() );
+                x_pos.push_back( c->bounding_box().x1() );
+            } else {
+                baseline_offs_a.push( c->left() - chars.front()->left() );
             }
 
             // if a glyph was encountered in the stream, length will
@@ -444,7 +561,24 @@ namespace pdftoedn
             text_h.push( PdfPage::SYMBOL_OPACITY,    attribs.gfx.fill.opacity );
         }
 
-        text_h.push( SYMBOL_X_POS_VECTOR,            x_vector_a );
+        // evenly spaced text (e.g., monospaced fonts) is output as
+        // the first position and the advance
+        double x_advance;
+        util::edn::Vector x_vector_a(0);
+        if (uniform_advance(x_pos, x_advance)) {
+            text_h.push( SYMBOL_X_START,             x_pos.front() );
+            text_h.push( SYMBOL_X_ADVANCE,           x_advance );
+        } else {
+            x_vector_a.reserve(x_pos.size());
+            for (double x : x_pos) {
+                x_vector_a.push( x );
+            }
+            text_h.push( SYMBOL_X_POS_VECTOR,        x_vector_a );
+        }
+
+        if (ctm.is_rotated()) {
+            text_h.push( SYMBOL_BASELINE_OFFS,       baseline_offs_a );
+        }
 
         if (glyph_idx != -1) {
             text_h.push( PdfText::SYMBOL_GLYPH_IDX,  glyph_idx );
@@ -466,6 +600,10 @@ namespace pdftoedn
             text_h.push( SYMBOL_INVISIBLE,           true );
         }
 
+        if (duplicate) {
+            text_h.push( SYMBOL_DUPLICATE,           true );
+        }
+
         o << text_h;
 
         // cleanup
@@ -473,17 +611,4 @@ namespace pdftoedn
         return o;
     }
 
-
-    // =============================================
-    // PdfGlyph - unmapped character to be represented via a path
-    //
-#if 0
-    Rice::Object PdfGlyph::to_ruby() const
-    {
-        Rice::Hash path_h = PdfPath::to_ruby();
-
-        return path_h;
-    }
-#endif
-
 } // namespace
@@ -78,10 +78,12 @@ namespace pdftoedn
         bool spans(const PdfChar& pre) const;
         intmax_t get_glyph_index() const { return glyph_idx; }
 
-        double width() const { return bbox.width(); }
+        double width() const { return right() - left(); }
 
         // coordinate of x-most vertex for the given position, taking
-        // in account rotation.
+        // in account rotation. Rotated characters are measured in
+        // their baseline frame: left & right along the baseline in
+        // reading direction, top & bottom across it
         double left() const;
         double right() const;
         double top() const;
@@ -112,6 +114,8 @@ namespace pdftoedn
         std::wstring unicode;
         intmax_t glyph_idx;
 
+        void baseline_extent(double& start, double& end, double& baseline) const;
+
         friend class PdfText;
 
         virtual std::ostream& to_edn(std::ostream& o) const { return o; }
@@ -126,8 +130,8 @@ namespace pdftoedn
     class PdfText : public PdfBoxedItem {
     public:
 
-        PdfText() : overlap_pred(NULL) { }
-        PdfText(const PdfTM& ctm) : PdfBoxedItem(ctm), overlap_pred(NULL) { }
+        PdfText() : duplicate(false), overlap_pred(NULL) { }
+        PdfText(const PdfTM& ctm) : PdfBoxedItem(ctm), duplicate(false), overlap_pred(NULL) { }
         virtual ~PdfText() { util::delete_ptr_container_elems(chars); delete overlap_pred; }
 
         // accessors, setters
@@ -138,6 +142,19 @@ namespace pdftoedn
         void whiteout(const BoundingBox& wo_region); // remove characters from the span covered by the region
         void finalize();
         intmax_t clip_id() const { return attribs.clip_path_id; }
+        intmax_t font_index() const { return attribs.txt.font_idx; }
+        intmax_t color_index() const { return attribs.gfx.fill.color_idx; }
+        intmax_t link_index() const { return attribs.txt.link_idx; }
+        bool is_duplicate() const { return duplicate; }
+        void mark_duplicate() { duplicate = true; }
+        std::string text() const; // UTF-8
+
+        // used when page resource tables are renumbered
+        void set_resource_indices(intmax_t font_idx, intmax_t color_idx, intmax_t clip_id) {
+            attribs.txt.font_idx = font_idx;
+            attribs.gfx.fill.color_idx = color_idx;
+            attribs.clip_path_id = clip_id;
+        }
 
         virtual bool is_positioned_before(const PdfBoxedItem* i) const;
 
@@ -146,10 +163,11 @@ namespace pdftoedn
 
         struct OverlapPred
         {
+            const PdfText& ps; // pending span
             const BoundingBox& ps_bbox; // pending span bbox
 
             OverlapPred(const PdfText& span) :
-                ps_bbox(span.bounding_box())
+                ps(span), ps_bbox(span.bounding_box())
             {}
 
             bool operator()(PdfBoxedItem* const bi);
@@ -165,6 +183,7 @@ namespace pdftoedn
 
     private:
         PdfChar::Attribs attribs;
+        bool duplicate; // overprints an earlier span
         mutable std::list<PdfChar *> chars;
         // used for checking text overlaps
         mutable OverlapPred *overlap_pred;
@@ -172,28 +191,4 @@ namespace pdftoedn
         void trim();
     };
 
-
-    // -------------------------------------------------------
-    // pdf characters without mappings - must be drawn using paths
-    // TODO: FIX
-    class PdfGlyph : public PdfPath {
-    public:
-        PdfGlyph(uintmax_t glyph_font_idx, uintmax_t glyph_unicode) :
-            //            PdfPath(PdfGlyph::SYMBOL),
-            font_idx(glyph_font_idx), unicode(glyph_unicode)
-        { }
-
-        bool equals(uintmax_t glyph_font_idx, uintmax_t glyph_unicode) const {
-            return ((glyph_font_idx == font_idx) && (glyph_unicode == unicode));
-        }
-
-        static const pdftoedn::Symbol SYMBOL;
-
-        //        virtual Rice::Object to_ruby() const;
-
-    private:
-        uintmax_t font_idx;
-        uintmax_t unicode;
-    };
-
 } // namespace
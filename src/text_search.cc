@@ -0,0 +1,95 @@
+#include <deque>
+
+#include "text_search.h"
+
+namespace pdftoedn
+{
+    //
+    // add the term's path to the trie
+    uintmax_t TextMatcher::add_term(const std::wstring& term)
+    {
+        uintmax_t n = 0;
+
+        for (wchar_t c : term) {
+            std::map<wchar_t, uintmax_t>::const_iterator ni = nodes[n].next.find(c);
+
+            if (ni == nodes[n].next.end()) {
+                nodes.push_back(Node());
+                nodes[n].next[c] = nodes.size() - 1;
+                n = nodes.size() - 1;
+            } else {
+                n = ni->second;
+            }
+        }
+
+        uintmax_t id = term_lengths.size();
+        nodes[n].out.push_back(id);
+        term_lengths.push_back(term.length());
+        built = false;
+        return id;
+    }
+
+
+    //
+    // compute the failure links breadth-first and merge the outputs
+    // of each node's failure target into its own
+    void TextMatcher::build()
+    {
+        std::deque<uintmax_t> queue;
+
+        for (const std::pair<const wchar_t, uintmax_t>& e : nodes[0].next) {
+            nodes[e.second].fail = 0;
+            queue.push_back(e.second);
+        }
+
+        while (!queue.empty()) {
+            uintmax_t n = queue.front();
+            queue.pop_front();
+
+            for (const std::pair<const wchar_t, uintmax_t>& e : nodes[n].next) {
+                uintmax_t f = nodes[n].fail;
+
+                while (f != 0 && nodes[f].next.find(e.first) == nodes[f].next.end()) {
+                    f = nodes[f].fail;
+                }
+
+                std::map<wchar_t, uintmax_t>::const_iterator fi = nodes[f].next.find(e.first);
+                nodes[e.second].fail = ((fi != nodes[f].next.end() && fi->second != e.second) ? fi->second : 0);
+
+                const std::vector<uintmax_t>& fail_out = nodes[ nodes[e.second].fail ].out;
+                nodes[e.second].out.insert(nodes[e.second].out.end(), fail_out.begin(), fail_out.end());
+
+                queue.push_back(e.second);
+            }
+        }
+
+        built = true;
+    }
+
+
+    //
+    // follow the goto / failure transitions for the character
+    const std::vector<uintmax_t>& TextMatcher::feed(wchar_t c)
+    {
+        if (!built) {
+            build();
+        }
+
+        while (true) {
+            std::map<wchar_t, uintmax_t>::const_iterator ni = nodes[state].next.find(c);
+
+            if (ni != nodes[state].next.end()) {
+                state = ni->second;
+                break;
+            }
+
+            if (state == 0) {
+                break;
+            }
+            state = nodes[state].fail;
+        }
+
+        return nodes[state].out;
+    }
+
+} // namespace
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <map>
+
+namespace pdftoedn
+{
+    // -------------------------------------------------------
+    // Aho-Corasick matcher - finds all occurrences of a set of terms
+    // in a stream of characters fed one at a time, so matches are
+    // found regardless of how the text is split in the document
+    //
+    class TextMatcher
+    {
+    public:
+        TextMatcher() : state(0), built(false) { nodes.push_back(Node()); }
+
+        // register a term and return its id. Terms must be added
+        // before the first call to feed()
+        uintmax_t add_term(const std::wstring& term);
+        uintmax_t num_terms() const { return term_lengths.size(); }
+        uintmax_t term_length(uintmax_t id) const { return term_lengths[id]; }
+
+        // restart matching (e.g., at the start of a page)
+        void reset() { state = 0; }
+
+        // advance with the next character; returns the ids of the
+        // terms that end at it
+        const std::vector<uintmax_t>& feed(wchar_t c);
+
+    private:
+        struct Node {
+            Node() : fail(0) {}
+
+            std::map<wchar_t, uintmax_t> next;
+            uintmax_t fail;
+            std::vector<uintmax_t> out; // terms ending here, incl. via fail links
+        };
+
+        std::vector<Node> nodes;
+        std::vector<uintmax_t> term_lengths;
+        uintmax_t state;
+        bool built;
+
+        void build();
+    };
+
+} // namespace
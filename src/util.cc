@@ -82,6 +82,11 @@ namespace pdftoedn
             return boost::locale::conv::utf_to_utf<char>(w_str);
         }
 
+        std::wstring utfstring_to_wstring(std::string const& str)
+        {
+            return boost::locale::conv::utf_to_utf<wchar_t>(str);
+        }
+
         //
         // convert poppler's Unicode to wstring
         std::wstring unicode_to_wstring(const Unicode* const u, int len)
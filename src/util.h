@@ -56,6 +56,7 @@ namespace pdftoedn {
         std::string string_to_utf(const std::wstring& str);
         std::wstring string_to_iso8859(const char* str);
         std::string wstring_to_utfstring(std::wstring const& w_str);
+        std::wstring utfstring_to_wstring(std::string const& str);
 
         std::wstring unicode_to_wstring(const Unicode* const u, int len);
         uint8_t pdf_to_svg_blend_mode(GfxBlendMode mode);
@@ -0,0 +1,489 @@
+#include <cstring>
+#include <memory>
+#include <algorithm>
+
+#include "util_arrow.h"
+
+namespace pdftoedn
+{
+    namespace util
+    {
+        namespace arrow
+        {
+            // buffer alignment within the message body
+            static const uintmax_t BODY_ALIGNMENT = 64;
+
+            static const char FILE_MAGIC[] = "ARROW1";
+            static const uint32_t CONTINUATION = 0xFFFFFFFF;
+
+            // format.fbs enum values
+            static const int16_t METADATA_V5     = 4;
+            static const uint8_t HEADER_SCHEMA   = 1;
+            static const uint8_t HEADER_BATCH    = 3;
+            static const uint8_t TYPE_INT        = 2;
+            static const uint8_t TYPE_FLOAT      = 3;
+            static const uint8_t TYPE_UTF8       = 5;
+            static const int16_t PRECISION_DOUBLE = 2;
+
+            //
+            // buffer helpers. Values are written in host order which
+            // is assumed to be little-endian as required by Arrow
+            static uintmax_t align_up(uintmax_t v, uintmax_t align)
+            {
+                return (v + align - 1) / align * align;
+            }
+
+            static void pad_to(std::vector<uint8_t>& buf, uintmax_t align)
+            {
+                buf.resize(align_up(buf.size(), align), 0);
+            }
+
+            template <class T>
+            static void put(std::vector<uint8_t>& buf, T v)
+            {
+                const uint8_t* p = reinterpret_cast<const uint8_t*>(&v);
+                buf.insert(buf.end(), p, p + sizeof(T));
+            }
+
+            static void patch_offset(std::vector<uint8_t>& buf, uintmax_t at, uintmax_t target)
+            {
+                uint32_t off = static_cast<uint32_t>(target - at);
+                std::memcpy(&buf[at], &off, sizeof(off));
+            }
+
+
+            // =============================================
+            // minimal flatbuffer encoder for the Arrow metadata.
+            // Unlike the flatbuffers library, objects are written
+            // parent first and offsets to children are patched once
+            // they've been written after it (offsets must point
+            // forward)
+            //
+            struct FbObject {
+                virtual ~FbObject() {}
+                // returns the position the object was written at
+                virtual uintmax_t write(std::vector<uint8_t>& buf) const = 0;
+            };
+            typedef std::shared_ptr<FbObject> FbObjectPtr;
+
+            class FbTable : public FbObject {
+            public:
+                template <class T>
+                FbTable* scalar(uint16_t id, T v) {
+                    Slot s(id);
+                    put(s.bytes, v);
+                    slots.push_back(s);
+                    return this;
+                }
+                FbTable* child(uint16_t id, const FbObjectPtr& obj) {
+                    Slot s(id);
+                    s.obj = obj;
+                    slots.push_back(s);
+                    return this;
+                }
+
+                virtual uintmax_t write(std::vector<uint8_t>& buf) const;
+
+            private:
+                struct Slot {
+                    Slot(uint16_t slot_id) : id(slot_id) {}
+                    uint16_t id;
+                    std::vector<uint8_t> bytes;
+                    FbObjectPtr obj;
+
+                    uintmax_t size() const { return (obj ? sizeof(uint32_t) : bytes.size()); }
+                };
+                std::vector<Slot> slots;
+            };
+
+            //
+            // writes the vtable followed by the table
+            uintmax_t FbTable::write(std::vector<uint8_t>& buf) const
+            {
+                uint16_t num_ids = 0;
+                uintmax_t max_align = sizeof(int32_t);
+                for (const Slot& s : slots) {
+                    num_ids = std::max<uint16_t>(num_ids, s.id + 1);
+                    max_align = std::max(max_align, s.size());
+                }
+
+                // lay out the fields after the vtable offset
+                pad_to(buf, sizeof(uint16_t));
+                uintmax_t vt_pos = buf.size();
+                uintmax_t vt_size = sizeof(uint16_t) * (2 + num_ids);
+                uintmax_t table_pos = align_up(vt_pos + vt_size, max_align);
+
+                std::vector<uint16_t> field_off(num_ids, 0);
+                std::vector<uintmax_t> slot_pos;
+                uintmax_t p = table_pos + sizeof(int32_t);
+                for (const Slot& s : slots) {
+                    p = align_up(p, s.size());
+                    field_off[s.id] = static_cast<uint16_t>(p - table_pos);
+                    slot_pos.push_back(p);
+                    p += s.size();
+                }
+
+                // vtable: its size, the table's size, field offsets
+                put(buf, static_cast<uint16_t>(vt_size));
+                put(buf, static_cast<uint16_t>(p - table_pos));
+                for (uint16_t off : field_off) {
+                    put(buf, off);
+                }
+
+                // the table, starting with its (backward) offset to
+                // the vtable
+                buf.resize(table_pos, 0);
+                put(buf, static_cast<int32_t>(table_pos - vt_pos));
+                for (uintmax_t ii = 0; ii < slots.size(); ++ii) {
+                    buf.resize(slot_pos[ii], 0);
+                    if (slots[ii].obj) {
+                        put(buf, static_cast<uint32_t>(0));
+                    } else {
+                        buf.insert(buf.end(), slots[ii].bytes.begin(), slots[ii].bytes.end());
+                    }
+                }
+                pad_to(buf, sizeof(uint32_t));
+
+                // now the children
+                for (uintmax_t ii = 0; ii < slots.size(); ++ii) {
+                    if (slots[ii].obj) {
+                        patch_offset(buf, slot_pos[ii], slots[ii].obj->write(buf));
+                    }
+                }
+                return table_pos;
+            }
+
+            struct FbString : public FbObject {
+                FbString(const std::string& s) : str(s) {}
+                std::string str;
+
+                virtual uintmax_t write(std::vector<uint8_t>& buf) const {
+                    pad_to(buf, sizeof(uint32_t));
+                    uintmax_t at = buf.size();
+                    put(buf, static_cast<uint32_t>(str.length()));
+                    buf.insert(buf.end(), str.begin(), str.end());
+                    buf.push_back(0);
+                    return at;
+                }
+            };
+
+            struct FbTableVector : public FbObject {
+                std::vector<FbObjectPtr> elems;
+
+                virtual uintmax_t write(std::vector<uint8_t>& buf) const {
+                    pad_to(buf, sizeof(uint32_t));
+                    uintmax_t at = buf.size();
+                    put(buf, static_cast<uint32_t>(elems.size()));
+                    buf.resize(buf.size() + elems.size() * sizeof(uint32_t), 0);
+
+                    for (uintmax_t ii = 0; ii < elems.size(); ++ii) {
+                        uintmax_t elem_at = at + sizeof(uint32_t) * (ii + 1);
+                        patch_offset(buf, elem_at, elems[ii]->write(buf));
+                    }
+                    return at;
+                }
+            };
+
+            // vector of 8-byte aligned structs given as raw bytes
+            struct FbStructVector : public FbObject {
+                FbStructVector() : count(0) {}
+                uint32_t count;
+                std::vector<uint8_t> bytes;
+
+                virtual uintmax_t write(std::vector<uint8_t>& buf) const {
+                    // the elements follow the length
+                    while ((buf.size() + sizeof(uint32_t)) % sizeof(uint64_t)) {
+                        buf.push_back(0);
+                    }
+                    uintmax_t at = buf.size();
+                    put(buf, count);
+                    buf.insert(buf.end(), bytes.begin(), bytes.end());
+                    return at;
+                }
+            };
+
+            //
+            // root offset followed by the root table
+            static std::vector<uint8_t> fb_finish(const FbObjectPtr& root)
+            {
+                std::vector<uint8_t> buf;
+                put(buf, static_cast<uint32_t>(0));
+                patch_offset(buf, 0, root->write(buf));
+                pad_to(buf, sizeof(uint64_t));
+                return buf;
+            }
+
+
+            // =============================================
+            // Arrow metadata
+            //
+            static FbObjectPtr schema_fb(const std::vector<Field>& fields)
+            {
+                std::shared_ptr<FbTableVector> fields_v = std::make_shared<FbTableVector>();
+
+                for (const Field& f : fields) {
+                    std::shared_ptr<FbTable> type = std::make_shared<FbTable>();
+                    uint8_t type_id;
+
+                    switch (f.type) {
+                      case INT32:
+                      case UINT32:
+                          type_id = TYPE_INT;
+                          type->scalar<int32_t>(0, 32)->scalar<uint8_t>(1, (f.type == INT32));
+                          break;
+                      case FLOAT64:
+                          type_id = TYPE_FLOAT;
+                          type->scalar<int16_t>(0, PRECISION_DOUBLE);
+                          break;
+                      case UTF8:
+                      default:
+                          type_id = TYPE_UTF8;
+                          break;
+                    }
+
+                    std::shared_ptr<FbTable> field = std::make_shared<FbTable>();
+                    field->child(0, std::make_shared<FbString>(f.name))
+                        ->scalar<uint8_t>(1, f.nullable)
+                        ->scalar<uint8_t>(2, type_id)
+                        ->child(3, type)
+                        ->child(5, std::make_shared<FbTableVector>()); // no children
+                    fields_v->elems.push_back(field);
+                }
+
+                std::shared_ptr<FbTable> schema = std::make_shared<FbTable>();
+                schema->child(1, fields_v);
+                return schema;
+            }
+
+            static std::vector<uint8_t> message_fb(uint8_t header_type, const FbObjectPtr& header, uint64_t body_len)
+            {
+                std::shared_ptr<FbTable> msg = std::make_shared<FbTable>();
+                msg->scalar<int16_t>(0, METADATA_V5)
+                    ->scalar<uint8_t>(1, header_type)
+                    ->child(2, header)
+                    ->scalar<int64_t>(3, body_len);
+                return fb_finish(msg);
+            }
+
+
+            // =============================================
+            // Column
+            //
+            void Column::set_valid(bool valid)
+            {
+                if (!valid && validity.empty()) {
+                    // first null - previous values were all valid
+                    validity.assign((len + 8) / 8, 0);
+                    for (uintmax_t ii = 0; ii < len; ++ii) {
+                        validity[ii / 8] |= (1 << (ii % 8));
+                    }
+                }
+
+                if (!validity.empty()) {
+                    if (validity.size() <= len / 8) {
+                        validity.push_back(0);
+                    }
+                    if (valid) {
+                        validity[len / 8] |= (1 << (len % 8));
+                    }
+                }
+
+                if (!valid) {
+                    ++null_count;
+                }
+                ++len;
+            }
+
+            void Column::push_int(intmax_t v)
+            {
+                if (type == UINT32) {
+                    put(data, static_cast<uint32_t>(v));
+                } else {
+                    put(data, static_cast<int32_t>(v));
+                }
+                set_valid(true);
+            }
+
+            void Column::push_double(double v)
+            {
+                put(data, v);
+                set_valid(true);
+            }
+
+            void Column::push_string(const std::string& s)
+            {
+                if (offsets.empty()) {
+                    offsets.push_back(0);
+                }
+                data.insert(data.end(), s.begin(), s.end());
+                offsets.push_back(static_cast<int32_t>(data.size()));
+                set_valid(true);
+            }
+
+            void Column::push_null()
+            {
+                // null slots still take up space in the value buffers
+                switch (type) {
+                  case FLOAT64:
+                      put(data, static_cast<double>(0));
+                      break;
+                  case UTF8:
+                      if (offsets.empty()) {
+                          offsets.push_back(0);
+                      }
+                      offsets.push_back(static_cast<int32_t>(data.size()));
+                      break;
+                  default:
+                      put(data, static_cast<int32_t>(0));
+                      break;
+                }
+                set_valid(false);
+            }
+
+            void Column::clear()
+            {
+                len = null_count = 0;
+                validity.clear();
+                offsets.clear();
+                data.clear();
+            }
+
+
+            // =============================================
+            // FileWriter
+            //
+            bool FileWriter::open(const std::string& filename)
+            {
+                out.open(filename.c_str(), std::ios::binary);
+                if (!out.is_open()) {
+                    return false;
+                }
+
+                // magic padded to 8 bytes, then the schema as in the
+                // stream format
+                const char magic[8] = { 'A', 'R', 'R', 'O', 'W', '1', 0, 0 };
+                return (write(magic, sizeof(magic)) &&
+                        write_message(message_fb(HEADER_SCHEMA, schema_fb(fields), 0), std::vector<uint8_t>()));
+            }
+
+
+            //
+            // encapsulated message: continuation marker, metadata
+            // length, metadata (padded to 8 bytes), and the body
+            bool FileWriter::write_message(const std::vector<uint8_t>& meta, const std::vector<uint8_t>& body)
+            {
+                int32_t meta_len = static_cast<int32_t>(meta.size());
+                return (write(&CONTINUATION, sizeof(CONTINUATION)) &&
+                        write(&meta_len, sizeof(meta_len)) &&
+                        write(meta.data(), meta.size()) &&
+                        write(body.data(), body.size()));
+            }
+
+
+            //
+            // append the buffers of each column to the body and
+            // describe them in the record batch metadata
+            bool FileWriter::write_batch(const std::vector<Column>& columns)
+            {
+                if (!out.is_open() || columns.size() != fields.size()) {
+                    return false;
+                }
+
+                uintmax_t num_rows = (columns.empty() ? 0 : columns.front().length());
+
+                std::vector<uint8_t> body;
+                std::shared_ptr<FbStructVector> nodes = std::make_shared<FbStructVector>();
+                std::shared_ptr<FbStructVector> buffers = std::make_shared<FbStructVector>();
+
+                auto add_buffer = [&](const uint8_t* bytes, uintmax_t len) {
+                    put(buffers->bytes, static_cast<int64_t>(body.size()));
+                    put(buffers->bytes, static_cast<int64_t>(len));
+                    ++buffers->count;
+
+                    body.insert(body.end(), bytes, bytes + len);
+                    pad_to(body, BODY_ALIGNMENT);
+                };
+
+                for (const Column& c : columns) {
+                    if (c.length() != num_rows) {
+                        return false;
+                    }
+
+                    put(nodes->bytes, static_cast<int64_t>(c.length()));
+                    put(nodes->bytes, static_cast<int64_t>(c.null_count));
+                    ++nodes->count;
+
+                    // validity bitmap can be omitted when there are no nulls
+                    add_buffer(c.validity.data(), (c.null_count ? c.validity.size() : 0));
+
+                    if (c.type == UTF8) {
+                        std::vector<int32_t> offsets(c.offsets);
+                        if (offsets.empty()) {
+                            offsets.push_back(0);
+                        }
+                        add_buffer(reinterpret_cast<const uint8_t*>(offsets.data()), offsets.size() * sizeof(int32_t));
+                    }
+                    add_buffer(c.data.data(), c.data.size());
+                }
+
+                std::shared_ptr<FbTable> batch = std::make_shared<FbTable>();
+                batch->scalar<int64_t>(0, num_rows)
+                    ->child(1, nodes)
+                    ->child(2, buffers);
+
+                std::vector<uint8_t> meta = message_fb(HEADER_BATCH, batch, body.size());
+
+                blocks.push_back(Block(pos, sizeof(uint32_t) * 2 + meta.size(), body.size()));
+                return write_message(meta, body);
+            }
+
+
+            //
+            // end-of-stream marker, then the footer pointing to the
+            // schema and record batches
+            bool FileWriter::close()
+            {
+                if (!out.is_open()) {
+                    return true;
+                }
+
+                std::shared_ptr<FbStructVector> batches = std::make_shared<FbStructVector>();
+                for (const Block& b : blocks) {
+                    put(batches->bytes, static_cast<int64_t>(b.offset));
+                    put(batches->bytes, b.meta_len);
+                    put(batches->bytes, static_cast<int32_t>(0)); // struct padding
+                    put(batches->bytes, static_cast<int64_t>(b.body_len));
+                    ++batches->count;
+                }
+
+                std::shared_ptr<FbTable> footer = std::make_shared<FbTable>();
+                footer->scalar<int16_t>(0, METADATA_V5)
+                    ->child(1, schema_fb(fields))
+                    ->child(2, std::make_shared<FbStructVector>()) // no dictionaries
+                    ->child(3, batches);
+                std::vector<uint8_t> footer_fb = fb_finish(footer);
+
+                const uint32_t eos = 0;
+                int32_t footer_len = static_cast<int32_t>(footer_fb.size());
+
+                bool ok = (write(&CONTINUATION, sizeof(CONTINUATION)) &&
+                           write(&eos, sizeof(eos)) &&
+                           write(footer_fb.data(), footer_fb.size()) &&
+                           write(&footer_len, sizeof(footer_len)) &&
+                           write(FILE_MAGIC, sizeof(FILE_MAGIC) - 1));
+                out.close();
+                blocks.clear();
+                return ok;
+            }
+
+
+            bool FileWriter::write(const void* bytes, uintmax_t len)
+            {
+                out.write(static_cast<const char*>(bytes), len);
+                pos += len;
+                return out.good();
+            }
+
+        } // arrow
+    } // util
+} // namespace
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdint>
+
+namespace pdftoedn
+{
+    namespace util
+    {
+        namespace arrow
+        {
+            //
+            // minimal writer for the Arrow IPC file format (a.k.a.
+            // Feather v2) so tabular data can be loaded by dataframe
+            // libraries without parsing EDN. Only flat columns of the
+            // types below are supported. Buffers are 64-byte aligned
+            // so readers can map them without copying.
+            //
+            enum Type {
+                INT32,
+                UINT32,
+                FLOAT64,
+                UTF8
+            };
+
+            struct Field {
+                Field(const std::string& field_name, Type field_type, bool is_nullable = false) :
+                    name(field_name), type(field_type), nullable(is_nullable) {}
+
+                std::string name;
+                Type type;
+                bool nullable;
+            };
+
+            // ---------------------------------------------------
+            // values of a column for the current record batch
+            //
+            class Column
+            {
+            public:
+                Column(Type column_type) : type(column_type), len(0), null_count(0) {}
+
+                void push_int(intmax_t v);
+                void push_double(double v);
+                void push_string(const std::string& s);
+                void push_null();
+
+                uintmax_t length() const { return len; }
+                void clear();
+
+            private:
+                Type type;
+                uintmax_t len;
+                uintmax_t null_count;
+                std::vector<uint8_t> validity; // empty until a null is pushed
+                std::vector<int32_t> offsets;  // UTF8 only
+                std::vector<uint8_t> data;
+
+                void set_valid(bool valid);
+
+                friend class FileWriter;
+            };
+
+            // ---------------------------------------------------
+            // writes the schema, one record batch per call to
+            // write_batch(), and the footer on close()
+            //
+            class FileWriter
+            {
+            public:
+                FileWriter(const std::vector<Field>& schema_fields) : fields(schema_fields), pos(0) {}
+                ~FileWriter() { close(); }
+
+                bool open(const std::string& filename);
+                bool is_open() const { return out.is_open(); }
+
+                // columns must match the schema and have the same length
+                bool write_batch(const std::vector<Column>& columns);
+                bool close();
+
+            private:
+                struct Block {
+                    Block(uint64_t o, int32_t m, uint64_t b) : offset(o), meta_len(m), body_len(b) {}
+                    uint64_t offset;
+                    int32_t meta_len;
+                    uint64_t body_len;
+                };
+
+                std::vector<Field> fields;
+                std::ofstream out;
+                uint64_t pos;
+                std::vector<Block> blocks;
+
+                bool write(const void* bytes, uintmax_t len);
+                bool write_message(const std::vector<uint8_t>& meta, const std::vector<uint8_t>& body);
+
+                // prohibit
+                FileWriter(const FileWriter&);
+                FileWriter& operator=(const FileWriter&);
+            };
+
+        } // arrow
+    } // util
+} // namespace
@@ -52,7 +52,21 @@ namespace pdftoedn {
                 //               double-nested array and each command
                 //               is now contained in a vector instead
                 //               of a hash
-                return 0x40320;
+                // 0005 0350:  unreleased, v0.35.0
+                //             - spans with evenly spaced characters
+                //               carry :x_start and :x_advance instead
+                //               of :x_vector
+                //             - rotated spans carry offsets along the
+                //               baseline in :baseline_offsets; their
+                //               :x_vector stays empty
+                //             - duplicate overprinted spans are
+                //               dropped or flagged with :duplicate
+                //             - Type3 characters are output as
+                //               spans; their graphics as :glyph
+                //               references to :glyphs resources
+                //             - image masks are colorless; their
+                //               :image entries carry :fill_color_idx
+                return 0x50350;
             }
         } // version
     } // util
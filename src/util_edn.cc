@@ -3,6 +3,11 @@
 #include <algorithm>
 #include <ostream>
 #include <vector>
+#include <sstream>
+#include <thread>
+#include <mutex>
+#include <functional>
+#include <atomic>
 #include <assert.h>
 
 #include "base_types.h"
@@ -133,6 +138,151 @@ namespace pdftoedn
             void Hash::push(const EDNNode& n1, const EDNNode& n2) {
                 push_elem(std::pair<EDNNode, EDNNode>(n1, n2));
             }
+
+
+            // =============================================
+            // parallel serialization
+            //
+
+            // number of vector items written by each job
+            static const uintmax_t PARALLEL_CHUNK_ITEMS = 512;
+            // upper limit on the number of writer threads
+            static const uintmax_t MAX_WRITER_THREADS = 8;
+
+            void ParallelWriter::add_vector(const std::vector<const pdftoedn::gemable*>& items, Raw& out)
+            {
+                uintmax_t first = jobs.size();
+                const pdftoedn::gemable* const* data = items.data();
+
+                for (uintmax_t ii = 0; ii < items.size(); ii += PARALLEL_CHUNK_ITEMS) {
+                    jobs.push_back( Job(data + ii, data + std::min<uintmax_t>(ii + PARALLEL_CHUNK_ITEMS, items.size())) );
+                }
+                outputs.push_back( Output(out, first, jobs.size() - first, true) );
+            }
+
+            void ParallelWriter::add(const pdftoedn::gemable* item, Raw& out)
+            {
+                jobs.push_back( Job(item) );
+                outputs.push_back( Output(out, jobs.size() - 1, 1, false) );
+            }
+
+            WriterPool::~WriterPool()
+            {
+                {
+                    std::lock_guard<std::mutex> lock(mtx);
+                    stopping = true;
+                }
+                start_cv.notify_all();
+
+                for (std::thread& t : threads) {
+                    t.join();
+                }
+            }
+
+            void WriterPool::run(const std::function<void()>& job_loop)
+            {
+                std::lock_guard<std::mutex> run_lock(run_mtx);
+
+                {
+                    std::lock_guard<std::mutex> lock(mtx);
+
+                    // the calling thread is one of the writers
+                    if (threads.empty()) {
+                        uintmax_t num_threads = std::max<uintmax_t>(1, std::thread::hardware_concurrency());
+                        num_threads = std::min(num_threads, MAX_WRITER_THREADS);
+
+                        for (uintmax_t t = 1; t < num_threads; ++t) {
+                            threads.push_back( std::thread(&WriterPool::worker, this, generation) );
+                        }
+                    }
+
+                    work = &job_loop;
+                    active = threads.size();
+                    ++generation;
+                }
+                start_cv.notify_all();
+
+                job_loop();
+
+                std::unique_lock<std::mutex> lock(mtx);
+                done_cv.wait(lock, [this]() { return active == 0; });
+                work = NULL;
+            }
+
+            //
+            // wait for each run() and call its work
+            void WriterPool::worker(uintmax_t start_generation)
+            {
+                uintmax_t seen = start_generation;
+
+                while (true) {
+                    const std::function<void()>* job_loop;
+                    {
+                        std::unique_lock<std::mutex> lock(mtx);
+                        start_cv.wait(lock, [&]() { return (stopping || generation != seen); });
+                        if (stopping) {
+                            return;
+                        }
+                        seen = generation;
+                        job_loop = work;
+                    }
+
+                    (*job_loop)();
+
+                    std::lock_guard<std::mutex> lock(mtx);
+                    if (--active == 0) {
+                        done_cv.notify_one();
+                    }
+                }
+            }
+
+
+            //
+            // write the jobs and join the chunks into their outputs
+            void ParallelWriter::run()
+            {
+                std::atomic<uintmax_t> next_job(0);
+
+                edn_writer_pool.run([this, &next_job]() {
+                        for (uintmax_t ii = next_job++; ii < jobs.size(); ii = next_job++) {
+                            Job& job = jobs[ii];
+                            std::ostringstream buf;
+                            buf.copyfmt(fmt);
+
+                            if (!job.begin) {
+                                buf << *job.item;
+                            } else {
+                                for (const pdftoedn::gemable* const* g = job.begin; g != job.end; ++g) {
+                                    if (g != job.begin) {
+                                        buf << " ";
+                                    }
+                                    buf << **g;
+                                }
+                            }
+                            job.out = buf.str();
+                        }
+                    });
+
+                // same separators as Vector
+                for (Output& out : outputs) {
+                    if (!out.is_vector) {
+                        out.raw.str.swap(jobs[out.first_job].out);
+                        continue;
+                    }
+
+                    out.raw.str = "[";
+                    for (uintmax_t ii = 0; ii < out.num_jobs; ++ii) {
+                        if (ii > 0) {
+                            out.raw.str += " ";
+                        }
+                        out.raw.str += jobs[out.first_job + ii].out;
+                    }
+                    out.raw.str += "]";
+                }
+
+                jobs.clear();
+                outputs.clear();
+            }
         }
     }
 } // namespace
@@ -1,6 +1,12 @@
 #pragma once
 
 #include <vector>
+#include <string>
+#include <ostream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
 
 #ifdef CHECK_CAP_CHANGE
 #include <iostream>
@@ -149,6 +155,101 @@ namespace pdftoedn {
             };
 
 
+            // ===========================================================
+            // EDN text that has already been serialized, output as
+            // is. Used to splice in data written elsewhere
+            struct Raw : public pdftoedn::gemable
+            {
+                std::string str;
+
+                virtual std::ostream& to_edn(std::ostream& o) const { return (o << str); }
+            };
+
+
+            // ===========================================================
+            // worker threads used by ParallelWriter, shared by all the
+            // pages of a run. They are started the first time they're
+            // needed and wait between pages
+            class WriterPool
+            {
+            public:
+                WriterPool() : work(NULL), generation(0), active(0), stopping(false) {}
+                ~WriterPool();
+
+                // calls work on every pool thread and the calling one
+                // and returns once they have all returned. Concurrent
+                // callers take turns
+                void run(const std::function<void()>& job_loop);
+
+            private:
+                std::vector<std::thread> threads;
+                std::mutex run_mtx;
+                std::mutex mtx;
+                std::condition_variable start_cv;
+                std::condition_variable done_cv;
+                const std::function<void()>* work;
+                uintmax_t generation;
+                uintmax_t active;
+                bool stopping;
+
+                void worker(uintmax_t start_generation);
+
+                // prohibit
+                WriterPool(const WriterPool&);
+                WriterPool& operator=(const WriterPool&);
+            };
+
+
+            // ===========================================================
+            // serializes independent items on the writer pool. Each
+            // queued vector is split in chunks written to separate
+            // buffers which are joined in order once run() returns so
+            // the result matches what a util::edn::Vector with the
+            // same items would output. Items must not be modified by
+            // their to_edn()
+            class ParallelWriter
+            {
+            public:
+                // buffers copy the formatting state of the destination
+                // stream
+                ParallelWriter(const std::ostream& fmt_stream) : fmt(fmt_stream) {}
+
+                void add_vector(const std::vector<const pdftoedn::gemable*>& items, Raw& out);
+                void add(const pdftoedn::gemable* item, Raw& out);
+                void run();
+
+            private:
+                // a range of vector items or a single item
+                struct Job {
+                    Job(const pdftoedn::gemable* const* first, const pdftoedn::gemable* const* last) :
+                        begin(first), end(last), item(NULL) {}
+                    Job(const pdftoedn::gemable* g) :
+                        begin(NULL), end(NULL), item(g) {}
+
+                    const pdftoedn::gemable* const* begin;
+                    const pdftoedn::gemable* const* end;
+                    const pdftoedn::gemable* item;
+                    std::string out;
+                };
+
+                // output -> index of its first job and the number of
+                // jobs, plus whether it's a vector
+                struct Output {
+                    Output(Raw& r, uintmax_t first, uintmax_t n, bool vec) :
+                        raw(r), first_job(first), num_jobs(n), is_vector(vec) {}
+
+                    Raw& raw;
+                    uintmax_t first_job;
+                    uintmax_t num_jobs;
+                    bool is_vector;
+                };
+
+                const std::ostream& fmt;
+                std::vector<Job> jobs;
+                std::vector<Output> outputs;
+            };
+
+
             // ===========================================================
             // the EDN Node proxy class that handles duplication and
             // freeing as necessary. It is similar to unique_ptr in
@@ -242,5 +343,7 @@ namespace pdftoedn {
             };
         }
     }
+
+    extern pdftoedn::util::edn::WriterPool edn_writer_pool;
 }
 
@@ -1,13 +1,32 @@
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
 #include <iostream>
 #include <sstream>
 #include <ostream>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <chrono>
 
 #include <png.h>
 #include <zlib.h>
+#include <poppler/Object.h>
+#include <poppler/Stream.h>
 #include <poppler/GfxState.h>
 
+#ifdef HAVE_LIBJPEG
+#include <cstdio>
+#include <csetjmp>
+extern "C" {
+#include <jpeglib.h>
+}
+#endif
+
 #include "image.h"
 #include "pdf_error_tracker.h"
+#include "pdf_stats_tracker.h"
 #include "util_encode.h"
 #include "edsel_options.h"
 
@@ -111,11 +130,25 @@ namespace pdftoedn
             }
 
 
+            //
+            // rows are either written to the PNG directly or, if a
+            // buffer is given, collected for analysis
+            static inline void write_image_row(png_structp png_ptr, png_bytep row, size_t row_bytes,
+                                               std::vector<uint8_t>* pixels)
+            {
+                if (pixels) {
+                    pixels->insert(pixels->end(), row, row + row_bytes);
+                } else {
+                    png_write_rows(png_ptr, &row, 1);
+                }
+            }
+
             //
             // copy pixmap data
             static void copy_image_data(png_structp png_ptr,
                                         ImageStream* img_str, uint32_t width, uint32_t height,
-                                        uint8_t num_pix_comps, GfxColorSpaceMode cspace_mode, GfxColorSpace* cspace)
+                                        uint8_t num_pix_comps, GfxColorSpaceMode cspace_mode, GfxColorSpace* cspace,
+                                        std::vector<uint8_t>* pixels = NULL)
             {
                 // read the image bytes
                 img_str->reset();
@@ -154,7 +187,7 @@ namespace pdftoedn
                           for (size_t y = 0; y < height; ++y)
                           {
                               cmyk_cs->getRGBLine(img_str->getLine(), data_row, width);
-                              png_write_rows(png_ptr, &data_row, 1);
+                              write_image_row(png_ptr, data_row, 3 * width, pixels);
                           }
 
                           png_free(png_ptr, data_row);
@@ -190,7 +223,7 @@ namespace pdftoedn
                                       }
                                   }
                               }
-                              png_write_rows(png_ptr, &data_row, 1);
+                              write_image_row(png_ptr, data_row, num_pix_comps * width, pixels);
                           }
 
                           png_free(png_ptr, data_row);
@@ -206,6 +239,268 @@ namespace pdftoedn
             }
 
 
+            // -------------------------------------------------------------------------------
+            // content-aware color type reduction. Many RGB images are
+            // actually grayscale or carry few colors and many alpha
+            // channels are fully opaque so pixels are analysed first
+            // to pick the smallest lossless PNG representation
+            //
+
+            // images with more data than this are not buffered for
+            // analysis - they are written as-is
+            static const uintmax_t MAX_REDUCTION_BUFFER_BYTES = 64 * 1024 * 1024;
+
+            // width * height * bytes_per_pixel can wrap for 32-bit
+            // dimensions so the limit is divided down instead
+            static bool fits_reduction_buffer(uintmax_t width, uintmax_t height, uintmax_t bytes_per_pixel)
+            {
+                if (width == 0 || height == 0) {
+                    return true;
+                }
+                return (width <= MAX_REDUCTION_BUFFER_BYTES / bytes_per_pixel &&
+                        height <= MAX_REDUCTION_BUFFER_BYTES / bytes_per_pixel / width);
+            }
+
+            struct PixelStats {
+                PixelStats() : is_gray(true), is_opaque(true), gray_depth(1), palette_ok(true) {}
+
+                bool is_gray;
+                bool is_opaque;
+                uint8_t gray_depth;
+                bool palette_ok;
+
+                // distinct RGBA values in order of appearance
+                std::vector<uint32_t> palette;
+                std::unordered_map<uint32_t, uint8_t> palette_idx;
+            };
+
+            //
+            // smallest bit depth that can represent a gray value
+            // exactly (0x11, 0x55, 0xff are the 4, 2, and 1-bit scale
+            // factors)
+            static inline uint8_t gray_depth_for(uint8_t v)
+            {
+                if (v % 0x11) return 8;
+                if (v % 0x55) return 4;
+                if (v % 0xff) return 2;
+                return 1;
+            }
+
+            static inline uint8_t palette_depth_for(size_t num_colors)
+            {
+                if (num_colors <= 2)  return 1;
+                if (num_colors <= 4)  return 2;
+                if (num_colors <= 16) return 4;
+                return 8;
+            }
+
+            static inline uint32_t rgba_key(const uint8_t* p, uint8_t a)
+            {
+                return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) | ((uint32_t) p[2] << 8) | a;
+            }
+
+            //
+            // run through the pixels once collecting what's needed
+            // to choose the output type
+            static void analyse_pixels(const std::vector<uint8_t>& pixels, uint8_t num_chans, PixelStats& ps)
+            {
+                for (size_t i = 0; i < pixels.size(); i += num_chans)
+                {
+                    const uint8_t* p = &pixels[i];
+                    uint8_t a = (num_chans == 4 ? p[3] : 0xff);
+
+                    if (ps.is_gray) {
+                        if (p[0] != p[1] || p[0] != p[2]) {
+                            ps.is_gray = false;
+                        } else if (ps.gray_depth < 8) {
+                            ps.gray_depth = std::max(ps.gray_depth, gray_depth_for(p[0]));
+                        }
+                    }
+
+                    if (a != 0xff) {
+                        ps.is_opaque = false;
+                    }
+
+                    if (ps.palette_ok) {
+                        uint32_t key = rgba_key(p, a);
+
+                        if (ps.palette_idx.find(key) == ps.palette_idx.end()) {
+                            if (ps.palette.size() == 256) {
+                                // too many colors
+                                ps.palette_ok = false;
+                                ps.palette.clear();
+                                ps.palette_idx.clear();
+                            } else {
+                                ps.palette_idx[key] = ps.palette.size();
+                                ps.palette.push_back(key);
+                            }
+                        }
+                    }
+
+                    // stop early if there's nothing left to learn
+                    if (!ps.is_gray && !ps.palette_ok && (num_chans == 3 || !ps.is_opaque)) {
+                        break;
+                    }
+                }
+            }
+
+            //
+            // write the buffered 8-bit RGB or RGBA pixels using the
+            // smallest lossless representation. Returns the PNG color
+            // type used
+            static int write_reduced_png(png_structp png_ptr, png_infop info_ptr,
+                                         uint32_t width, uint32_t height,
+                                         const std::vector<uint8_t>& pixels, uint8_t num_chans)
+            {
+                PixelStats ps;
+                analyse_pixels(pixels, num_chans, ps);
+
+                bool has_alpha = (num_chans == 4 && !ps.is_opaque);
+                uint8_t pal_depth = palette_depth_for(ps.palette.size());
+                int png_type;
+                uint8_t depth = 8;
+
+                if (has_alpha) {
+                    // gray + alpha must be 8-bit
+                    if (ps.is_gray) {
+                        png_type = PNG_COLOR_TYPE_GRAY_ALPHA;
+                    } else if (ps.palette_ok) {
+                        png_type = PNG_COLOR_TYPE_PALETTE;
+                        depth = pal_depth;
+                    } else {
+                        png_type = PNG_COLOR_TYPE_RGB_ALPHA;
+                    }
+                } else {
+                    // alpha, if any, can be dropped
+                    if (ps.is_gray && ps.gray_depth < 8) {
+                        png_type = PNG_COLOR_TYPE_GRAY;
+                        depth = ps.gray_depth;
+                    } else if (ps.palette_ok && pal_depth < 8) {
+                        png_type = PNG_COLOR_TYPE_PALETTE;
+                        depth = pal_depth;
+                    } else if (ps.is_gray) {
+                        png_type = PNG_COLOR_TYPE_GRAY;
+                    } else if (ps.palette_ok) {
+                        png_type = PNG_COLOR_TYPE_PALETTE;
+                    } else {
+                        png_type = PNG_COLOR_TYPE_RGB;
+                    }
+                }
+
+                png_set_IHDR(png_ptr, info_ptr, width, height, depth,
+                             png_type,
+                             PNG_INTERLACE_NONE,
+                             PNG_COMPRESSION_TYPE_BASE, PNG_FILTER_TYPE_BASE);
+
+                if (pdftoedn::options.libpng_use_best_compression()) {
+                    png_set_compression_level(png_ptr, Z_BEST_COMPRESSION);
+                }
+
+                std::vector<png_color> palette;
+                std::vector<png_byte> transp;
+
+                if (png_type == PNG_COLOR_TYPE_PALETTE) {
+                    palette.resize(ps.palette.size());
+                    for (size_t i = 0; i < ps.palette.size(); ++i) {
+                        palette[i].red   = (ps.palette[i] >> 24) & 0xff;
+                        palette[i].green = (ps.palette[i] >> 16) & 0xff;
+                        palette[i].blue  = (ps.palette[i] >> 8) & 0xff;
+
+                        if (has_alpha) {
+                            transp.push_back(ps.palette[i] & 0xff);
+                        }
+                    }
+                    png_set_PLTE(png_ptr, info_ptr, &palette[0], palette.size());
+
+                    if (!transp.empty()) {
+                        png_set_tRNS(png_ptr, info_ptr, &transp[0], transp.size(), NULL);
+                    }
+                }
+
+                png_write_info(png_ptr, info_ptr);
+
+                // one sample per byte is passed in for 1, 2, 4-bit
+                // depths so have libpng pack them
+                if (depth < 8) {
+                    png_set_packing(png_ptr);
+                }
+
+                uint8_t out_chans = 1;
+                if (png_type == PNG_COLOR_TYPE_GRAY_ALPHA) {
+                    out_chans = 2;
+                } else if (png_type == PNG_COLOR_TYPE_RGB) {
+                    out_chans = 3;
+                } else if (png_type == PNG_COLOR_TYPE_RGB_ALPHA) {
+                    out_chans = 4;
+                }
+
+                std::vector<png_byte> row(width * out_chans);
+                png_bytep row_p = &row[0];
+                uint8_t gray_scale = 0xff / ((1 << depth) - 1);
+
+                for (size_t y = 0; y < height; ++y)
+                {
+                    const uint8_t* p = &pixels[y * width * num_chans];
+
+                    for (size_t x = 0, o = 0; x < width; ++x, p += num_chans)
+                    {
+                        switch (png_type)
+                        {
+                          case PNG_COLOR_TYPE_GRAY:
+                              row[o++] = p[0] / gray_scale;
+                              break;
+                          case PNG_COLOR_TYPE_GRAY_ALPHA:
+                              row[o++] = p[0];
+                              row[o++] = p[3];
+                              break;
+                          case PNG_COLOR_TYPE_PALETTE:
+                              row[o++] = ps.palette_idx[ rgba_key(p, (num_chans == 4 ? p[3] : 0xff)) ];
+                              break;
+                          default:
+                              for (uint8_t c = 0; c < out_chans; ++c) {
+                                  row[o++] = p[c];
+                              }
+                              break;
+                        }
+                    }
+                    png_write_rows(png_ptr, &row_p, 1);
+                }
+
+                png_write_end(png_ptr, info_ptr);
+                return png_type;
+            }
+
+            //
+            // track per-output-type sizes and encode times
+            static void record_encode_stats(int png_type, uintmax_t sample_bytes_in, uintmax_t sample_bytes_out,
+                                            std::streamoff png_bytes,
+                                            const std::chrono::steady_clock::time_point& start)
+            {
+                std::string group = "png_";
+                switch (png_type)
+                {
+                  case PNG_COLOR_TYPE_GRAY:       group += "gray";       break;
+                  case PNG_COLOR_TYPE_GRAY_ALPHA: group += "gray_alpha"; break;
+                  case PNG_COLOR_TYPE_PALETTE:    group += "palette";    break;
+                  case PNG_COLOR_TYPE_RGB:        group += "rgb";        break;
+                  case PNG_COLOR_TYPE_RGB_ALPHA:  group += "rgba";       break;
+                  default:                        group += "other";      break;
+                }
+
+                std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+                stats.add( group, "images" );
+                stats.add( group, "sample_bytes_in", sample_bytes_in );
+                stats.add( group, "sample_bytes_out", sample_bytes_out );
+                stats.add( group, "sample_bytes_saved",
+                           (sample_bytes_in > sample_bytes_out ? sample_bytes_in - sample_bytes_out : 0) );
+                if (png_bytes > 0) {
+                    stats.add( group, "png_bytes", png_bytes );
+                }
+                stats.add_time( group, "encode_ms", elapsed.count() );
+            }
+
+
             //
             // export the data as a PNG onto an ostream - based on:
             //
@@ -250,6 +545,15 @@ namespace pdftoedn
                 int png_type = poppler_cspace_mode_to_png_type(num_pix_comps, cspace_mode);
                 png_colorp palette = NULL;
 
+                // 8-bit RGB data (CMYK is converted) is buffered so the
+                // output type can be reduced based on its content
+                bool reduce = (png_type == PNG_COLOR_TYPE_RGB && bpp == 8 &&
+                               (cspace_mode == csDeviceCMYK || num_pix_comps == 3) &&
+                               fits_reduction_buffer(width, height, 3));
+                uintmax_t sample_bytes_in = 0;
+                std::streamoff start_pos = output.tellp();
+                std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
 #if 0
                 std::cerr << "color space mode is: '"
                           << color_map->getColorSpace()->getColorSpaceModeName(cspace_mode)
@@ -261,70 +565,88 @@ namespace pdftoedn
                 bool status = true;
                 try
                 {
-                    // Set the image information here.  Width and height
-                    // are up to 2^31, bit_depth is one of 1, 2, 4, 8, or
-                    // 16, but valid values also depend on the color_type
-                    // selected. color_type is one of PNG_COLOR_TYPE_GRAY,
-                    // PNG_COLOR_TYPE_GRAY_ALPHA, PNG_COLOR_TYPE_PALETTE,
-                    // PNG_COLOR_TYPE_RGB, or PNG_COLOR_TYPE_RGB_ALPHA.
-                    // interlace is either PNG_INTERLACE_NONE or
-                    // PNG_INTERLACE_ADAM7, and the compression_type and
-                    // filter_type MUST currently be
-                    // PNG_COMPRESSION_TYPE_BASE and PNG_FILTER_TYPE_BASE.
-                    //
-                    png_set_IHDR(png_ptr, info_ptr, width, height, bpp,
-                                 png_type,
-                                 PNG_INTERLACE_NONE,
-                                 PNG_COMPRESSION_TYPE_BASE, PNG_FILTER_TYPE_BASE);
+                    if (reduce) {
+                        std::vector<uint8_t> pixels;
+                        pixels.reserve(width * height * 3);
 
-                    if (pdftoedn::options.libpng_use_best_compression()) {
-                        png_set_compression_level(png_ptr, Z_BEST_COMPRESSION);
+                        copy_image_data(png_ptr, img_str, width, height, num_pix_comps,
+                                        cspace_mode, color_map->getColorSpace(), &pixels);
+                        sample_bytes_in = pixels.size();
+
+                        png_type = write_reduced_png(png_ptr, info_ptr, width, height, pixels, 3);
                     }
+                    else {
+                        // Set the image information here.  Width and height
+                        // are up to 2^31, bit_depth is one of 1, 2, 4, 8, or
+                        // 16, but valid values also depend on the color_type
+                        // selected. color_type is one of PNG_COLOR_TYPE_GRAY,
+                        // PNG_COLOR_TYPE_GRAY_ALPHA, PNG_COLOR_TYPE_PALETTE,
+                        // PNG_COLOR_TYPE_RGB, or PNG_COLOR_TYPE_RGB_ALPHA.
+                        // interlace is either PNG_INTERLACE_NONE or
+                        // PNG_INTERLACE_ADAM7, and the compression_type and
+                        // filter_type MUST currently be
+                        // PNG_COMPRESSION_TYPE_BASE and PNG_FILTER_TYPE_BASE.
+                        //
+                        png_set_IHDR(png_ptr, info_ptr, width, height, bpp,
+                                     png_type,
+                                     PNG_INTERLACE_NONE,
+                                     PNG_COMPRESSION_TYPE_BASE, PNG_FILTER_TYPE_BASE);
+
+                        if (pdftoedn::options.libpng_use_best_compression()) {
+                            png_set_compression_level(png_ptr, Z_BEST_COMPRESSION);
+                        }
 
-                    // allocate palette for indexed-color images
-                    if (png_type == PNG_COLOR_TYPE_PALETTE)
-                    {
-                        int n = 1 << bpp;
+                        // allocate palette for indexed-color images
+                        if (png_type == PNG_COLOR_TYPE_PALETTE)
+                        {
+                            int n = 1 << bpp;
 
-                        palette = reinterpret_cast<png_colorp>( png_malloc(png_ptr, n * sizeof (png_color)) );
-                        if (!palette) {
-                            std::stringstream err;
-                            err << __FUNCTION__ << "() - couldn't alloc storage for image palette";
-                            throw std::runtime_error(err.str());
-                        }
+                            palette = reinterpret_cast<png_colorp>( png_malloc(png_ptr, n * sizeof (png_color)) );
+                            if (!palette) {
+                                std::stringstream err;
+                                err << __FUNCTION__ << "() - couldn't alloc storage for image palette";
+                                throw std::runtime_error(err.str());
+                            }
 
-                        Guchar pix;
-                        GfxRGB rgb;
+                            Guchar pix;
+                            GfxRGB rgb;
 
-                        for (int i = 0; i < n; i++) {
-                            pix = (Guchar) i;
+                            for (int i = 0; i < n; i++) {
+                                pix = (Guchar) i;
 
-                            color_map->getRGB(&pix, &rgb);
-                            palette[i].red = colToByte(rgb.r);
-                            palette[i].green = colToByte(rgb.g);
-                            palette[i].blue = colToByte(rgb.b);
+                                color_map->getRGB(&pix, &rgb);
+                                palette[i].red = colToByte(rgb.r);
+                                palette[i].green = colToByte(rgb.g);
+                                palette[i].blue = colToByte(rgb.b);
+                            }
+
+                            png_set_PLTE(png_ptr, info_ptr, palette, n);
                         }
 
-                        png_set_PLTE(png_ptr, info_ptr, palette, n);
-                    }
+                        // Write the file header information.
+                        png_write_info(png_ptr, info_ptr);
 
-                    // Write the file header information.
-                    png_write_info(png_ptr, info_ptr);
+                        // pack pixels into bytes
+                        png_set_packing(png_ptr);
 
-                    // pack pixels into bytes
-                    png_set_packing(png_ptr);
+                        // swap bits of 1, 2, 4 bit packed pixel formats
+                        png_set_packswap(png_ptr);
 
-                    // swap bits of 1, 2, 4 bit packed pixel formats
-                    png_set_packswap(png_ptr);
+                        // ready to copy the data - iterate through the lines
+                        img_str->reset();
+                        copy_image_data(png_ptr, img_str, width, height, num_pix_comps,
+                                        cspace_mode, color_map->getColorSpace());
 
-                    // ready to copy the data - iterate through the lines
-                    img_str->reset();
-                    copy_image_data(png_ptr, img_str, width, height, num_pix_comps,
-                                    cspace_mode, color_map->getColorSpace());
+                        // finish writing the rest of the file
+                        png_write_end(png_ptr, info_ptr);
 
-                    // finish writing the rest of the file
-                    png_write_end(png_ptr, info_ptr);
+                        sample_bytes_in = png_get_rowbytes(png_ptr, info_ptr) * height;
+                    }
 
+                    std::streamoff end_pos = output.tellp();
+                    record_encode_stats(png_type, sample_bytes_in, png_get_rowbytes(png_ptr, info_ptr) * height,
+                                        ((start_pos >= 0 && end_pos >= 0) ? end_pos - start_pos : 0),
+                                        start);
                 }
                 catch (libpng_error& e) {
                     et.log_critical( ErrorTracker::ERROR_PNG_ERROR, MODULE, e.what() );
@@ -349,6 +671,283 @@ namespace pdftoedn
             }
 
 
+#ifdef HAVE_LIBJPEG
+            // -------------------------------------------------------------------------------
+            // scaled JPEG decoding. libjpeg can produce 1/2, 1/4, or
+            // 1/8-size output straight from the DCT coefficients so
+            // large photos drawn small on the page don't have to be
+            // decoded in full
+            //
+            // libjpeg is C so its fatal errors can't be thrown
+            // through it - error_exit longjmps back to the decode
+            // instead
+            struct JpegErrorMgr {
+                jpeg_error_mgr pub; // must be first
+                std::jmp_buf setjmp_buf;
+                char msg[JMSG_LENGTH_MAX];
+            };
+
+            static void jpeg_error_exit(j_common_ptr cinfo)
+            {
+                JpegErrorMgr* err = reinterpret_cast<JpegErrorMgr*>(cinfo->err);
+                (*cinfo->err->format_message)(cinfo, err->msg);
+                std::longjmp(err->setjmp_buf, 1);
+            }
+
+            static void jpeg_output_message(j_common_ptr cinfo)
+            {
+                char msg[JMSG_LENGTH_MAX];
+                (*cinfo->err->format_message)(cinfo, msg);
+                et.log_warn( ErrorTracker::ERROR_UT_IMAGE_ENCODE, MODULE, msg );
+            }
+
+            //
+            // largest power-of-two reduction that keeps the image at
+            // or above the requested resolution at the size it's
+            // drawn. Returns 1 if the image should be decoded by
+            // poppler as usual
+            uint8_t dct_scale_denom(Stream* str, GfxImageColorMap* color_map,
+                                    int width, int height,
+                                    double page_width, double page_height)
+            {
+                intmax_t dpi = pdftoedn::options.max_jpeg_dpi();
+
+                if (dpi < 1 || str->getKind() != strDCT || color_map->getBits() != 8) {
+                    return 1;
+                }
+
+                // only spaces whose samples are written as-is so
+                // libjpeg's output matches what encode_image() would
+                // produce from poppler's, just with fewer pixels
+                switch (color_map->getColorSpace()->getMode())
+                {
+                  case csDeviceGray:
+                  case csCalGray:
+                  case csDeviceRGB:
+                  case csCalRGB:
+                  case csICCBased:
+                      break;
+                  default:
+                      return 1;
+                }
+
+                int num_pix_comps = color_map->getNumPixelComps();
+                if (num_pix_comps != 1 && num_pix_comps != 3) {
+                    return 1;
+                }
+
+                // libjpeg's samples are written as-is so a /Decode
+                // array (or a non-default ICC range) that maps them
+                // differently is left to poppler
+                for (int i = 0; i < num_pix_comps; ++i) {
+                    if (color_map->getDecodeLow(i) != 0.0 || color_map->getDecodeHigh(i) != 1.0) {
+                        return 1;
+                    }
+                }
+
+                // a ColorTransform entry overrides the markers libjpeg
+                // goes by - leave those to poppler
+                Dict* dict = str->getDict();
+                if (dict) {
+                    Object parms, dp;
+                    bool has_parms = (!dict->lookup("DecodeParms", &parms)->isNull() ||
+                                      !dict->lookup("DP", &dp)->isNull());
+                    parms.free();
+                    dp.free();
+
+                    if (has_parms) {
+                        return 1;
+                    }
+                }
+
+                double min_width = page_width * dpi / 72.0;
+                double min_height = page_height * dpi / 72.0;
+                uint8_t denom = 1;
+
+                for (int d = 2; d <= 8; d *= 2) {
+                    // libjpeg rounds the scaled dimensions up
+                    if ((width + d - 1) / d < min_width ||
+                        (height + d - 1) / d < min_height) {
+                        break;
+                    }
+                    denom = d;
+                }
+                return denom;
+            }
+
+            //
+            // runs libjpeg over the JPEG data into RGB pixels. Kept
+            // apart from encode_dct_image() so an error longjmps back
+            // here without skipping any C++ destructors - nothing
+            // with one is created in this frame. Returns false with
+            // the message in jerr.msg if libjpeg fails. pixels is
+            // left empty if the data isn't what the image dictionary
+            // describes
+            static bool read_dct_pixels(jpeg_decompress_struct& cinfo, JpegErrorMgr& jerr,
+                                        std::vector<uint8_t>& jpeg_data,
+                                        uint8_t num_pix_comps, uint8_t scale_denom,
+                                        int width, int height,
+                                        std::vector<JSAMPLE>& line, std::vector<uint8_t>& pixels)
+            {
+                if (setjmp(jerr.setjmp_buf)) {
+                    return false;
+                }
+
+                jpeg_create_decompress(&cinfo);
+                jpeg_mem_src(&cinfo, &jpeg_data[0], jpeg_data.size());
+                jpeg_read_header(&cinfo, TRUE);
+
+                cinfo.out_color_space = (num_pix_comps == 1 ? JCS_GRAYSCALE : JCS_RGB);
+                cinfo.scale_num = 1;
+                cinfo.scale_denom = scale_denom;
+                jpeg_calc_output_dimensions(&cinfo);
+
+                uint32_t out_width = cinfo.output_width;
+                uint32_t out_height = cinfo.output_height;
+
+                // the data must be what the image dictionary
+                // describes (CMYK JPEGs in an RGB space, etc. are
+                // left to poppler) and the scaled pixels must fit
+                // in the reduction buffer
+                if (cinfo.num_components != num_pix_comps ||
+                    static_cast<int>(cinfo.image_width) != width ||
+                    static_cast<int>(cinfo.image_height) != height ||
+                    !fits_reduction_buffer(out_width, out_height, 3)) {
+                    return true;
+                }
+
+                jpeg_start_decompress(&cinfo);
+
+                // gray samples are expanded to RGB so
+                // write_reduced_png() can handle both
+                pixels.resize(static_cast<size_t>(out_width) * out_height * 3);
+                line.resize(out_width * num_pix_comps);
+                JSAMPROW row = &line[0];
+
+                while (cinfo.output_scanline < out_height)
+                {
+                    uint8_t* p = &pixels[static_cast<size_t>(cinfo.output_scanline) * out_width * 3];
+
+                    if (jpeg_read_scanlines(&cinfo, &row, 1) != 1) {
+                        snprintf(jerr.msg, sizeof(jerr.msg), "short read of scanlines");
+                        return false;
+                    }
+
+                    if (num_pix_comps == 3) {
+                        std::copy(line.begin(), line.end(), p);
+                    } else {
+                        for (uint32_t x = 0; x < out_width; ++x) {
+                            *p++ = line[x];
+                            *p++ = line[x];
+                            *p++ = line[x];
+                        }
+                    }
+                }
+
+                jpeg_finish_decompress(&cinfo);
+                return true;
+            }
+
+            //
+            // decode the DCT stream's data with libjpeg at 1 /
+            // scale_denom of its size and export it as a PNG. width &
+            // height are set to the scaled dimensions. Returns false
+            // if the image should be decoded by poppler instead
+            bool encode_dct_image(std::ostream& output, Stream* str, uint8_t num_pix_comps,
+                                  uint8_t scale_denom, int& width, int& height)
+            {
+                std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+                // the filter's source stream has any preceding
+                // filters (and decryption) applied so it returns the
+                // JPEG file data
+                std::vector<uint8_t> jpeg_data;
+                Stream* dct_src = str->getNextStream();
+                int c;
+
+                dct_src->reset();
+                while ((c = dct_src->getChar()) != EOF) {
+                    jpeg_data.push_back(static_cast<uint8_t>(c));
+                }
+                dct_src->close();
+
+                if (jpeg_data.empty()) {
+                    return false;
+                }
+
+                // zeroed so it can be destroyed even if creating it fails
+                jpeg_decompress_struct cinfo = jpeg_decompress_struct();
+                JpegErrorMgr jerr;
+                cinfo.err = jpeg_std_error(&jerr.pub);
+                jerr.pub.error_exit = jpeg_error_exit;
+                jerr.pub.output_message = jpeg_output_message;
+
+                std::vector<JSAMPLE> line;
+                std::vector<uint8_t> pixels;
+                bool decoded = read_dct_pixels(cinfo, jerr, jpeg_data, num_pix_comps, scale_denom,
+                                               width, height, line, pixels);
+                uint32_t out_width = cinfo.output_width;
+                uint32_t out_height = cinfo.output_height;
+                jpeg_destroy_decompress(&cinfo);
+
+                if (!decoded) {
+                    et.log_warn( ErrorTracker::ERROR_UT_IMAGE_ENCODE, MODULE, jerr.msg );
+                    return false;
+                }
+
+                // not something we can decode here
+                if (pixels.empty()) {
+                    return false;
+                }
+
+                png_structp png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING,
+                                                              NULL,
+                                                              user_error_fn,
+                                                              user_warning_fn);
+                if (!png_ptr) {
+                    return false;
+                }
+
+                png_infop info_ptr = png_create_info_struct(png_ptr);
+                if (!info_ptr) {
+                    png_destroy_write_struct(&png_ptr, reinterpret_cast<png_infopp>(NULL));
+                    return false;
+                }
+
+                png_set_write_fn(png_ptr,
+                                 reinterpret_cast<png_voidp *>(&output),
+                                 user_io_write,
+                                 user_io_flush);
+
+                std::streamoff start_pos = output.tellp();
+                bool status = true;
+                try
+                {
+                    int png_type = write_reduced_png(png_ptr, info_ptr, out_width, out_height, pixels, 3);
+
+                    std::streamoff end_pos = output.tellp();
+                    record_encode_stats(png_type, pixels.size(), png_get_rowbytes(png_ptr, info_ptr) * out_height,
+                                        ((start_pos >= 0 && end_pos >= 0) ? end_pos - start_pos : 0),
+                                        start);
+
+                    stats.add( "dct_scaled", "images" );
+                    stats.add( "dct_scaled", "pixels_skipped",
+                               static_cast<uintmax_t>(width) * height - static_cast<uintmax_t>(out_width) * out_height );
+
+                    width = out_width;
+                    height = out_height;
+                }
+                catch (libpng_error& e) {
+                    et.log_critical( ErrorTracker::ERROR_PNG_ERROR, MODULE, e.what() );
+                    status = false;
+                }
+
+                png_destroy_write_struct(&png_ptr, &info_ptr);
+                return status;
+            }
+#endif
+
+
             //
             // export the data as a PNG RGBA onto an ostream - based on:
             //
@@ -358,18 +957,17 @@ namespace pdftoedn
                                    GfxImageColorMap *color_map, GfxImageColorMap *mask_color_map,
                                    bool mask_invert)
             {
-                // Set the image information here
+                // Set the image information here. Gray samples are
+                // expanded so rows are always 8-bit RGBA - the
+                // reduction writes gray + alpha when it applies
                 GfxColorSpaceMode cspace_mode = color_map->getColorSpace()->getMode();
-                int png_type;
+                int png_type = PNG_COLOR_TYPE_RGB_ALPHA;
 
                 switch (cspace_mode) {
                   case csDeviceRGB:
                   case csICCBased:
                   case csIndexed:
-                      png_type = PNG_COLOR_TYPE_RGB_ALPHA;
-                      break;
                   case csDeviceGray:
-                      png_type = PNG_COLOR_TYPE_GRAY_ALPHA;
                       break;
                   default:
                       std::stringstream err;
@@ -406,7 +1004,6 @@ namespace pdftoedn
                 uintmax_t width = properties.bitmap_width();
                 uintmax_t height = properties.bitmap_height();
                 uint8_t num_pix_comps = properties.bitmap_num_pixel_comps();
-                uint8_t bpp = properties.bitmap_bpp();
                 uintmax_t mask_width = properties.mask_width();
                 uintmax_t mask_height = properties.mask_height();
                 uint8_t mask_num_pix_comps = properties.mask_num_pixel_comps();
@@ -416,25 +1013,31 @@ namespace pdftoedn
                 uint8_t* mask_buf = NULL;
                 bool status = true;
 
+                // buffer the RGBA rows so the output type can be
+                // reduced (e.g., alpha dropped if fully opaque)
+                std::vector<uint8_t> pixels;
+                bool reduce = fits_reduction_buffer(width, height, 4);
+                std::streamoff start_pos = output.tellp();
+                std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
                 try
                 {
-                    png_set_IHDR(png_ptr, info_ptr, width, height, bpp,
-                                 png_type,
-                                 PNG_INTERLACE_NONE,
-                                 PNG_COMPRESSION_TYPE_BASE, PNG_FILTER_TYPE_BASE);
-
-                    if (pdftoedn::options.libpng_use_best_compression()) {
-                        png_set_compression_level(png_ptr, Z_BEST_COMPRESSION);
+                    if (reduce) {
+                        pixels.reserve(width * height * 4);
                     }
+                    else {
+                        png_set_IHDR(png_ptr, info_ptr, width, height, 8,
+                                     png_type,
+                                     PNG_INTERLACE_NONE,
+                                     PNG_COMPRESSION_TYPE_BASE, PNG_FILTER_TYPE_BASE);
+
+                        if (pdftoedn::options.libpng_use_best_compression()) {
+                            png_set_compression_level(png_ptr, Z_BEST_COMPRESSION);
+                        }
 
-                    // Write the file header information.
-                    png_write_info(png_ptr, info_ptr);
-
-                    // pack pixels into bytes
-                    png_set_packing(png_ptr);
-
-                    // swap bits of 1, 2, 4 bit packed pixel formats
-                    png_set_packswap(png_ptr);
+                        // Write the file header information.
+                        png_write_info(png_ptr, info_ptr);
+                    }
 
                     // ready to copy image data - combine the image data
                     // (RGB if 3 bpp, Grey if 1) with mask data
@@ -502,10 +1105,21 @@ namespace pdftoedn
                             // and set alpha to the mask value
                             data_row[x++] = mask_buf[mx++];
                         }
-                        png_write_rows(png_ptr, &data_row, 1);
+                        write_image_row(png_ptr, data_row, o_num_pix_comps * width,
+                                        (reduce ? &pixels : NULL));
                     }
 
-                    png_write_end(png_ptr, info_ptr);
+                    uintmax_t sample_bytes_in = width * height * o_num_pix_comps;
+                    if (reduce) {
+                        png_type = write_reduced_png(png_ptr, info_ptr, width, height, pixels, o_num_pix_comps);
+                    } else {
+                        png_write_end(png_ptr, info_ptr);
+                    }
+
+                    std::streamoff end_pos = output.tellp();
+                    record_encode_stats(png_type, sample_bytes_in, png_get_rowbytes(png_ptr, info_ptr) * height,
+                                        ((start_pos >= 0 && end_pos >= 0) ? end_pos - start_pos : 0),
+                                        start);
                 }
                 catch (libpng_error& e) {
                     et.log_critical( ErrorTracker::ERROR_PNG_ERROR, MODULE, e.what() );
@@ -590,9 +1204,10 @@ namespace pdftoedn
                         throw std::runtime_error(err.str());
                     }
 
-                    palette[0].red   = properties.mask_fill_color().red();
-                    palette[0].green = properties.mask_fill_color().green();
-                    palette[0].blue  = properties.mask_fill_color().blue();
+                    // stencil pixels are black; the fill color is
+                    // output with the image reference so the same
+                    // blob serves every color the mask is drawn in
+                    palette[0].red   = palette[0].green = palette[0].blue = 0x00;
 
                     // by default set the 2nd color to white.. leptonica
                     // does not preserve transparency so this should make
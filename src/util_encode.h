@@ -16,6 +16,15 @@ namespace pdftoedn
                                    GfxImageColorMap *color_map, GfxImageColorMap *mask_color_map,
                                    bool mask_invert);
             bool encode_mask(std::ostream& output, ImageStream* img_str, const StreamProps& properties);
+#ifdef HAVE_LIBJPEG
+            // DCTDecode images decoded at a reduced scale by libjpeg
+            // (see --max_jpeg_dpi)
+            uint8_t dct_scale_denom(Stream* str, GfxImageColorMap* color_map,
+                                    int width, int height,
+                                    double page_width, double page_height);
+            bool encode_dct_image(std::ostream& output, Stream* str, uint8_t num_pix_comps,
+                                  uint8_t scale_denom, int& width, int& height);
+#endif
 #if 0
             bool encode_grey_image(std::ostream& output, ImageStream* img_str, const StreamProps& properties,
                                    GfxImageColorMap *colorMap);
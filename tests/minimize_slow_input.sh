@@ -0,0 +1,34 @@
+#!/bin/sh
+#
+# shrink an input that makes the fuzz harness exceed the time budget
+# and add it to the regression corpus checked by
+# test_corpus_time_budget.sh
+#
+# usage: minimize_slow_input.sh <pdftoedn_fuzzer> <slow input> <corpus name> [timeout s] [runs]
+#
+
+if [ $# -lt 3 ]; then
+    echo "usage: $0 <pdftoedn_fuzzer> <slow input> <corpus name> [timeout s] [runs]"
+    exit 1
+fi
+
+FUZZER="$1"
+INPUT="$2"
+NAME="$3"
+TIMEOUT=${4:-10}
+RUNS=${5:-2000}
+
+CORPUS_DIR=`dirname $0`/corpus
+OUTPUT="$CORPUS_DIR/${NAME%.pdf}.pdf"
+
+if [ -f "$OUTPUT" ]; then
+    echo "$OUTPUT already exists"
+    exit 1
+fi
+
+# libFuzzer treats timeouts as crashes, so -minimize_crash keeps
+# removing bytes for as long as the result is still slow
+"$FUZZER" -minimize_crash=1 -timeout=$TIMEOUT -runs=$RUNS \
+          -exact_artifact_path="$OUTPUT" "$INPUT" || exit $?
+
+ls -l "$OUTPUT"
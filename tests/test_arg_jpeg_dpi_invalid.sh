@@ -0,0 +1,30 @@
+#!/bin/sh
+
+[ "x${TESTS_DIR}" = "x" ] && TESTS_DIR="."
+. ${TESTS_DIR}/test_common.sh
+
+EXPECTED_SUBSTR="Invalid JPEG resolution"
+NOT_BUILT_SUBSTR="built without libjpeg"
+
+# automake's exit code for skipped tests
+readonly CODE_SKIP=77
+
+test_start
+
+# a resolution must be positive
+run_cmd "$PDFTOEDN --max_jpeg_dpi 0 -o "$TMPFILE" "$TESTDOC""
+status=$?
+
+test_end
+
+if check_stdout "$NOT_BUILT_SUBSTR"; then
+    echo "Scaled JPEG decoding not available - skipping"
+    exit $CODE_SKIP
+fi
+
+flag_set $status $CODE_INIT_ERROR && \
+    check_stdout "$EXPECTED_SUBSTR" && \
+    exit 0
+
+echo "unexpected return value $status"
+exit $status
@@ -0,0 +1,21 @@
+#!/bin/sh
+
+[ "x${TESTS_DIR}" = "x" ] && TESTS_DIR="."
+. ${TESTS_DIR}/test_common.sh
+
+EXPECTED_SUBSTR="progress file descriptor 9 is not open"
+
+test_start
+
+# descriptor 9 is not open in the test shell
+run_cmd "$PDFTOEDN -f --progress_fd 9 -o $TMPFILE $TESTDOC"
+status=$?
+
+test_end
+
+flag_set $status $CODE_INIT_ERROR && \
+    check_stdout "$EXPECTED_SUBSTR" && \
+    exit 0
+
+echo "unexpected return value $status"
+exit 1
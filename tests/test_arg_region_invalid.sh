@@ -0,0 +1,28 @@
+#!/bin/sh
+
+[ "x${TESTS_DIR}" = "x" ] && TESTS_DIR="."
+. ${TESTS_DIR}/test_common.sh
+
+EXPECTED_SUBSTR="invalid region"
+
+test_start
+
+# missing values, trailing characters, negative pages and empty
+# rectangles are rejected
+status=0
+for REGION in "10,10,50" "10,10,50,50x" "a:10,10,50,50" "-1:10,10,50,50" "0:10,10,0,50" "10,10,50,-5"
+do
+    run_cmd "$PDFTOEDN -f --region=$REGION -o $TMPFILE $TESTDOC"
+    status=$?
+
+    if ! flag_set $status $CODE_INIT_ERROR || ! check_stdout "$EXPECTED_SUBSTR"; then
+        echo " -> region $REGION was not rejected"
+        status=1
+        break
+    fi
+    status=0
+done
+
+test_end
+
+exit $status
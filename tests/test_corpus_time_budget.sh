@@ -0,0 +1,80 @@
+#!/bin/bash
+
+[ "x${TESTS_DIR}" = "x" ] && TESTS_DIR="."
+. ${TESTS_DIR}/test_common.sh
+
+# inputs that once took too long to process. Each must finish within
+# the budget (in seconds) regardless of its exit status
+CORPUS_DIR=${TESTS_DIR}/corpus
+[ "x${CORPUS_TIME_BUDGET}" = "x" ] && CORPUS_TIME_BUDGET=30
+
+# a page with a single 20000-segment stroked path. Generated rather
+# than kept in the corpus because of its size
+HUGE_PATH_DOC=huge_path.tmp
+
+gen_huge_path () {
+    LC_ALL=C awk 'BEGIN {
+        content = "10 10 m\n"
+        for (i = 0; i < 20000; i++) {
+            a = i * 0.01
+            r = i * 0.0075
+            content = content sprintf("%.2f %.2f l\n", 306 + r * cos(a), 396 + r * sin(a))
+        }
+        content = content "S"
+
+        obj[1] = "<< /Type /Catalog /Pages 2 0 R >>"
+        obj[2] = "<< /Type /Pages /Kids [3 0 R] /Count 1 >>"
+        obj[3] = "<< /Type /Page /Parent 2 0 R /MediaBox [0 0 612 792] /Contents 4 0 R >>"
+        obj[4] = "<< /Length " length(content) " >>\nstream\n" content "\nendstream"
+
+        # print the objects as they are laid out to get their offsets
+        pos = 0
+        print "%PDF-1.4"
+        pos += 9
+        for (i = 1; i <= 4; i++) {
+            off[i] = pos
+            body = i " 0 obj\n" obj[i] "\nendobj"
+            print body
+            pos += length(body) + 1
+        }
+        print "xref\n0 5\n0000000000 65535 f "
+        for (i = 1; i <= 4; i++) {
+            printf "%010d 00000 n \n", off[i]
+        }
+        print "trailer\n<< /Size 5 /Root 1 0 R >>\nstartxref\n" pos "\n%%EOF"
+    }'
+}
+
+test_start
+
+gen_huge_path > $HUGE_PATH_DOC
+
+failed=0
+for doc in "$CORPUS_DIR"/*.pdf $HUGE_PATH_DOC; do
+    [ -f "$doc" ] || continue
+
+    start=$(date +%s)
+    timeout $((CORPUS_TIME_BUDGET + 1)) $PDFTOEDN -f -o "$TMPFILE" "$doc" > $STDOUTFILE
+    status=$?
+    elapsed=$(($(date +%s) - start))
+
+    echo "$(basename "$doc"): ${elapsed}s (exit $status)"
+
+    # 124 is timeout's exit code
+    if [ $status -eq 124 ] || [ $elapsed -gt $CORPUS_TIME_BUDGET ]; then
+        echo "  over the ${CORPUS_TIME_BUDGET}s budget"
+        failed=1
+    fi
+
+    # exit codes above the error flags are signals (crashes)
+    if [ $status -gt $((CODE_INIT_ERROR)) ]; then
+        echo "  terminated abnormally"
+        failed=1
+    fi
+done
+
+test_end
+$RM $HUGE_PATH_DOC
+[ -d "${TMPFILE%.*}" ] && $RM -r "${TMPFILE%.*}"
+
+exit $failed
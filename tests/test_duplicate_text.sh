@@ -0,0 +1,41 @@
+#!/bin/sh
+
+[ "x${TESTS_DIR}" = "x" ] && TESTS_DIR="."
+. ${TESTS_DIR}/test_common.sh
+
+# "Bold" drawn twice 0.5pt apart, "Edge" drawn twice 0.8pt apart on
+# either side of a hash cell boundary, and "Apart" drawn twice 1.5pt
+# apart (over the 1pt tolerance)
+DUPDOC=${TESTS_DIR}/corpus/duplicate_text.pdf
+
+# checks the number of "Bold", "Edge", "Apart" spans and of spans
+# marked as duplicates
+check_output () {
+    local args="$1"
+    local expected="$2"
+
+    run_cmd "$PDFTOEDN -f $args -o $TMPFILE $DUPDOC" > /dev/null || return 1
+
+    local found=""
+    for PATTERN in ':text "Bold"' ':text "Edge"' ':text "Apart"' ':duplicate true'
+    do
+        found="${found}`grep -o "$PATTERN" $TMPFILE | wc -l | tr -d ' '`"
+    done
+
+    if [ "$found" != "$expected" ]; then
+        echo " -> '$args' output has $found, expected $expected (Bold, Edge, Apart, duplicates)"
+        return 1
+    fi
+    return 0
+}
+
+test_start
+
+# the overprinted runs are dropped or, if requested, kept and marked
+check_output "" 1120 && \
+    check_output "--mark_duplicate_text" 2222
+status=$?
+
+test_end
+
+exit $status
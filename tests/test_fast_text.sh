@@ -0,0 +1,55 @@
+#!/bin/sh
+
+[ "x${TESTS_DIR}" = "x" ] && TESTS_DIR="."
+. ${TESTS_DIR}/test_common.sh
+
+TYPE3DOC=${TESTS_DIR}/corpus/type3_repeated_glyphs.pdf
+
+test_start
+
+# the text interpreter's output must match what poppler's produces
+# in text-only mode
+status=0
+for SRCPDF in "${TESTS_DIR}/docs"/*.pdf
+do
+    ARGS="-f"
+
+    # encrypted test - "enc_test.pdf" is the password
+    if [ "${SRCPDF#*enc_test.pdf}" != "$SRCPDF" ]; then
+        ARGS="$ARGS -u enc_test.pdf"
+    fi
+
+    run_cmd "$PDFTOEDN $ARGS -T -o $TMPFILE $SRCPDF"
+    status=$?
+    [ $status -ne 0 ] && break
+    filter_meta "$TMPFILE" t1.tmp
+
+    run_cmd "$PDFTOEDN $ARGS --fast_text -o $TMPFILE $SRCPDF"
+    status=$?
+    [ $status -ne 0 ] && break
+    filter_meta "$TMPFILE" t2.tmp
+
+    $DIFF t1.tmp t2.tmp > /dev/null
+    status=$?
+    $RM t1.tmp t2.tmp
+
+    if [ $status -ne 0 ]; then
+        echo " -> --fast_text output of $SRCPDF did not match -T output"
+        break
+    fi
+done
+
+# Type3 fonts are left to poppler
+if [ $status -eq 0 ]; then
+    run_cmd "$PDFTOEDN -f --fast_text -o $TMPFILE $TYPE3DOC"
+    status=$?
+
+    if [ $status -eq 0 ] && ! grep -q ':text "abab' $TMPFILE; then
+        echo " -> Type3 text missing after falling back"
+        status=1
+    fi
+fi
+
+test_end
+
+exit $status
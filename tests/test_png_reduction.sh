@@ -0,0 +1,78 @@
+#!/bin/sh
+
+[ "x${TESTS_DIR}" = "x" ] && TESTS_DIR="."
+. ${TESTS_DIR}/test_common.sh
+
+# a 4x2 DeviceGray image with a DeviceGray soft mask
+SMASKDOC=${TESTS_DIR}/corpus/soft_masked_gray.pdf
+IMG_DIR=file
+IMG_FILE=$IMG_DIR/file-5.png
+
+# automake's exit code for skipped tests
+readonly CODE_SKIP=77
+
+if [ ! -x "`which python3`" ]; then
+    echo "python3 is needed to decode the PNG - skipping"
+    exit $CODE_SKIP
+fi
+
+test_start
+
+$RM -r $IMG_DIR
+run_cmd "$PDFTOEDN -f -o $TMPFILE $SMASKDOC"
+status=$?
+
+# the RGBA rows must be reduced to 8-bit gray + alpha without
+# changing any of the samples
+python3 - "$IMG_FILE" <<'PY'
+import struct, sys, zlib
+
+data = open(sys.argv[1], "rb").read()
+pos, idat, ihdr = 8, b"", None
+while pos < len(data):
+    length, kind = struct.unpack(">I4s", data[pos:pos + 8])
+    body = data[pos + 8:pos + 8 + length]
+    if kind == b"IHDR":
+        ihdr = struct.unpack(">IIBB", body[:10])
+    elif kind == b"IDAT":
+        idat += body
+    pos += 12 + length
+
+width, height, depth, color_type = ihdr
+if (depth, color_type) != (8, 4):
+    sys.exit("expected 8-bit gray + alpha, got depth %d type %d" % (depth, color_type))
+
+# undo the row filters
+raw, bpp, stride = zlib.decompress(idat), 2, width * 2
+rows, prev = [], bytearray(stride)
+for y in range(height):
+    ftype, row = raw[y * (stride + 1)], bytearray(raw[y * (stride + 1) + 1:(y + 1) * (stride + 1)])
+    for i in range(stride):
+        a = row[i - bpp] if i >= bpp else 0
+        b = prev[i]
+        c = prev[i - bpp] if i >= bpp else 0
+        if ftype == 1:   row[i] = (row[i] + a) & 0xff
+        elif ftype == 2: row[i] = (row[i] + b) & 0xff
+        elif ftype == 3: row[i] = (row[i] + (a + b) // 2) & 0xff
+        elif ftype == 4:
+            p = a + b - c
+            pa, pb, pc = abs(p - a), abs(p - b), abs(p - c)
+            row[i] = (row[i] + (a if pa <= pb and pa <= pc else (b if pb <= pc else c))) & 0xff
+    rows.append(row)
+    prev = row
+
+gray = [0x00, 0x40, 0x80, 0xff, 0x10, 0x20, 0xc0, 0x80]
+alpha = [0xff, 0x80, 0x40, 0x00, 0xff, 0xff, 0x10, 0x20]
+expected = [v for px in zip(gray, alpha) for v in px]
+if [v for row in rows for v in row] != expected:
+    sys.exit("decoded samples don't match the source image")
+PY
+output_ok=$?
+
+$RM -r $IMG_DIR
+test_end
+
+[ $status -eq $CODE_RUNTIME_OK ] && [ $output_ok -eq 0 ] && exit 0
+
+echo "unexpected return value $status or soft-masked gray image not reduced losslessly"
+exit 1
@@ -0,0 +1,34 @@
+#!/bin/sh
+
+[ "x${TESTS_DIR}" = "x" ] && TESTS_DIR="."
+. ${TESTS_DIR}/test_common.sh
+
+test_start
+
+# no profile unless requested
+run_cmd "$PDFTOEDN -f -p 1 -o $TMPFILE $TESTDOC"
+status=$?
+unrequested=`grep -c ':op_profile' $TMPFILE`
+
+# one entry per processed page, with the text object operators
+# counted, and the document summary
+profile_ok=0
+if [ $status -eq 0 ]; then
+    run_cmd "$PDFTOEDN -f -p 1 -n 2 --profile_ops -o $TMPFILE $TESTDOC"
+    status=$?
+
+    if grep -q ':op_profile {:pages \[{:pgnum 2, :ops {' $TMPFILE && \
+           grep -q '{:pgnum 3, :ops {' $TMPFILE && \
+           grep -q '"BT" {:count [1-9]' $TMPFILE && \
+           grep -q ':top \[{:op "' $TMPFILE && \
+           ! grep -q '{:pgnum 4, :ops {' $TMPFILE; then
+        profile_ok=1
+    fi
+fi
+
+test_end
+
+[ $status -eq $CODE_RUNTIME_OK ] && [ $unrequested -eq 0 ] && [ $profile_ok -eq 1 ] && exit 0
+
+echo "unexpected return value $status or operator profile"
+exit 1
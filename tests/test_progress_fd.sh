@@ -0,0 +1,30 @@
+#!/bin/sh
+
+[ "x${TESTS_DIR}" = "x" ] && TESTS_DIR="."
+. ${TESTS_DIR}/test_common.sh
+
+PROGRESSFILE=progress.tmp
+
+test_start
+
+# one line per page of the slice (0-indexed pages 2 to 4), numbered
+# as in the document
+echo "$PDFTOEDN -f -p 2 -n 3 --progress_fd 3 -o $TMPFILE $TESTDOC 3> $PROGRESSFILE"
+$PDFTOEDN -f -p 2 -n 3 --progress_fd 3 -o $TMPFILE $TESTDOC 3> $PROGRESSFILE > $STDOUTFILE
+status=$?
+cat $PROGRESSFILE
+
+lines_ok=0
+if [ `wc -l < $PROGRESSFILE` -eq 3 ] && \
+       head -n 1 $PROGRESSFILE | grep -q '^{"page":3,"done":1,"total":3,"elapsed_ms":[0-9.]*,"images":0,"bytes":[0-9]*,"eta_ms":[0-9.]*}$' && \
+       tail -n 1 $PROGRESSFILE | grep -q '^{"page":5,"done":3,"total":3,.*"eta_ms":0.0}$'; then
+    lines_ok=1
+fi
+
+test_end
+$RM $PROGRESSFILE
+
+[ $status -eq $CODE_RUNTIME_OK ] && [ $lines_ok -eq 1 ] && exit 0
+
+echo "unexpected return value $status or progress lines"
+exit 1
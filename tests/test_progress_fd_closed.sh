@@ -0,0 +1,27 @@
+#!/bin/sh
+
+[ "x${TESTS_DIR}" = "x" ] && TESTS_DIR="."
+. ${TESTS_DIR}/test_common.sh
+
+STATUSFILE=status.tmp
+
+test_start
+
+# the progress reader goes away after the first byte - the run must
+# still finish and write the whole document
+echo "$PDFTOEDN -f --progress_fd 3 -o $TMPFILE $TESTDOC 3>&1 | head -c 1"
+( $PDFTOEDN -f --progress_fd 3 -o $TMPFILE $TESTDOC 3>&1 > $STDOUTFILE; echo $? > $STATUSFILE ) | head -c 1 > /dev/null
+status=`cat $STATUSFILE`
+
+output_ok=0
+if [ -s $TMPFILE ] && tail -c 2 $TMPFILE | grep -q '}'; then
+    output_ok=1
+fi
+
+test_end
+$RM $STATUSFILE
+
+[ "$status" = "$CODE_RUNTIME_OK" ] && [ $output_ok -eq 1 ] && exit 0
+
+echo "unexpected return value $status or incomplete output"
+exit 1
@@ -0,0 +1,25 @@
+#!/bin/sh
+
+[ "x${TESTS_DIR}" = "x" ] && TESTS_DIR="."
+. ${TESTS_DIR}/test_common.sh
+
+REGIONDOC=${TESTS_DIR}/docs/scimakelatex-23822.pdf
+
+test_start
+
+# a region around the first word of the title on the first page. The
+# rest of the page, including the next word on the same line, and the
+# other pages (region for page 0 only) have no text
+run_cmd "$PDFTOEDN -f -r 0:90,40,120,45 -o $TMPFILE $REGIONDOC"
+status=$?
+
+spans=`grep -o ':type :span' $TMPFILE | wc -l`
+title_ok=0
+grep -q ':text "Decoupling"' $TMPFILE && title_ok=1
+
+test_end
+
+[ $status -eq $CODE_RUNTIME_OK ] && [ $spans -eq 1 ] && [ $title_ok -eq 1 ] && exit 0
+
+echo "unexpected return value $status or text spans ($spans)"
+exit 1
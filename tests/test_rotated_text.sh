@@ -0,0 +1,43 @@
+#!/bin/sh
+
+[ "x${TESTS_DIR}" = "x" ] && TESTS_DIR="."
+. ${TESTS_DIR}/test_common.sh
+
+# one word drawn at each of 30, 45, 90, 180 and 270 degrees
+ROTDOC=${TESTS_DIR}/corpus/rotated_text.pdf
+
+test_start
+
+run_cmd "$PDFTOEDN -f -o $TMPFILE $ROTDOC" > /dev/null
+status=$?
+
+# each word must come out as a single span
+spans_ok=1
+for WORD in Thirty FortyFive Ninety OneEighty TwoSeventy
+do
+    if [ `grep -o ":text \"$WORD\"" $TMPFILE | wc -l` -ne 1 ]; then
+        echo " -> \"$WORD\" was not output as a single span"
+        spans_ok=0
+    fi
+done
+
+# the rotated ones (180 degrees is output as flipped text) carry
+# offsets along the baseline that start at 0 and grow in reading
+# direction
+offsets_ok=0
+if [ `grep -o ':baseline_offsets \[[^]]*\]' $TMPFILE | \
+          awk '{
+                   gsub(/[^0-9. -]/, "");
+                   if ($1 != 0) next;
+                   for (i = 2; i <= NF; i++) if ($i <= $(i - 1)) next;
+                   print
+               }' | wc -l` -eq 4 ]; then
+    offsets_ok=1
+fi
+
+test_end
+
+[ $status -eq $CODE_RUNTIME_OK ] && [ $spans_ok -eq 1 ] && [ $offsets_ok -eq 1 ] && exit 0
+
+echo "unexpected return value $status or rotated spans"
+exit 1
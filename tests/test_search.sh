@@ -0,0 +1,39 @@
+#!/bin/sh
+
+[ "x${TESTS_DIR}" = "x" ] && TESTS_DIR="."
+. ${TESTS_DIR}/test_common.sh
+
+SEARCHDOC=${TESTS_DIR}/docs/scimakelatex-23822.pdf
+
+test_start
+
+# the title is drawn a word at a time and wraps after
+# "Hierarchical". Trailing whitespace in a term is ignored
+echo "$PDFTOEDN -f -o $TMPFILE -S ... $SEARCHDOC"
+$PDFTOEDN -f -o $TMPFILE \
+          -S "Decoupling Semaphores" \
+          -S "Hierarchical Databases" \
+          -S "Semaphores  " \
+          -S "/Sema[a-z]+s/" \
+          $SEARCHDOC > $STDOUTFILE
+status=$?
+cat $STDOUTFILE
+
+found=1
+for MATCH in ':term "Decoupling Semaphores", :text "Decoupling Semaphores"' \
+             ':term "Hierarchical Databases", :text "Hierarchical Databases"' \
+             ':term "Semaphores  ", :text "Semaphores"' \
+             ':term "/Sema[a-z]+s/", :text "Semaphores"'
+do
+    if ! grep -q -F "$MATCH" $TMPFILE; then
+        echo " -> missing match $MATCH"
+        found=0
+    fi
+done
+
+test_end
+
+[ $status -eq $CODE_RUNTIME_OK ] && [ $found -eq 1 ] && exit 0
+
+echo "unexpected return value $status or search matches"
+exit 1
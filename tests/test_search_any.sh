@@ -0,0 +1,26 @@
+#!/bin/sh
+
+[ "x${TESTS_DIR}" = "x" ] && TESTS_DIR="."
+. ${TESTS_DIR}/test_common.sh
+
+SEARCHDOC=${TESTS_DIR}/docs/scimakelatex-23822.pdf
+
+test_start
+
+# "the" is found many times but --search_any only reports the first
+run_cmd "$PDFTOEDN -f -S the -o $TMPFILE $SEARCHDOC"
+status=$?
+all_matches=`grep -o ':term "the"' $TMPFILE | wc -l`
+
+if [ $status -eq 0 ]; then
+    run_cmd "$PDFTOEDN -f -S the --search_any -o $TMPFILE $SEARCHDOC"
+    status=$?
+fi
+any_matches=`grep -o ':term "the"' $TMPFILE | wc -l`
+
+test_end
+
+[ $status -eq $CODE_RUNTIME_OK ] && [ $all_matches -gt 1 ] && [ $any_matches -eq 1 ] && exit 0
+
+echo "unexpected return value $status or number of matches ($all_matches, $any_matches)"
+exit 1
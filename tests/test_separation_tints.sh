@@ -0,0 +1,30 @@
+#!/bin/sh
+
+[ "x${TESTS_DIR}" = "x" ] && TESTS_DIR="."
+. ${TESTS_DIR}/test_common.sh
+
+# two Separation spaces named "Spot" with different tint transforms
+# (full tint is red in one, blue in the other), and a third fill in
+# the first space again
+SEPDOC=${TESTS_DIR}/corpus/separation_tints.pdf
+
+test_start
+
+run_cmd "$PDFTOEDN -f -D -o $TMPFILE $SEPDOC"
+status=$?
+
+# each space gets its own color, converted once, and the repeated
+# fills are cache hits
+colors_ok=0
+if grep -q '"#ff0000"' $TMPFILE && \
+       grep -q '"#0000ff"' $TMPFILE && \
+       grep -q ':color_cache {:hits [1-9][0-9]*, :misses 2}' $TMPFILE; then
+    colors_ok=1
+fi
+
+test_end
+
+[ $status -eq $CODE_RUNTIME_OK ] && [ $colors_ok -eq 1 ] && exit 0
+
+echo "unexpected return value $status or separation colors"
+exit 1
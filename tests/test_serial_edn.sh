@@ -0,0 +1,36 @@
+#!/bin/sh
+
+[ "x${TESTS_DIR}" = "x" ] && TESTS_DIR="."
+. ${TESTS_DIR}/test_common.sh
+
+# a page with 4480 filled rectangles, each in its own color, and a
+# line of text - enough to be written on multiple threads
+DENSEDOC=${TESTS_DIR}/corpus/dense_page.pdf
+SERIALFILE=serial.tmp
+
+test_start
+
+# the output must be the same whether the page is written in
+# parallel chunks or serially
+run_cmd "$PDFTOEDN -f -o $TMPFILE $DENSEDOC" > /dev/null
+status=$?
+
+if [ $status -eq $CODE_RUNTIME_OK ]; then
+    run_cmd "$PDFTOEDN -f --serial_edn -o $SERIALFILE $DENSEDOC" > /dev/null
+    status=$?
+fi
+
+same=0
+if [ $status -eq $CODE_RUNTIME_OK ]; then
+    filter_meta $TMPFILE $TMPFILE.filtered
+    filter_meta $SERIALFILE $SERIALFILE.filtered
+    $DIFF $TMPFILE.filtered $SERIALFILE.filtered > /dev/null && same=1
+fi
+
+$RM $SERIALFILE $TMPFILE.filtered $SERIALFILE.filtered
+test_end
+
+[ $status -eq $CODE_RUNTIME_OK ] && [ $same -eq 1 ] && exit 0
+
+echo "unexpected return value $status or parallel output differs from serial output"
+exit 1
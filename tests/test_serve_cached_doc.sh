@@ -0,0 +1,27 @@
+#!/bin/sh
+
+[ "x${TESTS_DIR}" = "x" ] && TESTS_DIR="."
+. ${TESTS_DIR}/test_common.sh
+
+TMPFILE2=file2.tmp
+EXPECTED_SUBSTR=":request 2, :status 0, :cached true"
+
+test_start
+
+# request two page windows of the same document - the second should
+# reuse the open document
+echo "$PDFTOEDN -f --serve"
+printf "%s\t%s\t0\t3\n%s\t%s\t3\t3\n" "$TESTDOC" "$TMPFILE" "$TESTDOC" "$TMPFILE2" | \
+    $PDFTOEDN -f --serve > $STDOUTFILE
+status=$?
+cat $STDOUTFILE
+
+test_end
+[ -f "$TMPFILE2" ] && $RM "$TMPFILE2"
+
+[ $status -eq $CODE_RUNTIME_OK ] && \
+    check_stdout "$EXPECTED_SUBSTR" && \
+    exit 0
+
+echo "unexpected return value $status"
+exit 1
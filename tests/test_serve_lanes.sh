@@ -0,0 +1,38 @@
+#!/bin/sh
+
+[ "x${TESTS_DIR}" = "x" ] && TESTS_DIR="."
+. ${TESTS_DIR}/test_common.sh
+
+TMPFILE2=file2.tmp
+TMPFILE3=file3.tmp
+INTERACTIVE_DOC=${TESTS_DIR}/docs/scimakelatex-23822.pdf
+
+test_start
+
+# a whole document in the (default) bulk lane followed by a single
+# page in the interactive lane. The bulk request should be paused
+# between pages so the interactive one completes first
+echo "$PDFTOEDN -f --serve"
+printf "%s\t%s\n%s\t%s\t0\t\tinteractive\n" "$TESTDOC" "$TMPFILE" "$INTERACTIVE_DOC" "$TMPFILE2" | \
+    $PDFTOEDN -f --serve > $STDOUTFILE
+status=$?
+cat $STDOUTFILE
+
+# the paused request's output must match a regular run
+run_cmd "$PDFTOEDN -f -o $TMPFILE3 $TESTDOC" > /dev/null
+$DIFF -q "$TMPFILE" "$TMPFILE3"
+same_output=$?
+
+bulk_line=`grep -n ":request 1, :status 0, .*:lane :bulk, :preemptions [1-9]" $STDOUTFILE | cut -d: -f1`
+interactive_line=`grep -n ":request 2, :status 0, .*:lane :interactive, :preemptions 0" $STDOUTFILE | cut -d: -f1`
+
+test_end
+$RM "$TMPFILE2" "$TMPFILE3"
+
+[ $status -eq $CODE_RUNTIME_OK ] && [ $same_output -eq 0 ] && \
+    [ -n "$bulk_line" ] && [ -n "$interactive_line" ] && \
+    [ "$interactive_line" -lt "$bulk_line" ] && \
+    exit 0
+
+echo "unexpected return value $status, output, or request order"
+exit 1
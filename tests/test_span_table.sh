@@ -0,0 +1,76 @@
+#!/bin/sh
+
+[ "x${TESTS_DIR}" = "x" ] && TESTS_DIR="."
+. ${TESTS_DIR}/test_common.sh
+
+# page 1 has a red 12pt "Hello" at (72, 700) and "World" below it;
+# page 2 has a 24pt "Second"
+SPANDOC=${TESTS_DIR}/corpus/span_table.pdf
+
+# written next to the output file using its base name
+SPAN_TABLE=file.spans.arrow
+ARROW_MAGIC="ARROW1"
+
+# automake's exit code for skipped tests
+readonly CODE_SKIP=77
+
+if ! python3 -c "import pyarrow" 2>/dev/null; then
+    echo "python3 with pyarrow is needed to read the span table - skipping"
+    exit $CODE_SKIP
+fi
+
+test_start
+
+$RM "$SPAN_TABLE"
+run_cmd "$PDFTOEDN -f --span_table -o $TMPFILE $SPANDOC"
+status=$?
+
+# Arrow IPC files start and end with the magic string
+table_ok=1
+if [ -f "$SPAN_TABLE" ] && \
+       [ "`head -c 6 $SPAN_TABLE`" = "$ARROW_MAGIC" ] && \
+       [ "`tail -c 6 $SPAN_TABLE`" = "$ARROW_MAGIC" ]; then
+
+    # one record batch per page holding that page's spans
+    python3 - "$SPAN_TABLE" <<'PY'
+import sys
+import pyarrow.ipc
+
+reader = pyarrow.ipc.open_file(sys.argv[1])
+if reader.num_record_batches != 2:
+    sys.exit("expected 2 record batches, got %d" % reader.num_record_batches)
+
+pages = [reader.get_batch(i).to_pylist() for i in range(2)]
+texts = [[row["text"] for row in rows] for rows in pages]
+if texts != [["Hello", "World"], ["Second"]]:
+    sys.exit("unexpected span text %r" % texts)
+
+hello, world = pages[0]
+second = pages[1][0]
+if [hello["page"], world["page"], second["page"]] != [1, 1, 2]:
+    sys.exit("unexpected page numbers")
+if (hello["size"], second["size"]) != (12, 24):
+    sys.exit("unexpected font sizes")
+if (hello["color"], world["color"]) != (0xff0000, 0):
+    sys.exit("unexpected colors")
+
+# bounding boxes are in top-down page coordinates
+if abs(hello["x"] - 72) > 0.5 or not (792 - 700 - 13 < hello["y"] < 792 - 700):
+    sys.exit("unexpected position %r, %r" % (hello["x"], hello["y"]))
+if not (20 < hello["width"] < 35 and 0 < hello["height"] <= 24):
+    sys.exit("unexpected size %r x %r" % (hello["width"], hello["height"]))
+if abs(world["y"] - hello["y"] - 100) > 0.01:
+    sys.exit("expected World 100pt below Hello")
+if abs(second["x"] - 100) > 0.5:
+    sys.exit("unexpected position %r" % second["x"])
+PY
+    table_ok=$?
+fi
+
+test_end
+$RM "$SPAN_TABLE"
+
+[ $status -eq $CODE_RUNTIME_OK ] && [ $table_ok -eq 0 ] && exit 0
+
+echo "unexpected return value $status or unexpected span table contents"
+exit 1
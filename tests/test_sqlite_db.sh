@@ -0,0 +1,35 @@
+#!/bin/sh
+
+[ "x${TESTS_DIR}" = "x" ] && TESTS_DIR="."
+. ${TESTS_DIR}/test_common.sh
+
+DBFILE=db.tmp
+NOT_BUILT_SUBSTR="built without sqlite3"
+
+# automake's exit code for skipped tests
+readonly CODE_SKIP=77
+
+test_start
+
+$RM "$DBFILE"
+run_cmd "$PDFTOEDN -f --sqlite_db $DBFILE -o $TMPFILE $TESTDOC"
+status=$?
+
+test_end
+
+if check_stdout "$NOT_BUILT_SUBSTR"; then
+    echo "SQLite output not available - skipping"
+    exit $CODE_SKIP
+fi
+
+# the first page's spans should be in the spatial index
+spans=1
+if [ -x "`which sqlite3`" ] && [ -f "$DBFILE" ]; then
+    spans=`sqlite3 $DBFILE "SELECT COUNT(*) FROM item_bounds b JOIN spans s ON s.id = b.id WHERE s.page = 1"`
+fi
+$RM "$DBFILE"
+
+[ $status -eq $CODE_RUNTIME_OK ] && [ "0$spans" -gt 0 ] && exit 0
+
+echo "unexpected return value $status or no spans in the database"
+exit 1
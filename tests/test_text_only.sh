@@ -0,0 +1,45 @@
+#!/bin/sh
+
+[ "x${TESTS_DIR}" = "x" ] && TESTS_DIR="."
+. ${TESTS_DIR}/test_common.sh
+
+# a filled rectangle, visible text ("Scanned"), and invisible OCR
+# text ("hidden words")
+OCRDOC=${TESTS_DIR}/corpus/ocr_layer.pdf
+
+# checks the output for the path, visible and invisible text:
+# 1 = present, 0 = absent
+check_output () {
+    local args="$1"
+    local expected="$2"
+
+    run_cmd "$PDFTOEDN -f $args -o $TMPFILE $OCRDOC" > /dev/null || return 1
+
+    local found=""
+    for PATTERN in ':type :path' ':text "Scanned"' ':text "hidden'
+    do
+        if grep -q "$PATTERN" $TMPFILE; then
+            found="${found}1"
+        else
+            found="${found}0"
+        fi
+    done
+
+    if [ "$found" != "$expected" ]; then
+        echo " -> '$args' output has $found, expected $expected (path, text, invisible text)"
+        return 1
+    fi
+    return 0
+}
+
+test_start
+
+check_output "" 110 && \
+    check_output "-T" 010 && \
+    check_output "-T -i" 011 && \
+    check_output "--ocr_text_only" 001
+status=$?
+
+test_end
+
+exit $status
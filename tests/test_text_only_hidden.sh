@@ -0,0 +1,44 @@
+#!/bin/sh
+
+[ "x${TESTS_DIR}" = "x" ] && TESTS_DIR="."
+. ${TESTS_DIR}/test_common.sh
+
+# "Covered" is painted over by an opaque white rectangle, "Outside"
+# is drawn outside the current clip, and "Kept" is visible
+COVERDOC=${TESTS_DIR}/corpus/covered_text.pdf
+
+# checks the output for each word: 1 = present, 0 = absent
+check_output () {
+    local args="$1"
+    local expected="$2"
+
+    run_cmd "$PDFTOEDN -f $args -o $TMPFILE $COVERDOC" > /dev/null || return 1
+
+    local found=""
+    for PATTERN in ':text "Covered"' ':text "Outside"' ':text "Kept"'
+    do
+        if grep -q "$PATTERN" $TMPFILE; then
+            found="${found}1"
+        else
+            found="${found}0"
+        fi
+    done
+
+    if [ "$found" != "$expected" ]; then
+        echo " -> '$args' output has $found, expected $expected (Covered, Outside, Kept)"
+        return 1
+    fi
+    return 0
+}
+
+test_start
+
+# text-only modes still track clips and opaque fills
+check_output "" 001 && \
+    check_output "-T" 001 && \
+    check_output "--fast_text" 001
+status=$?
+
+test_end
+
+exit $status
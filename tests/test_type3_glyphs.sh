@@ -0,0 +1,31 @@
+#!/bin/sh
+
+[ "x${TESTS_DIR}" = "x" ] && TESTS_DIR="."
+. ${TESTS_DIR}/test_common.sh
+
+# one line of 'ab' repeated, drawn with a Type3 font
+TYPE3DOC=${TESTS_DIR}/corpus/type3_repeated_glyphs.pdf
+
+test_start
+
+run_cmd "$PDFTOEDN -f -o $TMPFILE $TYPE3DOC"
+status=$?
+
+# the characters are output as text and each CharProc once as a
+# glyph definition referenced from the graphics list. The image
+# mask glyph carries its fill color outside the blob
+output_ok=0
+if grep -q ':text "abab' $TMPFILE && \
+       grep -q ':glyphs \[{:code 97' $TMPFILE && \
+       grep -q ':type :glyph, :glyph_idx 1' $TMPFILE && \
+       grep -q ':id -[0-9]*, :fill_color_idx' $TMPFILE && \
+       ! grep -q ':glyph_idx 2' $TMPFILE; then
+    output_ok=1
+fi
+
+test_end
+
+[ $status -eq $CODE_RUNTIME_OK ] && [ $output_ok -eq 1 ] && exit 0
+
+echo "unexpected return value $status or Type3 glyphs not reused"
+exit 1